@@ -0,0 +1,102 @@
+#include <cstdlib>
+#include <algorithm>
+#include "block_pool.h"
+#include "chaos.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+void *alignedAlloc(size_t size, size_t alignment, bool hugePages) {
+    if (hugePages && size >= CHAOS_HUGE_PAGE_SIZE) {
+        alignment = std::max(alignment, (size_t) CHAOS_HUGE_PAGE_SIZE);
+    }
+    void *ptr = nullptr;
+    if (posix_memalign(&ptr, alignment, size) != 0) {
+        return nullptr;
+    }
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (hugePages && size >= CHAOS_HUGE_PAGE_SIZE) {
+        madvise(ptr, size, MADV_HUGEPAGE);
+    }
+#endif
+    return ptr;
+}
+
+void alignedFree(void *ptr) {
+    free(ptr);
+}
+
+BlockPool::BlockPool(size_t bufferSize, bool hugePages)
+        : m_bufferSize((bufferSize + CHAOS_BUFFER_ALIGN - 1) / CHAOS_BUFFER_ALIGN * CHAOS_BUFFER_ALIGN),
+          m_hugePages(hugePages) {
+}
+
+BlockPool::~BlockPool() {
+    for (void *slab: m_slabs) {
+        alignedFree(slab);
+    }
+}
+
+size_t BlockPool::slabCount() const {
+    // 一个 slab 至少占满一个大页，便于内核以大页映射
+    return m_hugePages ? std::max((size_t) 1, (size_t) CHAOS_HUGE_PAGE_SIZE / m_bufferSize) : 1;
+}
+
+uint8_t *BlockPool::acquire() {
+    if (m_free.empty()) {
+        size_t count = slabCount();
+        uint8_t *slab = (uint8_t *) alignedAlloc(count * m_bufferSize, CHAOS_BUFFER_ALIGN, m_hugePages);
+        if (slab == nullptr) {
+            return nullptr;
+        }
+        m_slabs.push_back(slab);
+        for (size_t i = 0; i < count; i++) {
+            m_free.push_back(slab + (count - 1 - i) * m_bufferSize);
+        }
+    }
+    uint8_t *buffer = m_free.back();
+    m_free.pop_back();
+    return buffer;
+}
+
+void BlockPool::release(uint8_t *buffer) {
+    if (buffer != nullptr) {
+        m_free.push_back(buffer);
+    }
+}
+
+void BlockPool::abandon(uint8_t *buffer) {
+    size_t slabSize = slabCount() * m_bufferSize;
+    for (size_t i = 0; i < m_slabs.size(); i++) {
+        uint8_t *slab = (uint8_t *) m_slabs[i];
+        if (buffer >= slab && buffer < slab + slabSize) {
+            // slab 中其余缓冲区照常复用
+            m_slabs.erase(m_slabs.begin() + i);
+            return;
+        }
+    }
+}
+
+BlockPool &BlockPool::local() {
+    static thread_local BlockPool pool((size_t) MAX_BLOCKROW * MAX_BLOCKCOL, CHAOS_HUGE_PAGES);
+    return pool;
+}
+
+namespace {
+    struct LocalWorkspace {
+        uint8_t *data;
+
+        LocalWorkspace() : data((uint8_t *) alignedAlloc(CHAOS_WORKSPACE_SIZE, 64, false)) {
+        }
+
+        ~LocalWorkspace() {
+            alignedFree(data);
+        }
+    };
+}
+
+uint8_t *localWorkspace() {
+    static thread_local LocalWorkspace workspace;
+    return workspace.data;
+}
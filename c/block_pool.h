@@ -0,0 +1,80 @@
+#ifndef __BLOCK_POOL_H__
+#define __BLOCK_POOL_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 缓冲区起始地址对齐，同时满足 SIMD 访问与直接 I/O 的要求
+#define CHAOS_BUFFER_ALIGN 4096
+// 透明大页大小
+#define CHAOS_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+// Linux/Android 上块缓冲默认申请透明大页，可用 -DCHAOS_HUGE_PAGES=0 关闭
+#ifndef CHAOS_HUGE_PAGES
+#if defined(__linux__)
+#define CHAOS_HUGE_PAGES 1
+#else
+#define CHAOS_HUGE_PAGES 0
+#endif
+#endif
+
+/**
+ * 分配对齐内存
+ * @param size 字节数
+ * @param alignment 对齐字节数，2 的幂
+ * @param hugePages 是否对该区域建议使用透明大页（MADV_HUGEPAGE）
+ * @return 失败返回 nullptr，用 alignedFree 释放
+ */
+void *alignedAlloc(size_t size, size_t alignment, bool hugePages);
+
+void alignedFree(void *ptr);
+
+/**
+ * 定长块缓冲池
+ * 缓冲区按 slab 批量申请，释放后回到空闲链表复用，直到池析构才归还系统，
+ * 稳态下加解密不再产生堆分配，也不会因反复申请新内存而触发缺页
+ */
+class BlockPool {
+public:
+    BlockPool(size_t bufferSize, bool hugePages);
+
+    ~BlockPool();
+
+    BlockPool(const BlockPool &) = delete;
+
+    BlockPool &operator=(const BlockPool &) = delete;
+
+    // 取一个缓冲区，内容未初始化
+    uint8_t *acquire();
+
+    // 归还由本池 acquire 得到的缓冲区
+    void release(uint8_t *buffer);
+
+    // 放弃由本池 acquire 得到的缓冲区：不再复用，所在 slab 在池析构时也不释放。
+    // 用于缓冲区可能仍被内核异步读写（io_uring 请求无法等到完成）的情况
+    void abandon(uint8_t *buffer);
+
+    size_t bufferSize() const {
+        return m_bufferSize;
+    }
+
+    // 当前线程的块缓冲池，缓冲区大小为一个最大块 MAX_BLOCKROW * MAX_BLOCKCOL
+    static BlockPool &local();
+
+private:
+    // 一个 slab 包含的缓冲区数
+    size_t slabCount() const;
+
+    size_t m_bufferSize;
+    bool m_hugePages;
+    std::vector<uint8_t *> m_free;
+    std::vector<void *> m_slabs;
+};
+
+/**
+ * 当前线程的块工作区，CHAOS_WORKSPACE_SIZE 字节，供 encode_Block* / decode_Block* 存放密钥流与扩散密钥
+ */
+uint8_t *localWorkspace();
+
+#endif
@@ -8,9 +8,17 @@
 #include <iomanip>
 #include <algorithm>
 #include <cstdlib>
+#include <atomic>
+#include <climits>
+#include <list>
+#include <mutex>
+#include <unordered_map>
 #include "chaos.h"
 #include "sha256.h"
 #include "crc32.h"
+#include "chaos_simd.h"
+#include "block_pool.h"
+#include "thread_pool.h"
 
 
 
@@ -128,55 +136,148 @@ void generateRandom3(std::string hash, double &x0, double &y0,double &z0, double
     z0 = realmod((h1 + h2) * pow(10, 4), 255) / 256.0;
 }
 
+// 十六进制摘要中从 pos 开始的 8 位组成的 32 位整数
+static uint32_t hashWord(const std::string &hash, size_t pos) {
+    uint32_t word = 0;
+    for (size_t i = pos; i < pos + 8; i++) {
+        word = word << 4 | (uint32_t) hextoDec(hash[i]);
+    }
+    return word;
+}
+
+void generateRandomQ(const std::string &hash, uint32_t &x0, uint32_t &y0, uint32_t &u, uint32_t &r) {
+    // x0 = y0 = 0 是映射的不动点，初值取奇数避开
+    x0 = hashWord(hash, 0) | 1;
+    y0 = hashWord(hash, 8) | 1;
+    // u、r 与 generateRandom 相同取 [4, 20)
+    u = (4u << 24) + (hashWord(hash, 16) >> 4);
+    r = (4u << 24) + (hashWord(hash, 24) >> 4);
+}
+
+void deriveKeySchedule(std::string_view key, CHAOS_KEY_SCHEDULE &schedule) {
+    BYTE digest[SHA256_BLOCK_SIZE];
+    sha256_digest(key.data(), key.length(), digest);
+    std::string hash = sha256_to_hex(digest);
+    CHAOS_MAP2_PARAMS &p2 = schedule.map2;
+    generateRandom(hash, p2.x0, p2.y0, p2.u, p2.r);
+    CHAOS_MAP3_PARAMS &p3 = schedule.map3;
+    generateRandom3(hash, p3.x0, p3.y0, p3.z0, p3.u, p3.r, p3.l);
+    CHAOS_MAPQ_PARAMS &pq = schedule.mapQ;
+    generateRandomQ(hash, pq.x0, pq.y0, pq.u, pq.r);
+    // 预热状态：只迭代，不输出密钥流
+    CHAOS_MAP2_PARAMS &w2 = schedule.map2Warm;
+    w2 = p2;
+    keyStream_Block(0, nullptr, nullptr, w2.x0, w2.y0, w2.u, w2.r);
+    CHAOS_MAP3_PARAMS &w3 = schedule.map3Warm;
+    w3 = p3;
+    keyStream_Block3(0, nullptr, nullptr, w3.x0, w3.y0, w3.z0, w3.u, w3.r, w3.l);
+    CHAOS_MAPQ_PARAMS &wq = schedule.mapQWarm;
+    wq = pq;
+    keyStream_BlockQ(0, nullptr, nullptr, wq.x0, wq.y0, wq.u, wq.r);
+}
+
+struct KEY_CACHE_ENTRY {
+    std::string key;
+    CHAOS_KEY_SCHEDULE schedule;
+};
+
+static std::mutex keyCacheMutex;
+// 表头为最近使用的密钥；容量很小，按顺序查找即可
+static std::list<KEY_CACHE_ENTRY> keyCache;
+
+// 覆盖密钥原文，避免被淘汰的密钥残留在已释放的堆内存中
+static void wipeKey(std::string &key) {
+    volatile char *p = &key[0];
+    for (size_t i = 0; i < key.size(); i++) {
+        p[i] = 0;
+    }
+}
+
+// 调用方持有 keyCacheMutex；命中时移到表头
+static bool findCachedKey(std::string_view key, CHAOS_KEY_SCHEDULE &schedule) {
+    for (auto it = keyCache.begin(); it != keyCache.end(); ++it) {
+        if (it->key == key) {
+            keyCache.splice(keyCache.begin(), keyCache, it);
+            schedule = it->schedule;
+            return true;
+        }
+    }
+    return false;
+}
 
-// 行间异或
-template<typename T>
-inline void XOR_BR(T *a, T *b, T *c, int n) {
-    for (int i = 0; i < n; ++i) {
-        *(a + i) = *(a + i) ^ *(b + i);
-        *(a + i) = *(a + i) ^ *(c + i);
+CHAOS_KEY_SCHEDULE getKeySchedule(std::string_view key) {
+    CHAOS_KEY_SCHEDULE schedule;
+    {
+        std::lock_guard<std::mutex> lock(keyCacheMutex);
+        if (findCachedKey(key, schedule)) {
+            return schedule;
+        }
+    }
+    // 推导在锁外进行，不阻塞其他线程查询已缓存的密钥
+    deriveKeySchedule(key, schedule);
+    std::lock_guard<std::mutex> lock(keyCacheMutex);
+    CHAOS_KEY_SCHEDULE cached;
+    if (!findCachedKey(key, cached)) {
+        keyCache.push_front({std::string(key), schedule});
+        if (keyCache.size() > CHAOS_KEY_CACHE_SIZE) {
+            wipeKey(keyCache.back().key);
+            keyCache.pop_back();
+        }
     }
+    return schedule;
 }
 
-// 行与0异或
-template<typename T>
-inline void XOR_BR_ZERO(T *a, T *b, int n) {
-    for (int i = 0; i < n; ++i) {
-        *(a + i) = *(a + i) ^ *(b + i);
-        *(a + i) = *(a + i) ^ 0;
+void clearKeyScheduleCache() {
+    std::lock_guard<std::mutex> lock(keyCacheMutex);
+    for (KEY_CACHE_ENTRY &entry: keyCache) {
+        wipeKey(entry.key);
     }
+    keyCache.clear();
 }
 
-// 列间异或
-template<typename T>
-inline void XOR_BC(T *a, T *b, T *c, int n) {
-    int t;
-    for (int i = 0; i < n; ++i) {
-        t = i * n;
-        *(a + t) = *(a + t) ^ *(b + i);
-        // c为列向量
-        *(a + t) = *(a + t) ^ *(c + t);
-        // t += (n + 1);
+static std::mutex keyHandleMutex;
+static std::unordered_map<int, CHAOS_KEY_SCHEDULE> keyHandles;
+static int nextKeyHandle = 1;
+
+int openKeyHandle(std::string_view key) {
+    if (key.length() < 8 || key.length() > 256) {
+        return -1;
     }
+    CHAOS_KEY_SCHEDULE schedule = getKeySchedule(key);
+    std::lock_guard<std::mutex> lock(keyHandleMutex);
+    // 句柄用尽后从 1 重新分配，跳过仍在使用的句柄
+    do {
+        if (nextKeyHandle == INT_MAX) {
+            nextKeyHandle = 1;
+        }
+    } while (keyHandles.count(nextKeyHandle++) > 0);
+    int handle = nextKeyHandle - 1;
+    keyHandles[handle] = schedule;
+    return handle;
 }
 
-// 列与0异或
-template<typename T>
-inline void XOR_BC_ZERO(T *a, T *b, int n) {
-    int t;
-    for (int i = 0; i < n; ++i) {
-        t = i * n;
-        *(a + t) = *(a + t) ^ *(b + i);
-        *(a + t) = *(a + t) ^ 0;
+bool getKeyHandle(int handle, CHAOS_KEY_SCHEDULE &schedule) {
+    std::lock_guard<std::mutex> lock(keyHandleMutex);
+    auto it = keyHandles.find(handle);
+    if (it == keyHandles.end()) {
+        return false;
     }
+    schedule = it->second;
+    return true;
 }
 
+bool closeKeyHandle(int handle) {
+    std::lock_guard<std::mutex> lock(keyHandleMutex);
+    return keyHandles.erase(handle) > 0;
+}
+
+
 // 分割块大小
 std::vector<int> splitBlockSize(uint64_t size) {
     std::vector<int> blocksSize;
     int Max_Size = MAX_BLOCKROW * MAX_BLOCKCOL;
     int Min_Size = MIN_BLOCKROW * MIN_BLOCKCOL;
-    while (size > Min_Size) {
+    while (size > (uint64_t) Min_Size) {
         int maxBlockSize = std::min(size, (uint64_t) Max_Size); // 最大块大小为1024*1024
         int blockSize = std::sqrt(maxBlockSize);               // 开方取整
         int blockValue = blockSize * blockSize;
@@ -191,9 +292,37 @@ std::vector<int> splitBlockSize(uint64_t size) {
     return blocksSize;
 }
 
+// 矩形分块：整块之后的剩余部分只用一个尾块，列数取剩余长度的平方根向上取整，行数按列数补足
+std::vector<int> splitBlockRect(uint64_t size) {
+    std::vector<int> blocksSize;
+    int Max_Size = MAX_BLOCKROW * MAX_BLOCKCOL;
+    uint64_t fullNum = size / Max_Size;
+    int tail = (int) (size % Max_Size);
+    blocksSize.reserve(2 * (fullNum + 1));
+    for (uint64_t i = 0; i < fullNum; i++) {
+        blocksSize.push_back(Max_Size);
+        blocksSize.push_back(MAX_BLOCKCOL);
+    }
+    if (tail > 0) {
+        int n = (int) std::sqrt(tail);
+        if (n * n < tail) {
+            n++;
+        }
+        n = std::max(n, MIN_BLOCKCOL);
+        int m = std::max((tail + n - 1) / n, MIN_BLOCKROW);
+        blocksSize.push_back(m * n);
+        blocksSize.push_back(n);
+    }
+    return blocksSize;
+}
+
+std::vector<int> splitFileBlocks(uint64_t size, int flags) {
+    return (flags & CHAOS_FILE_FLAG_RECT_BLOCKS) ? splitBlockRect(size) : splitBlockSize(size);
+}
+
 // 计算密文前的前缀密文长度位数和密文长度
 void getEmLenStr(Len_t &lenBit, std::string &lenBitStr) {
-    int bitloc;
+    int bitloc = 0;
     //从高位往低位找，找到第一个值不为0的位置
     for (int i = 7; i >= 0; i--) {
         if (lenBit.len8[i] != 0) {
@@ -201,30 +330,125 @@ void getEmLenStr(Len_t &lenBit, std::string &lenBitStr) {
             break;
         }
     }
+    // 位数 + 长度的大端字节
+    uint8_t bytes[9];
+    bytes[0] = static_cast<uint8_t>((bitloc + 1) * 8);
     for (int i = bitloc; i >= 0; i--) {
-        if (i == bitloc) {
-            std::stringstream ss;
-            ss << std::uppercase << std::hex << std::setw(2) << std::setfill('0') << (bitloc + 1) * 8;
-            std::string m = ss.str();
-            lenBitStr += ss.str();
-        }
-        std::stringstream ss;
-        ss << std::uppercase << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(lenBit.len8[i]);
-        std::string m = ss.str();
-        lenBitStr += ss.str();
+        bytes[1 + bitloc - i] = lenBit.len8[i];
     }
+    size_t offset = lenBitStr.length();
+    lenBitStr.resize(offset + 2 * (bitloc + 2));
+    hexEncode(bytes, bitloc + 2, &lenBitStr[offset]);
 //    std::cout << "密文长度: " << lenBit.len64 << " Lenbit：" << lenBitStr << std::endl;
 }
 
-// 加密块部分
-void encode_Block(uint8_t *matrix, int m, int n, double &x0, double &y0, double &u, double &r) {
-    int t = 200;
+// 小端读写文件头字段
+static void putLittle(uint8_t *out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out[i] = (uint8_t) (value >> (8 * i));
+    }
+}
+
+static uint64_t getLittle(const uint8_t *in, int bytes) {
+    uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        value = (value << 8) | in[i];
+    }
+    return value;
+}
+
+void writeFileHeader(uint64_t plainLength, int flags, int mapId, uint8_t *out) {
+    memset(out, 0, CHAOS_FILE_HEADER_SIZE);
+    memcpy(out, CHAOS_FILE_MAGIC, 8);
+    putLittle(out + 8, CHAOS_FILE_VERSION, 2);
+    putLittle(out + 10, CHAOS_FILE_HEADER_SIZE, 2);
+    putLittle(out + 12, (uint64_t) mapId, 2);
+    putLittle(out + 14, (uint64_t) flags, 2);
+    putLittle(out + 16, MAX_BLOCKROW, 2);
+    putLittle(out + 18, MAX_BLOCKCOL, 2);
+    putLittle(out + 24, plainLength, 8);
+}
+
+// 解析 v1 长度前缀：2 位十六进制的位数 + 位数 / 4 位十六进制的长度。逐位解析，不经过 stoi，超过 2GB 也不会溢出
+static bool parseFileHeaderV1(const uint8_t *data, size_t len, CHAOS_FILE_HEADER &header) {
+    if (len < 2 || hextoDec(data[0]) < 0 || hextoDec(data[1]) < 0) {
+        return false;
+    }
+    int len8 = hextoDec(data[0]) * 16 + hextoDec(data[1]);
+    if (len8 < 8 || len8 > 64 || len8 % 8 != 0 || len < (size_t) (2 + len8 / 4)) {
+        return false;
+    }
+    uint64_t plainLength = 0;
+    for (int i = 0; i < len8 / 4; i++) {
+        int digit = hextoDec(data[2 + i]);
+        if (digit < 0) {
+            return false;
+        }
+        plainLength = (plainLength << 4) | (uint64_t) digit;
+    }
+    header.version = 1;
+    header.dataOffset = 2 + len8 / 4;
+    header.mapId = CHAOS_MAP_3D;
+    header.flags = 0;
+    header.blockRows = MAX_BLOCKROW;
+    header.blockCols = MAX_BLOCKCOL;
+    header.plainLength = plainLength;
+    header.crcTableOffset = 0;
+    return true;
+}
+
+bool parseFileHeader(const uint8_t *data, size_t len, CHAOS_FILE_HEADER &header) {
+    if (len < 8 || memcmp(data, CHAOS_FILE_MAGIC, 8) != 0) {
+        return parseFileHeaderV1(data, len, header);
+    }
+    if (len < 32) {
+        return false;
+    }
+    header.version = (int) getLittle(data + 8, 2);
+    header.dataOffset = getLittle(data + 10, 2);
+    header.mapId = (int) getLittle(data + 12, 2);
+    header.flags = (int) getLittle(data + 14, 2);
+    header.blockRows = (int) getLittle(data + 16, 2);
+    header.blockCols = (int) getLittle(data + 18, 2);
+    header.plainLength = getLittle(data + 24, 8);
+    header.crcTableOffset = (header.flags & CHAOS_FILE_FLAG_BLOCK_CRC) ? header.dataOffset + header.plainLength : 0;
+    // 同一大版本内只会追加字段，headerSize 不会小于 v2
+    return header.version == CHAOS_FILE_VERSION && header.dataOffset >= CHAOS_FILE_HEADER_SIZE &&
+           (header.mapId == CHAOS_MAP_3D || header.mapId == CHAOS_MAP_FIXED) &&
+           (header.flags & ~CHAOS_FILE_FLAGS_KNOWN) == 0 &&
+           header.blockRows == MAX_BLOCKROW && header.blockCols == MAX_BLOCKCOL;
+}
+
+uint32_t blockCrc32(const uint8_t *data, size_t len) {
+    CRC32 crc32;
+    crc32.add(data, len);
+    unsigned char hash[CRC32::HashBytes];
+    crc32.getHash(hash);
+    return ((uint32_t) hash[0] << 24) | ((uint32_t) hash[1] << 16) | ((uint32_t) hash[2] << 8) | hash[3];
+}
+
+uint64_t blockCrcTableSize(uint64_t plainLength, int flags) {
+    return 4 * (uint64_t) (splitFileBlocks(plainLength, flags).size() / 2);
+}
+
+void encodeBlockCrcTable(const std::vector<uint32_t> &crcs, uint8_t *bytes) {
+    for (size_t i = 0; i < crcs.size(); i++) {
+        putLittle(bytes + 4 * i, crcs[i], 4);
+    }
+}
+
+void decodeBlockCrcTable(const uint8_t *bytes, std::vector<uint32_t> &crcs) {
+    for (size_t i = 0; i < crcs.size(); i++) {
+        crcs[i] = (uint32_t) getLittle(bytes + 4 * i, 4);
+    }
+}
+
+// 生成块密钥流 x、y（各 m 字节），并推进二维混沌系统状态
+void keyStream_Block(int m, uint8_t *x, uint8_t *y, double &x0, double &y0, double &u, double &r, int warmup) {
+    int t = warmup;
     double pi = 3.1415926;
     double x1, y1;
     int size = m;
-    uint8_t *random_num = (uint8_t *) malloc(2 * size * sizeof(uint8_t));
-    uint8_t *x = random_num;
-    uint8_t *y = random_num + m;
     for (int i = 1; i <= size + t; ++i) {
         x1 = sin(pi * (y0 + r * x0)) + u * (y0 + r * x0) * (1 - (y0 + r * x0));
         x1 = realmod(x1, 1);
@@ -237,66 +461,135 @@ void encode_Block(uint8_t *matrix, int m, int n, double &x0, double &y0, double
             *(y + i - t - 1) = round(realmod(y1 * multiplier, 255));
         }
     }
-    uint8_t *store = (uint8_t *) malloc(7 * n * sizeof(uint8_t));
-    int board = 6;
-    uint8_t *e1 = store + m;
-    uint8_t *e3 = store + 4 * m;
-    uint8_t *e_value = store + board * m;
-    uint8_t *p_value;
-    uint8_t *c_value_p;
-    memcpy(e1 - m, x, m * sizeof(uint8_t));
-    memcpy(e1, x, m * sizeof(uint8_t));
-    memcpy(e1 + m, x, m * sizeof(uint8_t));
-    memcpy(e3 - m, y, m * sizeof(uint8_t));
-    memcpy(e3, y, m * sizeof(uint8_t));
-    memcpy(e3 + m, y, m * sizeof(uint8_t));
-    int k = 1;
-    int shift;
-    for (int i = 0; i < m; ++i) {
-        // 循环右移减，循环左移加
-        shift = i * k % m;
-        memcpy(e_value, e1 - shift, m * sizeof(uint8_t));
-        if (i > 0) {
-            p_value = matrix + i * n;
-            c_value_p = matrix + (i - 1) * n;
-            XOR_BR(p_value, e_value, c_value_p, n);
-        } else {
-            p_value = matrix + i * n;
-            XOR_BR_ZERO(p_value, e_value, n);
+}
+
+// sin(pi * t) 的 Q28 泰勒系数 pi^k / k!
+#define SINPI_Q28_1 843314857u
+#define SINPI_Q28_3 1387197337u
+#define SINPI_Q28_5 684554447u
+#define SINPI_Q28_7 160863847u
+#define SINPI_Q28_9 22050869u
+// sin 表把 [0, 1] 分为 2^SINPI_TABLE_BITS 段，段内线性插值
+#define SINPI_TABLE_BITS 10
+
+// sin(pi * t)，t 为 Q0.32 小数，结果为 Q32（不截断）。
+// 先按 1/2 对称折到 w ∈ [0, 1/2]，再用 9 次泰勒多项式展开；w ≤ 1/2 时 Horner 的每一步都为正，全程无符号运算
+static uint64_t sinPiPoly(uint32_t t) {
+    uint64_t w = t <= 0x80000000u ? t : 0x100000000ull - t;
+    uint64_t w2 = w * w >> 32;
+    uint64_t p = SINPI_Q28_9;
+    p = SINPI_Q28_7 - (p * w2 >> 32);
+    p = SINPI_Q28_5 - (p * w2 >> 32);
+    p = SINPI_Q28_3 - (p * w2 >> 32);
+    p = SINPI_Q28_1 - (p * w2 >> 32);
+    return p * w >> 28;
+}
+
+// 分段点上的 sin(pi * t)，由 sinPiPoly 生成，与平台无关。
+// 每段存两项：段起点的值、到下一分段点的差（按模 2^64 存放，可以为负）
+static const uint64_t *sinPiTable() {
+    static const std::vector<uint64_t> table = [] {
+        std::vector<uint64_t> values(2 << SINPI_TABLE_BITS);
+        for (int i = 0; i < (1 << SINPI_TABLE_BITS); i++) {
+            uint64_t next = i + 1 < (1 << SINPI_TABLE_BITS) ? sinPiPoly((uint32_t) (i + 1) << (32 - SINPI_TABLE_BITS)) : 0;
+            values[2 * i] = sinPiPoly((uint32_t) i << (32 - SINPI_TABLE_BITS));
+            values[2 * i + 1] = next - values[2 * i];
         }
+        return values;
+    }();
+    return table.data();
+}
+
+// 查表插值求 sin(pi * t)，结果按模 1 截断为 Q0.32（t = 1/2 附近的 1.0 截为 0，与映射中的取模一致）。
+// 值·2^16 + 差·f 的真实结果非负且小于 2^64，按模运算与分开计算两端权重的结果相同
+static inline uint32_t sinPiQ(const uint64_t *table, uint32_t t) {
+    uint32_t i = t >> (32 - SINPI_TABLE_BITS);
+    uint64_t f = (t >> (16 - SINPI_TABLE_BITS)) & 0xFFFF;
+    return (uint32_t) (((table[2 * i] << 16) + table[2 * i + 1] * f) >> 16);
+}
+
+// 定点映射的一步：t = frac(b + r·a)，返回 frac(sin(pi·t) + u·t·(1 - t))
+static inline uint32_t mapStepQ(const uint64_t *table, uint32_t a, uint32_t b, uint32_t u, uint32_t r) {
+    uint32_t t = b + (uint32_t) ((uint64_t) r * a >> 24);
+    uint64_t t1 = (uint64_t) t * (0x100000000ull - t) >> 32;
+    return sinPiQ(table, t) + (uint32_t) ((uint64_t) u * t1 >> 24);
+}
+
+// 状态的 4 个字节异或折叠为 1 字节密钥流，高位字节单独使用时分布不均
+static inline uint8_t foldQ(uint32_t v) {
+    return (uint8_t) (v ^ (v >> 8) ^ (v >> 16) ^ (v >> 24));
+}
+
+void keyStream_BlockQ(int m, uint8_t *x, uint8_t *y, uint32_t &x0, uint32_t &y0, uint32_t u, uint32_t r, int warmup) {
+    const uint64_t *table = sinPiTable();
+    int t = warmup;
+    uint32_t x1 = x0, y1 = y0;
+    for (int i = 0; i < t; ++i) {
+        x1 = mapStepQ(table, x1, y1, u, r);
+        y1 = mapStepQ(table, y1, x1, u, r);
     }
     for (int i = 0; i < m; ++i) {
-        shift = i * k % m;
-        memcpy(e_value, e3 - shift, m * sizeof(uint8_t));
-        if (i > 0) {
-            p_value = matrix + i;
-            c_value_p = matrix + (i - 1);
-            XOR_BC(p_value, e_value, c_value_p, n);
-        } else {
-            p_value = matrix + i;
-            XOR_BC_ZERO(p_value, e_value, n);
+        x1 = mapStepQ(table, x1, y1, u, r);
+        y1 = mapStepQ(table, y1, x1, u, r);
+        x[i] = foldQ(x1);
+        y[i] = foldQ(y1);
+    }
+    x0 = x1;
+    y0 = y1;
+}
+
+void keyStream_LanesQ(int lanes, int m, uint8_t *const *x, uint8_t *const *y, uint32_t *x0, uint32_t *y0, uint32_t u,
+                      uint32_t r) {
+    const uint64_t *table = sinPiTable();
+    int t = CHAOS_WARMUP;
+    int lane = 0;
+    for (; lane + CHAOS_Q_LANES <= lanes; lane += CHAOS_Q_LANES) {
+        uint32_t xs[CHAOS_Q_LANES], ys[CHAOS_Q_LANES];
+        // 输出指针先取到局部，避免每次写入密钥流后重新读取指针数组
+        uint8_t *xo[CHAOS_Q_LANES], *yo[CHAOS_Q_LANES];
+        for (int k = 0; k < CHAOS_Q_LANES; k++) {
+            xs[k] = x0[lane + k];
+            ys[k] = y0[lane + k];
+            xo[k] = x[lane + k];
+            yo[k] = y[lane + k];
+        }
+        for (int i = 0; i < t; ++i) {
+            for (int k = 0; k < CHAOS_Q_LANES; k++) {
+                xs[k] = mapStepQ(table, xs[k], ys[k], u, r);
+                ys[k] = mapStepQ(table, ys[k], xs[k], u, r);
+            }
+        }
+        for (int i = 0; i < m; ++i) {
+            for (int k = 0; k < CHAOS_Q_LANES; k++) {
+                xs[k] = mapStepQ(table, xs[k], ys[k], u, r);
+                ys[k] = mapStepQ(table, ys[k], xs[k], u, r);
+                xo[k][i] = foldQ(xs[k]);
+                yo[k][i] = foldQ(ys[k]);
+            }
         }
+        for (int k = 0; k < CHAOS_Q_LANES; k++) {
+            x0[lane + k] = xs[k];
+            y0[lane + k] = ys[k];
+        }
+    }
+    // 不足一组的轨迹逐条生成
+    for (; lane < lanes; lane++) {
+        keyStream_BlockQ(m, x[lane], y[lane], x0[lane], y0[lane], u, r);
     }
-    free(store);
-    free(random_num);
 }
 
-// 加密块部分 3维混沌系统的加密
-void encode_Block3(uint8_t *matrix, int m, int n, double &x0, double &y0, double &z0, double &u, double &r, double &l) {
-    int t = 200;
-    double pi = 3.1415926;
-    double x1, y1, z1;
+// 生成块密钥流 x、y（各 m 字节），并推进三维混沌系统状态
+void keyStream_Block3(int m, uint8_t *x, uint8_t *y, double &x0, double &y0, double &z0, double &u, double &r, double &l,
+                      int warmup) {
+    int t = warmup;
+    double x1, y1;
     int size = m;
-    uint8_t *random_num = (uint8_t *) malloc(2 * size * sizeof(uint8_t));
-    uint8_t *x = random_num;
-    uint8_t *y = random_num + m;
     for (int i = 1; i <= size + t; ++i) {
         x1 = u*x0+u*y0;
         x1 = realmod(x1, 1);
         y1 = u*y0+r*z0;
         y1 = realmod(y1, 1);
-        z1 = l*z0+l*x0;
-        z1 = realmod(y1, 1);
+        // z 分量的迭代结果从未被使用，z0 每步固定为 1；为与已有密文兼容保持不变
 
         x0 = x1;
         y0 = y1;
@@ -306,196 +599,461 @@ void encode_Block3(uint8_t *matrix, int m, int n, double &x0, double &y0, double
             *(y + i - t - 1) = round(realmod(y1 * multiplier, 255));
         }
     }
-    uint8_t *store = (uint8_t *) malloc(7 * n * sizeof(uint8_t));
-    int board = 6;
-    uint8_t *e1 = store + m;
-    uint8_t *e3 = store + 4 * m;
-    uint8_t *e_value = store + board * m;
-    uint8_t *p_value;
-    uint8_t *c_value_p;
-    memcpy(e1 - m, x, m * sizeof(uint8_t));
-    memcpy(e1, x, m * sizeof(uint8_t));
-    memcpy(e1 + m, x, m * sizeof(uint8_t));
-    memcpy(e3 - m, y, m * sizeof(uint8_t));
-    memcpy(e3, y, m * sizeof(uint8_t));
-    memcpy(e3 + m, y, m * sizeof(uint8_t));
-    int k = 1;
-    int shift;
-    for (int i = 0; i < m; ++i) {
-        // 循环右移减，循环左移加
-        shift = i * k % m;
-        memcpy(e_value, e1 - shift, m * sizeof(uint8_t));
-        if (i > 0) {
-            p_value = matrix + i * n;
-            c_value_p = matrix + (i - 1) * n;
-            XOR_BR(p_value, e_value, c_value_p, n);
-        } else {
-            p_value = matrix + i * n;
-            XOR_BR_ZERO(p_value, e_value, n);
+}
+
+// 列扩散分块的行数：标量实现按 8 行一条带处理，8 行 × 1024 列 = 8KB 可常驻 L1，
+// 条带内同一列的 8 个字节互不依赖，避免了逐列跨 n 字节访问整块
+#define DIFFUSE_TILE_ROWS 8
+
+// 三份拼接的密钥流 x|x|x 与列方向使用的逆序密钥流 yr|yr|yr，yr[k] = y[(m - k) % m]，m 为密钥流长度 blockKeyLength
+// 第 i 行的行密钥为 x[(j - i) mod m]，即 e1 - i 起的连续 n 字节；
+// 第 j 行第 i 列的列密钥为 y[(j - i) mod m]，即 er[i - j]。行号、列号都小于 m，矩形块的下标同样落在三份之内
+static void fillDiffuseKeys(uint8_t *store, int m, const uint8_t *x, const uint8_t *y) {
+    uint8_t *er = store + 3 * m;
+    memcpy(store, x, m * sizeof(uint8_t));
+    memcpy(store + m, x, m * sizeof(uint8_t));
+    memcpy(store + 2 * m, x, m * sizeof(uint8_t));
+    er[0] = y[0];
+    for (int k = 1; k < m; ++k) {
+        er[k] = y[m - k];
+    }
+    memcpy(er + m, er, m * sizeof(uint8_t));
+    memcpy(er + 2 * m, er, m * sizeof(uint8_t));
+}
+
+// 以下各扩散过程使用 level 级别的扩散核，由调用方在整块开始前取定
+// 加密行间扩散：第 i 行异或行密钥与已加密的第 i-1 行
+static void encode_RowPass(uint8_t *matrix, int m, int n, const uint8_t *e1, int level) {
+    const CHAOS_DIFFUSE_KERNELS &kernels = getDiffuseKernels(level);
+    kernels.xorRow2(matrix, e1, n);
+    for (int i = 1; i < m; ++i) {
+        kernels.xorRow3(matrix + i * n, e1 - i, matrix + (i - 1) * n, n);
+    }
+}
+
+// 解密行间扩散：自下而上，第 i 行异或行密钥与尚未解密的第 i-1 行
+static void decode_RowPass(uint8_t *matrix, int m, int n, const uint8_t *e1, int level) {
+    const CHAOS_DIFFUSE_KERNELS &kernels = getDiffuseKernels(level);
+    for (int i = m - 1; i > 0; --i) {
+        kernels.xorRow3(matrix + i * n, e1 - i, matrix + (i - 1) * n, n);
+    }
+    kernels.xorRow2(matrix, e1, n);
+}
+
+// 加密列间扩散：第 i 列异或列密钥与已加密的第 i-1 列
+static void encode_ColumnPass(uint8_t *matrix, int m, int n, const uint8_t *er, int level) {
+    if (level != CHAOS_SIMD_SCALAR) {
+        const CHAOS_DIFFUSE_KERNELS &kernels = getDiffuseKernels(level);
+        for (int j = 0; j < m; ++j) {
+            kernels.scanRow(matrix + j * n, er - j, n);
         }
+        return;
     }
-    for (int i = 0; i < m; ++i) {
-        shift = i * k % m;
-        memcpy(e_value, e3 - shift, m * sizeof(uint8_t));
-        if (i > 0) {
-            p_value = matrix + i;
-            c_value_p = matrix + (i - 1);
-            XOR_BC(p_value, e_value, c_value_p, n);
-        } else {
-            p_value = matrix + i;
-            XOR_BC_ZERO(p_value, e_value, n);
+    for (int j0 = 0; j0 < m; j0 += DIFFUSE_TILE_ROWS) {
+        int j1 = std::min(j0 + DIFFUSE_TILE_ROWS, m);
+        for (int j = j0; j < j1; ++j) {
+            matrix[j * n] ^= er[-j];
+        }
+        for (int i = 1; i < n; ++i) {
+            for (int j = j0; j < j1; ++j) {
+                uint8_t *row = matrix + j * n;
+                row[i] ^= er[i - j] ^ row[i - 1];
+            }
         }
     }
-    free(store);
-    free(random_num);
 }
 
-// 解密块部分
-void decode_Block(uint8_t *matrix, int m, int n, double &x0, double &y0, double &u, double &r) {
-    int channel = 1;
-    int t = 200;
-    double pi = 3.1415926;
-    double x1, y1;
-    int size = m * channel;
-    uint8_t *random_num = (uint8_t *) malloc(2 * size * sizeof(uint8_t));
-    uint8_t *x = random_num;
-    uint8_t *y = random_num + m;
-    for (int i = 1; i <= size + t; ++i) {
-        x1 = sin(pi * (y0 + r * x0)) + u * (y0 + r * x0) * (1 - (y0 + r * x0));
-        x1 = realmod(x1, 1);
-        y1 = sin(pi * (x1 + r * y0)) + u * (x1 + r * y0) * (1 - (x1 + r * y0));
-        y1 = realmod(y1, 1);
-        x0 = x1;
-        y0 = y1;
-        if (i > t) {
-            *(x + i - t - 1) = round(realmod(x1 * multiplier, 255));
-            *(y + i - t - 1) = round(realmod(y1 * multiplier, 255));
+// 解密列间扩散：自右向左，第 i 列异或列密钥与尚未解密的第 i-1 列
+static void decode_ColumnPass(uint8_t *matrix, int m, int n, const uint8_t *er, int level) {
+    if (level != CHAOS_SIMD_SCALAR) {
+        const CHAOS_DIFFUSE_KERNELS &kernels = getDiffuseKernels(level);
+        for (int j = 0; j < m; ++j) {
+            kernels.diffRow(matrix + j * n, er - j, n);
         }
+        return;
     }
-    uint8_t *store = (uint8_t *) malloc(7 * n * sizeof(uint8_t));
-    int board = 6 * channel;
-    uint8_t *e1 = store + m;
-    uint8_t *e3 = store + 4 * m;
-    uint8_t *e_value = store + board * m;
-    uint8_t *p_value;
-    uint8_t *c_value_p;
-    memcpy(e1 - m, x, m * sizeof(uint8_t));
-    memcpy(e1, x, m * sizeof(uint8_t));
-    memcpy(e1 + m, x, m * sizeof(uint8_t));
-    memcpy(e3 - m, y, m * sizeof(uint8_t));
-    memcpy(e3, y, m * sizeof(uint8_t));
-    memcpy(e3 + m, y, m * sizeof(uint8_t));
-    int k = 1;
-    int shift;
-    int cnt = 0;
-    for (int i = m - 1; i >= 0; --i) {
-        shift = cnt * k % m;
-        memcpy(e_value, e3 + shift + 1, m * sizeof(uint8_t));
-        if (i > 0) {
-            p_value = matrix + i;
-            c_value_p = matrix + (i - 1);
-            XOR_BC(p_value, e_value, c_value_p, n);
-        } else {
-            p_value = matrix + i;
-            XOR_BC_ZERO(p_value, e_value, n);
+    for (int j0 = 0; j0 < m; j0 += DIFFUSE_TILE_ROWS) {
+        int j1 = std::min(j0 + DIFFUSE_TILE_ROWS, m);
+        for (int i = n - 1; i > 0; --i) {
+            for (int j = j0; j < j1; ++j) {
+                uint8_t *row = matrix + j * n;
+                row[i] ^= er[i - j] ^ row[i - 1];
+            }
+        }
+        for (int j = j0; j < j1; ++j) {
+            matrix[j * n] ^= er[-j];
         }
+    }
+}
+
+// 加密扩散部分：先行间异或，再列间异或
+void encode_Diffuse(uint8_t *matrix, int m, int n, const uint8_t *x, const uint8_t *y, uint8_t *workspace) {
+    uint8_t *store = workspace + CHAOS_WORKSPACE_STORE;
+    int k = blockKeyLength(m, n);
+    int level = getSimdLevel();
+    fillDiffuseKeys(store, k, x, y);
+    encode_RowPass(matrix, m, n, store + k, level);
+    encode_ColumnPass(matrix, m, n, store + 4 * k, level);
+}
+
+void encode_Diffuse(uint8_t *matrix, int m, int n, const uint8_t *x, const uint8_t *y) {
+    encode_Diffuse(matrix, m, n, x, y, localWorkspace());
+}
 
-        cnt++;
+// 解密扩散部分：按加密的逆序，先逆列间异或，再逆行间异或
+void decode_Diffuse(uint8_t *matrix, int m, int n, const uint8_t *x, const uint8_t *y, uint8_t *workspace) {
+    uint8_t *store = workspace + CHAOS_WORKSPACE_STORE;
+    int k = blockKeyLength(m, n);
+    int level = getSimdLevel();
+    fillDiffuseKeys(store, k, x, y);
+    decode_ColumnPass(matrix, m, n, store + 4 * k, level);
+    decode_RowPass(matrix, m, n, store + k, level);
+}
+
+void decode_Diffuse(uint8_t *matrix, int m, int n, const uint8_t *x, const uint8_t *y) {
+    decode_Diffuse(matrix, m, n, x, y, localWorkspace());
+}
+
+// 扩散基准测试
+CHAOS_OPERATION_RESULT benchmarkDiffusePasses(int side, int rounds, int level) {
+    CHAOS_OPERATION_RESULT result = {0, "", ""};
+    if (side < MIN_BLOCKROW || side > MAX_BLOCKROW || rounds <= 0) {
+        result.errorMsg = "Invalid benchmark parameters.";
+        return result;
     }
-    cnt = 0;
-    for (int i = m - 1; i >= 0; --i) {
-        // 循环右移减，循环左移加
-        shift = cnt * k % m;
-        memcpy(e_value, e1 + shift + 1, m * sizeof(uint8_t));
-        if (i > 0) {
-            p_value = matrix + i * n;
-            c_value_p = matrix + (i - 1) * n;
-            XOR_BR(p_value, e_value, c_value_p, n);
-        } else {
-            p_value = matrix + i * n;
-            XOR_BR_ZERO(p_value, e_value, n);
-        }
-        cnt++;
+    if (!isSimdLevelSupported(level)) {
+        result.errorMsg = "Unsupported SIMD level.";
+        return result;
+    }
+    uint64_t blockSize = (uint64_t) side * side;
+    // 块取自块缓冲池；两条密钥流（2 * side）与扩散密钥（6 * side）正好放进工作区
+    BlockPool &pool = BlockPool::local();
+    uint8_t *matrix = pool.acquire();
+    uint8_t *workspace = localWorkspace();
+    if (matrix == nullptr || workspace == nullptr) {
+        pool.release(matrix);
+        result.errorMsg = "Out of memory.";
+        return result;
+    }
+    uint8_t *random_num = workspace;
+    uint8_t *store = workspace + 2 * side;
+    for (uint64_t i = 0; i < blockSize; i++) {
+        matrix[i] = (uint8_t) (i * 131 + 7);
+    }
+    double x0, y0, z0, u, r, l;
+    generateRandom3(sha256_hash("benchmarkDiffusePasses"), x0, y0, z0, u, r, l);
+    keyStream_Block3(side, random_num, random_num + side, x0, y0, z0, u, r, l);
+    fillDiffuseKeys(store, side, random_num, random_num + side);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        encode_RowPass(matrix, side, side, store + side, level);
+    }
+    auto middle = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        encode_ColumnPass(matrix, side, side, store + 4 * side, level);
     }
-    free(store);
-    free(random_num);
+    auto end = std::chrono::steady_clock::now();
+
+    double bits = static_cast<double>(blockSize) * rounds * 8;
+    double rowSeconds = std::chrono::duration<double>(middle - start).count();
+    double columnSeconds = std::chrono::duration<double>(end - middle).count();
+    double rowSpeed = rowSeconds > 0 ? bits / 1024 / 1024 / 1024 / rowSeconds : 0;
+    double columnSpeed = columnSeconds > 0 ? bits / 1024 / 1024 / 1024 / columnSeconds : 0;
+    result.result = std::to_string(rowSpeed) + "|" + std::to_string(columnSpeed);
+    result.mill = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    result.size = blockSize * rounds * 2;
+    result.speed = static_cast<float>(std::min(rowSpeed, columnSpeed));
+    result.success = 1;
+    pool.release(matrix);
+    return result;
+}
+
+// 加密块部分
+void encode_Block(uint8_t *matrix, int m, int n, double &x0, double &y0, double &u, double &r, uint8_t *workspace) {
+    int k = blockKeyLength(m, n);
+    keyStream_Block(k, workspace, workspace + k, x0, y0, u, r);
+    encode_Diffuse(matrix, m, n, workspace, workspace + k, workspace);
+}
+
+void encode_Block(uint8_t *matrix, int m, int n, double &x0, double &y0, double &u, double &r) {
+    encode_Block(matrix, m, n, x0, y0, u, r, localWorkspace());
+}
+
+// 加密块部分 3维混沌系统的加密
+void encode_Block3(uint8_t *matrix, int m, int n, double &x0, double &y0, double &z0, double &u, double &r, double &l,
+                   uint8_t *workspace) {
+    int k = blockKeyLength(m, n);
+    keyStream_Block3(k, workspace, workspace + k, x0, y0, z0, u, r, l);
+    encode_Diffuse(matrix, m, n, workspace, workspace + k, workspace);
+}
+
+void encode_Block3(uint8_t *matrix, int m, int n, double &x0, double &y0, double &z0, double &u, double &r, double &l) {
+    encode_Block3(matrix, m, n, x0, y0, z0, u, r, l, localWorkspace());
+}
+
+// 解密块部分
+void decode_Block(uint8_t *matrix, int m, int n, double &x0, double &y0, double &u, double &r, uint8_t *workspace) {
+    int k = blockKeyLength(m, n);
+    keyStream_Block(k, workspace, workspace + k, x0, y0, u, r);
+    decode_Diffuse(matrix, m, n, workspace, workspace + k, workspace);
+}
+
+void decode_Block(uint8_t *matrix, int m, int n, double &x0, double &y0, double &u, double &r) {
+    decode_Block(matrix, m, n, x0, y0, u, r, localWorkspace());
 }
 
 // 解密块部分 3维混沌系统的解密
+void decode_Block3(uint8_t *matrix, int m, int n, double &x0, double &y0, double &z0, double &u, double &r, double &l,
+                   uint8_t *workspace) {
+    int k = blockKeyLength(m, n);
+    keyStream_Block3(k, workspace, workspace + k, x0, y0, z0, u, r, l);
+    decode_Diffuse(matrix, m, n, workspace, workspace + k, workspace);
+}
+
 void decode_Block3(uint8_t *matrix, int m, int n, double &x0, double &y0,double &z0,  double &u, double &r, double &l) {
-    int channel = 1;
-    int t = 200;
-    double pi = 3.1415926;
-    double x1, y1 , z1;
-    int size = m * channel;
-    uint8_t *random_num = (uint8_t *) malloc(2 * size * sizeof(uint8_t));
-    uint8_t *x = random_num;
-    uint8_t *y = random_num + m;
-    for (int i = 1; i <= size + t; ++i) {
-        x1 = u*x0+u*y0;
-        x1 = realmod(x1, 1);
-        y1 = u*y0+r*z0;
-        y1 = realmod(y1, 1);
-        z1 = l*z0+l*x0;
-        z1 = realmod(y1, 1);
+    decode_Block3(matrix, m, n, x0, y0, z0, u, r, l, localWorkspace());
+}
 
-        x0 = x1;
-        y0 = y1;
-        z0 = 01;
-        if (i > t) {
-            *(x + i - t - 1) = round(realmod(x1 * multiplier, 255));
-            *(y + i - t - 1) = round(realmod(y1 * multiplier, 255));
-        }
+// 生成全局块表
+void buildBlockTable3(CHAOS_BLOCK_TABLE &table, uint64_t size, double &x0, double &y0, double &z0, double &u,
+                      double &r, double &l) {
+    table.blockSizeArr = splitBlockSize(size);
+    int blockNum = table.blockNum();
+    table.offsets.resize(blockNum);
+    table.keyStreams.resize(2 * MAX_BLOCKROW * (uint64_t) blockNum);
+    uint64_t loc = 0;
+    for (int i = 0; i < blockNum; i++) {
+        uint8_t *x = table.keyStreams.data() + 2 * MAX_BLOCKROW * (uint64_t) i;
+        keyStream_Block3(table.keyLength(i), x, x + table.keyLength(i), x0, y0, z0, u, r, l);
+        table.offsets[i] = loc;
+        loc += table.blockSize(i);
+    }
+}
+
+void buildBlockTable(CHAOS_BLOCK_TABLE &table, uint64_t size, double &x0, double &y0, double &u, double &r,
+                     int warmup) {
+    table.blockSizeArr = splitBlockSize(size);
+    int blockNum = table.blockNum();
+    table.offsets.resize(blockNum);
+    table.keyStreams.resize(2 * MAX_BLOCKROW * (uint64_t) blockNum);
+    uint64_t loc = 0;
+    for (int i = 0; i < blockNum; i++) {
+        uint8_t *x = table.keyStreams.data() + 2 * MAX_BLOCKROW * (uint64_t) i;
+        keyStream_Block(table.keyLength(i), x, x + table.keyLength(i), x0, y0, u, r, warmup);
+        table.offsets[i] = loc;
+        loc += table.blockSize(i);
+    }
+}
+
+bool initFileMap(const CHAOS_KEY_SCHEDULE &schedule, int mapId, int flags, CHAOS_FILE_MAP &map) {
+    if (mapId != CHAOS_MAP_3D && mapId != CHAOS_MAP_FIXED) {
+        return false;
     }
-    uint8_t *store = (uint8_t *) malloc(7 * n * sizeof(uint8_t));
-    int board = 6 * channel;
-    uint8_t *e1 = store + m;
-    uint8_t *e3 = store + 4 * m;
-    uint8_t *e_value = store + board * m;
-    uint8_t *p_value;
-    uint8_t *c_value_p;
-    memcpy(e1 - m, x, m * sizeof(uint8_t));
-    memcpy(e1, x, m * sizeof(uint8_t));
-    memcpy(e1 + m, x, m * sizeof(uint8_t));
-    memcpy(e3 - m, y, m * sizeof(uint8_t));
-    memcpy(e3, y, m * sizeof(uint8_t));
-    memcpy(e3 + m, y, m * sizeof(uint8_t));
-    int k = 1;
-    int shift;
-    int cnt = 0;
-    for (int i = m - 1; i >= 0; --i) {
-        shift = cnt * k % m;
-        memcpy(e_value, e3 + shift + 1, m * sizeof(uint8_t));
-        if (i > 0) {
-            p_value = matrix + i;
-            c_value_p = matrix + (i - 1);
-            XOR_BC(p_value, e_value, c_value_p, n);
+    map.mapId = mapId;
+    map.blockSeed = (flags & CHAOS_FILE_FLAG_BLOCK_SEED) != 0;
+    // 独立初值的各块仍需各自预热，一次预热只作用于链式模式
+    bool warmOnce = !map.blockSeed && (flags & CHAOS_FILE_FLAG_WARM_ONCE) != 0;
+    map.warmup = warmOnce ? 0 : CHAOS_WARMUP;
+    map.rectBlocks = (flags & CHAOS_FILE_FLAG_RECT_BLOCKS) != 0;
+    map.map3 = warmOnce ? schedule.map3Warm : schedule.map3;
+    map.mapQ = warmOnce ? schedule.mapQWarm : schedule.mapQ;
+    return true;
+}
+
+// 块序号与密钥种子混合为 64 位块种子（splitmix64 的终混函数），只用整数运算
+static uint64_t blockSeedMix(uint64_t seed, uint64_t blockIndex) {
+    uint64_t z = seed + (blockIndex + 1) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// 块 blockIndex 的初值：种子统一取自定点参数（直接来自 sha256 摘要），控制参数不变。
+// 定点映射取奇数避开不动点；三维映射的初值为 32 位整数除以 2^32，转换是精确的
+static void seedBlockQ(const CHAOS_FILE_MAP &map, uint64_t blockIndex, uint32_t &x0, uint32_t &y0) {
+    uint64_t z = blockSeedMix((uint64_t) map.mapQ.x0 << 32 | map.mapQ.y0, blockIndex);
+    x0 = (uint32_t) (z >> 32) | 1;
+    y0 = (uint32_t) z | 1;
+}
+
+static void seedBlock3(const CHAOS_FILE_MAP &map, uint64_t blockIndex, CHAOS_MAP3_PARAMS &p) {
+    uint64_t z = blockSeedMix((uint64_t) map.mapQ.y0 << 32 | map.mapQ.x0, blockIndex);
+    uint64_t w = blockSeedMix(z, blockIndex);
+    p = map.map3;
+    p.x0 = (double) (uint32_t) (z >> 32) / 4294967296.0;
+    p.y0 = (double) (uint32_t) z / 4294967296.0;
+    p.z0 = (double) (uint32_t) (w >> 32) / 4294967296.0;
+}
+
+void keyStream_FileMap(CHAOS_FILE_MAP &map, uint64_t blockIndex, int m, uint8_t *x, uint8_t *y) {
+    if (map.blockSeed) {
+        if (map.mapId == CHAOS_MAP_FIXED) {
+            uint32_t x0, y0;
+            seedBlockQ(map, blockIndex, x0, y0);
+            keyStream_BlockQ(m, x, y, x0, y0, map.mapQ.u, map.mapQ.r);
         } else {
-            p_value = matrix + i;
-            XOR_BC_ZERO(p_value, e_value, n);
+            CHAOS_MAP3_PARAMS p;
+            seedBlock3(map, blockIndex, p);
+            keyStream_Block3(m, x, y, p.x0, p.y0, p.z0, p.u, p.r, p.l);
+        }
+    } else if (map.mapId == CHAOS_MAP_FIXED) {
+        CHAOS_MAPQ_PARAMS &q = map.mapQ;
+        keyStream_BlockQ(m, x, y, q.x0, q.y0, q.u, q.r, map.warmup);
+    } else {
+        CHAOS_MAP3_PARAMS &p = map.map3;
+        keyStream_Block3(m, x, y, p.x0, p.y0, p.z0, p.u, p.r, p.l, map.warmup);
+    }
+}
+
+void buildBlockTableMap(CHAOS_BLOCK_TABLE &table, uint64_t size, CHAOS_FILE_MAP &map, int threads) {
+    table.blockSizeArr = map.rectBlocks ? splitBlockRect(size) : splitBlockSize(size);
+    int blockNum = table.blockNum();
+    table.offsets.resize(blockNum);
+    table.keyStreams.resize(2 * MAX_BLOCKROW * (uint64_t) blockNum);
+    uint64_t loc = 0;
+    for (int i = 0; i < blockNum; i++) {
+        table.offsets[i] = loc;
+        loc += table.blockSize(i);
+    }
+    auto keyStreamX = [&table](int i) {
+        return table.keyStreams.data() + 2 * MAX_BLOCKROW * (uint64_t) i;
+    };
+    if (!map.blockSeed) {
+        for (int i = 0; i < blockNum; i++) {
+            keyStream_FileMap(map, i, table.keyLength(i), keyStreamX(i), keyStreamX(i) + table.keyLength(i));
         }
+        return;
+    }
+    // 各块互不依赖：每个任务取 CHAOS_Q_LANES 个相邻块，定点映射下密钥流长度相同的块交错生成
+    int groups = (blockNum + CHAOS_Q_LANES - 1) / CHAOS_Q_LANES;
+    ThreadPool::shared().parallelFor(groups, threads, [&](int group) {
+        int first = group * CHAOS_Q_LANES;
+        int last = std::min(blockNum, first + CHAOS_Q_LANES);
+        int side = table.keyLength(first);
+        uint8_t *xs[CHAOS_Q_LANES], *ys[CHAOS_Q_LANES];
+        uint32_t x0s[CHAOS_Q_LANES], y0s[CHAOS_Q_LANES];
+        int lanes = 0;
+        for (int i = first; i < last; i++) {
+            if (map.mapId != CHAOS_MAP_FIXED || table.keyLength(i) != side) {
+                keyStream_FileMap(map, i, table.keyLength(i), keyStreamX(i), keyStreamX(i) + table.keyLength(i));
+                continue;
+            }
+            xs[lanes] = keyStreamX(i);
+            ys[lanes] = keyStreamX(i) + side;
+            seedBlockQ(map, i, x0s[lanes], y0s[lanes]);
+            lanes++;
+        }
+        keyStream_LanesQ(lanes, side, xs, ys, x0s, y0s, map.mapQ.u, map.mapQ.r);
+    });
+}
+
+static std::atomic<int> fileMapId(CHAOS_MAP_3D);
+
+int getFileMapId() {
+    return fileMapId.load(std::memory_order_relaxed);
+}
+
+bool setFileMapId(int mapId) {
+    if (mapId != CHAOS_MAP_3D && mapId != CHAOS_MAP_FIXED) {
+        return false;
+    }
+    fileMapId.store(mapId, std::memory_order_relaxed);
+    return true;
+}
+
+static std::atomic<bool> fileBlockSeed(false);
+
+bool getFileBlockSeed() {
+    return fileBlockSeed.load(std::memory_order_relaxed);
+}
+
+void setFileBlockSeed(bool enable) {
+    fileBlockSeed.store(enable, std::memory_order_relaxed);
+}
+
+static std::atomic<bool> fileWarmOnce(false);
+
+bool getFileWarmOnce() {
+    return fileWarmOnce.load(std::memory_order_relaxed);
+}
+
+void setFileWarmOnce(bool enable) {
+    fileWarmOnce.store(enable, std::memory_order_relaxed);
+}
+
+static std::atomic<bool> fileRectBlocks(false);
+
+bool getFileRectBlocks() {
+    return fileRectBlocks.load(std::memory_order_relaxed);
+}
 
-        cnt++;
+void setFileRectBlocks(bool enable) {
+    fileRectBlocks.store(enable, std::memory_order_relaxed);
+}
+
+int newFileFlags() {
+    int flags = CHAOS_FILE_FLAG_BLOCK_CRC | (getFileRectBlocks() ? CHAOS_FILE_FLAG_RECT_BLOCKS : 0);
+    if (getFileBlockSeed()) {
+        return flags | CHAOS_FILE_FLAG_BLOCK_SEED;
+    }
+    return flags | (getFileWarmOnce() ? CHAOS_FILE_FLAG_WARM_ONCE : 0);
+}
+
+// 对缓冲区中的一个 m * n 数据块做扩散，x、y 为块密钥流；剩余数据不足一个整块时，在补齐(填充48)的临时块中处理后只写回有效部分。
+// 密文对明文的依赖只指向行优先顺序中更靠前的位置，因此截断的尾块仍可被正确解密。
+bool cryptBufferBlock(uint8_t *data, uint64_t avail, int m, int n, const uint8_t *x, const uint8_t *y, bool decrypt) {
+    int blockSize = m * n;
+    uint8_t *workspace = localWorkspace();
+    if (workspace == nullptr) {
+        return false;
     }
-    cnt = 0;
-    for (int i = m - 1; i >= 0; --i) {
-        // 循环右移减，循环左移加
-        shift = cnt * k % m;
-        memcpy(e_value, e1 + shift + 1, m * sizeof(uint8_t));
-        if (i > 0) {
-            p_value = matrix + i * n;
-            c_value_p = matrix + (i - 1) * n;
-            XOR_BR(p_value, e_value, c_value_p, n);
+    if (avail >= (uint64_t) blockSize) {
+        if (decrypt) {
+            decode_Diffuse(data, m, n, x, y, workspace);
         } else {
-            p_value = matrix + i * n;
-            XOR_BR_ZERO(p_value, e_value, n);
+            encode_Diffuse(data, m, n, x, y, workspace);
         }
-        cnt++;
+        return true;
     }
-    free(store);
-    free(random_num);
+    BlockPool &pool = BlockPool::local();
+    uint8_t *buffer = pool.acquire();
+    if (buffer == nullptr) {
+        return false;
+    }
+    memcpy(buffer, data, avail);
+    memset(buffer + avail, 48, blockSize - avail);
+    if (decrypt) {
+        decode_Diffuse(buffer, m, n, x, y, workspace);
+    } else {
+        encode_Diffuse(buffer, m, n, x, y, workspace);
+    }
+    memcpy(data, buffer, avail);
+    pool.release(buffer);
+    return true;
+}
+
+bool cryptBlockTable(const CHAOS_BLOCK_TABLE &table, uint8_t *data, uint64_t len, int threads, bool decrypt) {
+    std::atomic<bool> failed(false);
+    ThreadPool::shared().parallelFor(table.blockNum(), threads, [&](int i) {
+        const uint8_t *x = table.keyStream(i);
+        if (!cryptBufferBlock(data + table.offsets[i], len - table.offsets[i], table.rows(i), table.cols(i), x,
+                              x + table.keyLength(i), decrypt)) {
+            failed = true;
+        }
+    });
+    return !failed;
+}
+
+static std::atomic<uint64_t> parallelThreshold(DEFAULT_PARALLEL_SIZE);
+
+uint64_t getParallelThreshold() {
+    return parallelThreshold.load(std::memory_order_relaxed);
 }
 
+void setParallelThreshold(uint64_t size) {
+    parallelThreshold.store(std::max(size, (uint64_t) MIN_PARALLEL_SIZE), std::memory_order_relaxed);
+}
 
 // 计算CRC32
 //std::string calculateCRC32(std::string emstr) {
@@ -506,10 +1064,44 @@ void decode_Block3(uint8_t *matrix, int m, int n, double &x0, double &y0,double
 //    return stream.str();
 //}
 
-std::string calculateCRC32(const std::string& emstr) {
+// 超过该长度的数据按 CRC32_CHUNK_SIZE 分段并行计算 CRC32，再按顺序合并
+#define CRC32_PARALLEL_SIZE (16 * 1024 * 1024)
+#define CRC32_CHUNK_SIZE (4 * 1024 * 1024)
+
+static void addCRC32(CRC32 &crc32, const char *data, size_t len) {
+    if (len < CRC32_PARALLEL_SIZE) {
+        crc32.add(data, len);
+        return;
+    }
+    int chunkNum = (int) ((len + CRC32_CHUNK_SIZE - 1) / CRC32_CHUNK_SIZE);
+    std::vector<CRC32> chunks(chunkNum);
+    ThreadPool::shared().parallelFor(chunkNum, 0, [&](int i) {
+        size_t offset = (size_t) i * CRC32_CHUNK_SIZE;
+        chunks[i].add(data + offset, std::min((size_t) CRC32_CHUNK_SIZE, len - offset));
+    });
+    for (int i = 0; i < chunkNum; i++) {
+        size_t offset = (size_t) i * CRC32_CHUNK_SIZE;
+        crc32.addHash(chunks[i], std::min((size_t) CRC32_CHUNK_SIZE, len - offset));
+    }
+}
+
+static std::string calculateCRC32(const char *data, size_t len) {
     CRC32 crc32;
+    addCRC32(crc32, data, len);
+    return crc32.getHash();
+}
+
+uint32_t bufferCrc32(const uint8_t *data, uint64_t len) {
+    CRC32 crc32;
+    addCRC32(crc32, reinterpret_cast<const char *>(data), (size_t) len);
+    unsigned char hash[CRC32::HashBytes];
+    crc32.getHash(hash);
+    return ((uint32_t) hash[0] << 24) | ((uint32_t) hash[1] << 16) | ((uint32_t) hash[2] << 8) | hash[3];
+}
+
+std::string calculateCRC32(const std::string& emstr) {
 //    std::cout << "CRC32计算中..." << std::endl;
-    return crc32(emstr);
+    return calculateCRC32(emstr.data(), emstr.size());
 }
 
 // 校验CRC32
@@ -523,83 +1115,235 @@ std::string calculateCRC32(const std::string& emstr) {
 //    }
 //}
 
-bool judgeCRC32(const std::string& emstr) {
+bool judgeCRC32(std::string_view emstr) {
     if (emstr.size() < 8)
         return false;
 
-    std::string data = emstr.substr(0, emstr.size() - 8);
-    std::string crc  = emstr.substr(emstr.size() - 8);
+    // 直接对原串的前 size - 8 字节计算，不复制数据部分
+    return emstr.substr(emstr.size() - 8) == calculateCRC32(emstr.data(), emstr.size() - 8);
+}
+
+// 字符串密文的分块加解密：整块直接在 data 上原地处理，只有末尾不足一块的部分经过块缓冲按 48 补齐
+// warmup 为每块的预热次数，一次预热模式下 params 为预热状态、warmup 为 0
+// 工作区或块缓冲申请失败时返回 false，data 的内容不确定
+static bool cryptStrBlocks(uint8_t *data, uint64_t len, const CHAOS_MAP2_PARAMS &params, int warmup, bool decrypt) {
+    double x0 = params.x0, y0 = params.y0, u = params.u, r = params.r;
+    // 达到并行阈值时按块表并行，混沌状态在生成块表时按块顺序串行推进，结果不变
+    if (len >= getParallelThreshold()) {
+        CHAOS_BLOCK_TABLE table;
+        buildBlockTable(table, len, x0, y0, u, r, warmup);
+        return cryptBlockTable(table, data, len, 0, decrypt);
+    }
+    std::vector<int> blockSizeArr = splitBlockSize(len);
+    int indexAll = blockSizeArr.size();
+    uint8_t *workspace = localWorkspace();
+    if (workspace == nullptr) {
+        return false;
+    }
+    uint64_t loc = 0;
+    for (int blockIndex = 0; blockIndex < indexAll; blockIndex = blockIndex + 2) {
+        int currBlockSize = blockSizeArr[blockIndex];
+        int side = blockSizeArr[blockIndex + 1];
+        uint64_t realSize = std::min((uint64_t) currBlockSize, len - loc);
+        uint8_t *block = data + loc;
+        uint8_t *buffer = nullptr;
+        if (realSize < (uint64_t) currBlockSize) {
+            buffer = BlockPool::local().acquire();
+            if (buffer == nullptr) {
+                return false;
+            }
+            memcpy(buffer, block, realSize);
+            memset(buffer + realSize, 48, currBlockSize - realSize);
+            block = buffer;
+        }
+        keyStream_Block(side, workspace, workspace + side, x0, y0, u, r, warmup);
+        if (decrypt) {
+            decode_Diffuse(block, side, side, workspace, workspace + side, workspace);
+        } else {
+            encode_Diffuse(block, side, side, workspace, workspace + side, workspace);
+        }
+        if (buffer != nullptr) {
+            memcpy(data + loc, buffer, realSize);
+            BlockPool::local().release(buffer);
+        }
+        loc += currBlockSize;
+    }
+    return true;
+}
+
+// CHAOS_STR_BINARY 中长度字段的字节数
+static int strCipherLengthBytes(uint64_t len) {
+    int n = 1;
+    while (n < 8 && (len >> (8 * n)) != 0) {
+        n++;
+    }
+    return n;
+}
+
+// CHAOS_STR_BINARY 的总长度
+static uint64_t strCipherPackedLength(uint64_t len) {
+    return 1 + strCipherLengthBytes(len) + len + 4;
+}
+
+// 长度字段字节数 n 的最高位：CHAOS_STR_WARM_ONCE 模式的密文，旧版本读到后按格式错误拒绝
+#define STR_WARM_ONCE_MARK 0x80
+
+// CHAOS_STR_BINARY：1 字节长度字段字节数 n + n 字节大端密文长度 + 密文 + 4 字节大端 CRC32
+// 密文已位于 out + 1 + n，这里补上前后的长度字段与 CRC32
+static void packStrCipher(uint8_t *out, uint64_t len, bool warmOnce) {
+    int n = strCipherLengthBytes(len);
+    out[0] = (uint8_t) (n | (warmOnce ? STR_WARM_ONCE_MARK : 0));
+    for (int i = 0; i < n; i++) {
+        out[1 + i] = (uint8_t) (len >> (8 * (n - 1 - i)));
+    }
+    uint32_t crc = blockCrc32(out, 1 + n + len);
+    for (int i = 0; i < 4; i++) {
+        out[1 + n + len + i] = (uint8_t) (crc >> (8 * (3 - i)));
+    }
+}
+
+// 解析 CHAOS_STR_BINARY / CHAOS_STR_BASE64 密文，成功时 cipher 只包含密文字节，warmOnce 为密文记录的预热模式
+static bool unpackStrCipher(std::string_view input, int format, std::string &cipher, bool &warmOnce,
+                            std::string &errorMsg) {
+    size_t len = input.length();
+    if (format == CHAOS_STR_BASE64) {
+        cipher.resize(len / 4 * 3);
+        if (!base64Decode(input.data(), len, reinterpret_cast<uint8_t *>(&cipher[0]), len)) {
+            errorMsg = "密文格式错误,无法解密";
+            return false;
+        }
+        cipher.resize(len);
+    } else {
+        cipher.assign(input.data(), len);
+    }
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(cipher.data());
+    int n = len > 0 ? data[0] & ~STR_WARM_ONCE_MARK : 0;
+    warmOnce = len > 0 && (data[0] & STR_WARM_ONCE_MARK) != 0;
+    if (n < 1 || n > 8 || len < (size_t) (1 + n + 4)) {
+        errorMsg = "密文格式错误,无法解密";
+        return false;
+    }
+    uint64_t cipherLen = 0;
+    for (int i = 0; i < n; i++) {
+        cipherLen = cipherLen << 8 | data[1 + i];
+    }
+    if (cipherLen != len - 1 - n - 4) {
+        errorMsg = "密文格式错误,无法解密";
+        return false;
+    }
+    uint32_t crc = 0;
+    for (int i = 0; i < 4; i++) {
+        crc = crc << 8 | data[len - 4 + i];
+    }
+    if (blockCrc32(data, len - 4) != crc) {
+        errorMsg = "密文校验失败,无法解密";
+        return false;
+    }
+    // 去掉长度字段与 CRC32，在原分配内移动
+    cipher.erase(0, 1 + n);
+    cipher.resize(cipherLen);
+    return true;
+}
 
-    return calculateCRC32(data) == crc;
+// 十六进制数字串转整数，出现非十六进制字符或超过 16 位时返回 false
+static bool parseHexNumber(std::string_view text, uint64_t &value) {
+    if (text.empty() || text.length() > 16) {
+        return false;
+    }
+    value = 0;
+    for (char c: text) {
+        int digit = hextoDec(c);
+        if (digit < 0) {
+            return false;
+        }
+        value = value << 4 | (uint64_t) digit;
+    }
+    return true;
 }
 
+// 原地 Base64 展开时，输入放在输出缓冲区末尾，需要的额外余量，见 base64Encode
+#define BASE64_INPLACE_SLACK 64
+
 /**
  * 加密
  * @param key  密钥 8~256
  * @param inputStr 待加密字符串
  * @return
  */
-CHAOS_OPERATION_RESULT encryptStrWithKey(std::string key, std::string inputStr) {
-    // 初始化结果为失败，错误信息为空
-    CHAOS_OPERATION_RESULT result = {0, "", ""};
+CHAOS_OPERATION_RESULT encryptStrWithKey(std::string_view key, std::string_view inputStr, int format) {
     // 必备参数检查
     // 1.密钥
     if (key.length() < 8 || key.length() > 256) {
+        CHAOS_OPERATION_RESULT result = {0, "", ""};
         result.errorMsg = "Key must be between 8 and 256 characters.";
         return result;  // 如果key的长度不在8到256之间，返回错误信息
     }
+    return encryptStrWithSchedule(getKeySchedule(key), inputStr, format);
+}
+
+CHAOS_OPERATION_RESULT
+encryptStrWithSchedule(const CHAOS_KEY_SCHEDULE &schedule, std::string_view inputStr, int format) {
+    // 初始化结果为失败，错误信息为空
+    CHAOS_OPERATION_RESULT result = {0, "", ""};
     // 2.输入参数
     if (inputStr.empty()) {  // 如果inputstr为空字符串
         result.errorMsg = "Input string cannot be empty.";
         return result;  // 返回错误信息
     }
-    double x0, y0, u, r;
-    std::string hash = sha256_hash(key);
-    generateRandom(hash, x0, y0, u, r);
+    bool warmOnce = (format & CHAOS_STR_WARM_ONCE) != 0;
+    format &= ~CHAOS_STR_WARM_ONCE;
+    if (format < CHAOS_STR_HEX || format > CHAOS_STR_BASE64 || (warmOnce && format == CHAOS_STR_HEX)) {
+        result.errorMsg = "Unsupported output format.";
+        return result;
+    }
+    const CHAOS_MAP2_PARAMS &params = warmOnce ? schedule.map2Warm : schedule.map2;
+    int warmup = warmOnce ? 0 : CHAOS_WARMUP;
+    // 结果只分配一次：明文复制到结果中密文所在的位置，原地加密后再原地展开为目标格式
     uint64_t strLen = inputStr.length();
-    unsigned char *dstStr = (unsigned char *) std::malloc((strLen + 1) * sizeof(unsigned char));
-    strcpy(reinterpret_cast<char *>(dstStr), inputStr.c_str());
-    std::vector<int> blockSizeArr = splitBlockSize((uint64_t) strLen);
-    int blockIndex = 0;
-    int indexAll = blockSizeArr.size();
-    int loc = 0;
-    for (blockIndex = 0; blockIndex < indexAll; blockIndex = blockIndex + 2) {
-        // 读取当前数据块的字节数据
-        int currBlockSize = blockSizeArr[blockIndex];
-        unsigned char *buffer = (unsigned char *) malloc(currBlockSize * sizeof(unsigned char));
-        memset(buffer, 48, currBlockSize);
-        if (loc + currBlockSize + 1 > strLen) {
-            memcpy(buffer, dstStr + loc, (strLen - loc) * sizeof(unsigned char));
-            encode_Block(buffer, blockSizeArr[blockIndex + 1], blockSizeArr[blockIndex + 1], x0, y0, u, r);
-            memcpy(dstStr + loc, buffer, (strLen - loc) * sizeof(unsigned char));
-            loc += currBlockSize;
-        } else {
-            memcpy(buffer, dstStr + loc, currBlockSize * sizeof(unsigned char));
-            encode_Block(buffer, blockSizeArr[blockIndex + 1], blockSizeArr[blockIndex + 1], x0, y0, u, r);
-            memcpy(dstStr + loc, buffer, currBlockSize * sizeof(unsigned char));
-            loc += currBlockSize;
-        }
-        free(buffer);
-    }
-    std::string res = "";
-    for (uint64_t i = 0; i < strLen; i++) {
-        std::stringstream ss;
-        ss << std::uppercase << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(dstStr[i]);
-        std::string m = ss.str();
-        res += ss.str();
-    }
-    // 密文长度
-    std::string emLenStr = "";
-    uint64_t emLen = res.length();
-    Len_t lenBit;
-    lenBit.len64 = emLen;
-    getEmLenStr(lenBit, emLenStr);
-    res = emLenStr + res;
-    res = res + calculateCRC32(res);
-    free(dstStr);
+    std::string &res = result.result;
+    if (format == CHAOS_STR_HEX) {
+        // 密文长度
+        std::string emLenStr = "";
+        uint64_t emLen = 2 * strLen;
+        Len_t lenBit;
+        lenBit.len64 = emLen;
+        getEmLenStr(lenBit, emLenStr);
+        // 长度前缀 + 十六进制密文 + CRC32；密文先放在十六进制区域的后半部分
+        size_t prefix = emLenStr.length();
+        res.reserve(prefix + emLen + 8);
+        res.resize(prefix + emLen);
+        memcpy(&res[0], emLenStr.data(), prefix);
+        uint8_t *cipher = reinterpret_cast<uint8_t *>(&res[prefix + strLen]);
+        memcpy(cipher, inputStr.data(), strLen);
+        if (!cryptStrBlocks(cipher, strLen, params, warmup, false)) {
+            res.clear();
+            result.errorMsg = "Out of memory.";
+            return result;
+        }
+        hexEncode(cipher, strLen, &res[prefix]);
+        res += calculateCRC32(res);
+    } else {
+        uint64_t packedLen = strCipherPackedLength(strLen);
+        size_t outLen = format == CHAOS_STR_BASE64 ? base64EncodedLength(packedLen) : packedLen;
+        size_t bufferLen = format == CHAOS_STR_BASE64 ? outLen + BASE64_INPLACE_SLACK : outLen;
+        res.resize(bufferLen);
+        // 二进制格式放在缓冲区末尾，Base64 从头部向后展开
+        uint8_t *packed = reinterpret_cast<uint8_t *>(&res[bufferLen - packedLen]);
+        uint8_t *cipher = packed + 1 + strCipherLengthBytes(strLen);
+        memcpy(cipher, inputStr.data(), strLen);
+        if (!cryptStrBlocks(cipher, strLen, params, warmup, false)) {
+            res.clear();
+            result.errorMsg = "Out of memory.";
+            return result;
+        }
+        packStrCipher(packed, strLen, warmOnce);
+        if (format == CHAOS_STR_BASE64) {
+            base64Encode(packed, packedLen, &res[0]);
+            res.resize(outLen);
+        }
+    }
     result.success = 1;
-    result.result = res;
-    return std::move(result);
+    return result;
 }
 
 /**
@@ -608,74 +1352,197 @@ CHAOS_OPERATION_RESULT encryptStrWithKey(std::string key, std::string inputStr)
  * @param inputStr 待解密字符串
  * @return
  */
-CHAOS_OPERATION_RESULT decryptStrWithKey(const std::string& key, const std::string& inputStr) {
-    // 初始化结果为失败，错误信息为空
-    CHAOS_OPERATION_RESULT result = {0, "", ""};
+CHAOS_OPERATION_RESULT decryptStrWithKey(std::string_view key, std::string_view inputStr, int format) {
     // 必备参数检查
     // 1.密钥
     if (key.length() < 8 || key.length() > 256) {
+        CHAOS_OPERATION_RESULT result = {0, "", ""};
         result.errorMsg = "Key must be between 8 and 256 characters.";
         return result;  // 如果key的长度不在8到256之间，返回错误信息
     }
+    return decryptStrWithSchedule(getKeySchedule(key), inputStr, format);
+}
+
+CHAOS_OPERATION_RESULT
+decryptStrWithSchedule(const CHAOS_KEY_SCHEDULE &schedule, std::string_view inputStr, int format) {
+    // 初始化结果为失败，错误信息为空
+    CHAOS_OPERATION_RESULT result = {0, "", ""};
     // 2.输入参数
     if (inputStr.empty()) {  // 如果inputstr为空字符串
         result.errorMsg = "Input string cannot be empty.";
         return result;  // 返回错误信息
     }
-    if (judgeCRC32(inputStr)) {
-//        std::cout << "CRC verification success" << std::endl;
-        double x0, y0, u, r;
-        std::string hash = sha256_hash(key);
-        generateRandom(hash, x0, y0, u, r);
+    // 预热模式由密文自身记录，调用方带上 CHAOS_STR_WARM_ONCE 也一样
+    format &= ~CHAOS_STR_WARM_ONCE;
+    if (format < CHAOS_STR_HEX || format > CHAOS_STR_BASE64) {
+        result.errorMsg = "Unsupported output format.";
+        return result;
+    }
+    // 密文解码到结果中，再原地解密
+    std::string &res = result.result;
+    bool warmOnce = false;
+    if (format != CHAOS_STR_HEX) {
+        if (!unpackStrCipher(inputStr, format, res, warmOnce, result.errorMsg)) {
+            res.clear();
+            return result;
+        }
+    } else if (judgeCRC32(inputStr)) {
         // 除crc32外的前面的文本
-        std::string subEmstr = inputStr.substr(0, inputStr.length() - 8);
-        int len8 = static_cast<int>(std::stoi(subEmstr.substr(0, 2), 0, 16));
+        uint64_t subLen = inputStr.length() - 8;
+        uint64_t len8 = 0;
+        uint64_t len64 = 0;
         // len8/8 = char num; char num * 2 = hex num;
-        uint64_t len64 = static_cast<uint64_t>(std::stoi(subEmstr.substr(2, len8 / 4), 0, 16));
-        // 密文文本
-        std::string EmStr = subEmstr.substr(2 + len8 / 4, len64);
-        uint64_t strLen = len64;
-        strLen = strLen / 2;
-        auto *dstStr = (unsigned char *) malloc((strLen + 1) * sizeof(unsigned char));
-        // 每两个hex转换为unsigned char
-        for (int i = 0; i < strLen; i++) {
-            std::string byte_string = EmStr.substr(i * 2, 2);
-            dstStr[i] = static_cast<unsigned char>(std::stoi(byte_string, 0, 16));
-        }
-        dstStr[strLen] = '\0';
-
-        std::vector<int> blockSizeArr = splitBlockSize((uint64_t) strLen);
-        int blockIndex = 0;
-        int indexAll = blockSizeArr.size();
-        int loc = 0;
-        for (blockIndex = 0; blockIndex < indexAll; blockIndex = blockIndex + 2) {
-            // 读取当前数据块的字节数据
-            int currBlockSize = blockSizeArr[blockIndex];
-            auto *buffer = (unsigned char *) malloc(currBlockSize * sizeof(unsigned char));
-            memset(buffer, 48, currBlockSize);
-            if (loc + currBlockSize + 1 > strLen) {
-                memcpy(buffer, dstStr + loc, (strLen - loc) * sizeof(unsigned char));
-                decode_Block(buffer, blockSizeArr[blockIndex + 1], blockSizeArr[blockIndex + 1], x0, y0, u, r);
-                memcpy(dstStr + loc, buffer, (strLen - loc) * sizeof(unsigned char));
-            } else {
-                memcpy(buffer, dstStr + loc, currBlockSize * sizeof(unsigned char));
-                decode_Block(buffer, blockSizeArr[blockIndex + 1], blockSizeArr[blockIndex + 1], x0, y0, u, r);
-                memcpy(dstStr + loc, buffer, currBlockSize * sizeof(unsigned char));
-                loc += currBlockSize;
-            }
-            free(buffer);
+        if (subLen < 2 || !parseHexNumber(inputStr.substr(0, 2), len8) || 2 + len8 / 4 > subLen ||
+            !parseHexNumber(inputStr.substr(2, len8 / 4), len64)) {
+            result.errorMsg = "密文格式错误,无法解密";
+            return result;
+        }
+        // 密文文本直接从输入中解码，不再复制
+        uint64_t emOffset = 2 + len8 / 4;
+        if (len64 > subLen - emOffset) {
+            result.errorMsg = "密文格式错误,无法解密";
+            return result;
+        }
+        res.resize(len64 / 2);
+        if (!hexDecode(inputStr.data() + emOffset, len64 / 2 * 2, reinterpret_cast<uint8_t *>(&res[0]))) {
+            res.clear();
+            result.errorMsg = "密文格式错误,无法解密";
+            return result;
         }
-        std::string res(reinterpret_cast<char *>(dstStr));
-        result.success = 1;
-        result.result = res;
-        free(dstStr);
-        return std::move(result);
     } else {
-        result.success = 0;
         result.errorMsg = "密文校验失败,无法解密";
-        return std::move(result);
+        return result;
+    }
+    if (!cryptStrBlocks(reinterpret_cast<uint8_t *>(&res[0]), res.length(),
+                        warmOnce ? schedule.map2Warm : schedule.map2, warmOnce ? 0 : CHAOS_WARMUP, true)) {
+        res.clear();
+        result.errorMsg = "内存不足,无法解密";
+        return result;
+    }
+    result.success = 1;
+    return result;
+}
+
+CHAOS_OPERATION_RESULT benchmarkWarmup(int rounds) {
+    CHAOS_OPERATION_RESULT result = {0, "", ""};
+    if (rounds <= 0) {
+        result.errorMsg = "Invalid benchmark parameters.";
+        return result;
     }
+    const CHAOS_KEY_SCHEDULE schedule = getKeySchedule("benchmarkWarmup");
+    // 短消息，以及 1 MiB 整块加上 100 字节尾部（尾部拆成边长递减的小块）
+    const uint64_t sizes[] = {16, 100, 1024, 16384, 1048576 + 100};
+    std::string speeds = "";
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t len: sizes) {
+        std::string plain(len, '\0');
+        for (uint64_t i = 0; i < len; i++) {
+            plain[i] = (char) (i * 131 + 7);
+        }
+        // 较长的数据按长度减少重复次数
+        int runs = (int) std::max<uint64_t>(1, (uint64_t) rounds * 1024 / std::max<uint64_t>(len, 1024));
+        double micros[2];
+        for (int mode = 0; mode < 2; mode++) {
+            int format = mode == 0 ? CHAOS_STR_BINARY : CHAOS_STR_BINARY | CHAOS_STR_WARM_ONCE;
+            auto runStart = std::chrono::steady_clock::now();
+            for (int i = 0; i < runs; i++) {
+                encryptStrWithSchedule(schedule, plain, format);
+            }
+            auto runEnd = std::chrono::steady_clock::now();
+            micros[mode] = std::chrono::duration<double, std::micro>(runEnd - runStart).count() / runs;
+        }
+        if (!speeds.empty()) {
+            speeds += "|";
+        } else {
+            result.speed = micros[1] > 0 ? static_cast<float>(micros[0] / micros[1]) : 0;
+        }
+        speeds += std::to_string(len) + ":" + std::to_string(micros[0]) + ":" + std::to_string(micros[1]);
+    }
+    auto end = std::chrono::steady_clock::now();
+    result.mill = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    result.result = speeds;
+    result.success = 1;
+    return result;
+}
+
+// 内存缓冲区加解密的公共部分
+static CHAOS_OPERATION_RESULT
+cryptBufferWithSchedule(const CHAOS_KEY_SCHEDULE &schedule, const uint8_t *input, uint8_t *output, uint64_t len,
+                        bool decrypt) {
+    // 初始化结果为失败，错误信息为空
+    CHAOS_OPERATION_RESULT result = {0, "", ""};
+    if (input == nullptr || output == nullptr || len == 0) {
+        result.errorMsg = "Input buffer cannot be empty.";
+        return result;
+    }
+    auto start = std::chrono::steady_clock::now();
+    if (output != input) {
+        memmove(output, input, len);
+    }
+    const CHAOS_MAP3_PARAMS &p = schedule.map3;
+    double x0 = p.x0, y0 = p.y0, z0 = p.z0, u = p.u, r = p.r, l = p.l;
+
+    bool ok = true;
+    if (len >= getParallelThreshold()) {
+        CHAOS_BLOCK_TABLE table;
+        buildBlockTable3(table, len, x0, y0, z0, u, r, l);
+        ok = cryptBlockTable(table, output, len, 0, decrypt);
+    } else {
+        std::vector<int> blockSizeArr = splitBlockSize(len);
+        int indexAll = blockSizeArr.size();
+        // 密钥流写入工作区前部，扩散密钥使用其后部
+        uint8_t *random_num = localWorkspace();
+        ok = random_num != nullptr;
+        uint64_t loc = 0;
+        for (int blockIndex = 0; ok && blockIndex < indexAll; blockIndex = blockIndex + 2) {
+            int side = blockSizeArr[blockIndex + 1];
+            keyStream_Block3(side, random_num, random_num + side, x0, y0, z0, u, r, l);
+            ok = cryptBufferBlock(output + loc, len - loc, side, side, random_num, random_num + side, decrypt);
+            loc += blockSizeArr[blockIndex];
+        }
+    }
+    if (!ok) {
+        result.errorMsg = "Out of memory.";
+        return result;
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    auto durationMill = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    result.mill = durationMill.count();
+    result.size = len;
+    result.speed = durationMill.count() > 0
+                   ? static_cast<float>(len) * 8 / 1024 / 1024 / 1024 / static_cast<float>(durationMill.count()) * 1000
+                   : 0;
+    result.success = 1;
+    return result;
+}
+
+static CHAOS_OPERATION_RESULT
+cryptBufferWithKey(const std::string &key, const uint8_t *input, uint8_t *output, uint64_t len, bool decrypt) {
+    if (key.length() < 8 || key.length() > 256) {
+        CHAOS_OPERATION_RESULT result = {0, "", ""};
+        result.errorMsg = "Key must be between 8 and 256 characters.";
+        return result;
+    }
+    return cryptBufferWithSchedule(getKeySchedule(key), input, output, len, decrypt);
+}
+
+CHAOS_OPERATION_RESULT encryptBufferWithKey(const std::string &key, const uint8_t *input, uint8_t *output, uint64_t len) {
+    return cryptBufferWithKey(key, input, output, len, false);
+}
+
+CHAOS_OPERATION_RESULT decryptBufferWithKey(const std::string &key, const uint8_t *input, uint8_t *output, uint64_t len) {
+    return cryptBufferWithKey(key, input, output, len, true);
+}
+
+CHAOS_OPERATION_RESULT
+encryptBufferWithSchedule(const CHAOS_KEY_SCHEDULE &schedule, const uint8_t *input, uint8_t *output, uint64_t len) {
+    return cryptBufferWithSchedule(schedule, input, output, len, false);
+}
 
+CHAOS_OPERATION_RESULT
+decryptBufferWithSchedule(const CHAOS_KEY_SCHEDULE &schedule, const uint8_t *input, uint8_t *output, uint64_t len) {
+    return cryptBufferWithSchedule(schedule, input, output, len, true);
 }
 
 //
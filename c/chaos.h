@@ -7,6 +7,7 @@
 #include <vector>
 #include <chrono>
 #include <string>
+#include <string_view>
 #include <cmath>
 #include <cstring>
 #include <algorithm>
@@ -17,8 +18,13 @@
 #define MAX_BLOCKCOL 1024
 #define MIN_BLOCKROW 4
 #define MIN_BLOCKCOL 4
-// 最小并行加密大小
+// 最小并行加密大小：内存字符串与缓冲区的并行阈值不能低于该值
 #define MIN_PARALLEL_SIZE 1024
+// 默认并行阈值：内存字符串与缓冲区达到该长度时，单线程接口自动改用线程池按全局块表并行（见 benchmarkParallelCrossover）
+#define DEFAULT_PARALLEL_SIZE (4 * 1024 * 1024)
+// 单个块加解密的工作区：前 2 * MAX_BLOCKROW 字节存放密钥流 x、y，其后 6 * MAX_BLOCKROW 字节存放扩散密钥
+#define CHAOS_WORKSPACE_STORE (2 * MAX_BLOCKROW)
+#define CHAOS_WORKSPACE_SIZE (8 * MAX_BLOCKROW)
 
 typedef union {
     uint64_t len64;
@@ -41,12 +47,61 @@ struct CHAOS_OPERATION_RESULT {
     float speed;
 };
 
+// 块密钥流 x、y 各自的长度：取行数、列数中较大的一个，方块即为边长
+inline int blockKeyLength(int m, int n) {
+    return m > n ? m : n;
+}
+
+// 全局块表：整段数据按 splitBlockSize（或 splitBlockRect）分块一次，块 i 的密钥流由按块顺序串行推进的混沌状态预先生成，
+// 之后各块的扩散互不依赖，可以任意顺序、由任意线程完成，结果与单线程逐字节一致
+struct CHAOS_BLOCK_TABLE {
+    // 块大小、块列数交替排列，同 splitBlockSize / splitBlockRect
+    std::vector<int> blockSizeArr;
+    // 块在数据中的起始偏移
+    std::vector<uint64_t> offsets;
+    // 块密钥流 x|y，每块占 2 * MAX_BLOCKROW 字节
+    std::vector<uint8_t> keyStreams;
+
+    int blockNum() const {
+        return static_cast<int>(blockSizeArr.size() / 2);
+    }
+
+    int blockSize(int i) const {
+        return blockSizeArr[2 * i];
+    }
+
+    int rows(int i) const {
+        return blockSizeArr[2 * i] / blockSizeArr[2 * i + 1];
+    }
+
+    int cols(int i) const {
+        return blockSizeArr[2 * i + 1];
+    }
+
+    // 块 i 的密钥流 x、y 各自的长度
+    int keyLength(int i) const {
+        return blockKeyLength(rows(i), cols(i));
+    }
+
+    const uint8_t *keyStream(int i) const {
+        return keyStreams.data() + 2 * MAX_BLOCKROW * (uint64_t) i;
+    }
+};
+
 // ================================================== 通用的工具类 ==================================================
 
 int multBitXor(std::string str);
 
+// 方块分块：块大小、块边长交替排列，依次取不超过剩余长度的最大方块，最后不足 MIN_BLOCKROW * MIN_BLOCKCOL 的部分补齐为一个最小块
 std::vector<int> splitBlockSize(uint64_t size);
 
+// 矩形分块（CHAOS_FILE_FLAG_RECT_BLOCKS）：块大小、块列数交替排列，整块均为 MAX_BLOCKROW * MAX_BLOCKCOL，
+// 剩余部分补齐为一个接近正方形的 m * n 尾块（m <= n，填充不足一行）
+std::vector<int> splitBlockRect(uint64_t size);
+
+// 文件的分块，按文件头标志选择 splitBlockRect 或 splitBlockSize
+std::vector<int> splitFileBlocks(uint64_t size, int flags);
+
 std::string GetHardWareInfo();
 
 std::string GetCurrentTimestamp();
@@ -61,6 +116,101 @@ void encode_Block(uint8_t *matrix, int m, int n, double &x0, double &y0, double
 
 void encode_Block3(uint8_t *matrix, int m, int n, double &x0, double &y0, double &z0, double &u, double &r, double &l);
 
+// 以下带 workspace 的版本使用调用方提供的 CHAOS_WORKSPACE_SIZE 字节工作区，不再申请内存；
+// 不带 workspace 的版本使用当前线程的工作区 localWorkspace()
+void decode_Block(uint8_t *matrix, int m, int n, double &x0, double &y0, double &u, double &r, uint8_t *workspace);
+
+void decode_Block3(uint8_t *matrix, int m, int n, double &x0, double &y0, double &z0, double &u, double &r, double &l,
+                   uint8_t *workspace);
+
+void encode_Block(uint8_t *matrix, int m, int n, double &x0, double &y0, double &u, double &r, uint8_t *workspace);
+
+void encode_Block3(uint8_t *matrix, int m, int n, double &x0, double &y0, double &z0, double &u, double &r, double &l,
+                   uint8_t *workspace);
+
+// 生成密钥流之前丢弃的混沌迭代次数（预热），原有模式下每个块都重新预热
+#define CHAOS_WARMUP 200
+
+/**
+ * 生成块密钥流 x、y（各 m 字节）并推进混沌状态；m 为 0 时只做预热
+ * @param warmup 预热次数，状态已经预热过（一次预热模式）时为 0
+ */
+void keyStream_Block(int m, uint8_t *x, uint8_t *y, double &x0, double &y0, double &u, double &r,
+                     int warmup = CHAOS_WARMUP);
+
+void keyStream_Block3(int m, uint8_t *x, uint8_t *y, double &x0, double &y0, double &z0, double &u, double &r, double &l,
+                      int warmup = CHAOS_WARMUP);
+
+/**
+ * 定点整数版本的二维正弦混沌映射（CHAOS_MAP_FIXED），状态为 Q0.32 小数，sin 由整数多项式生成的表插值近似，
+ * 只有整数运算，在任意平台与编译选项（包括 -ffast-math）下结果逐位一致
+ */
+void keyStream_BlockQ(int m, uint8_t *x, uint8_t *y, uint32_t &x0, uint32_t &y0, uint32_t u, uint32_t r,
+                      int warmup = CHAOS_WARMUP);
+
+// keyStream_LanesQ 一组交错推进的轨迹数
+#define CHAOS_Q_LANES 4
+
+/**
+ * 定点映射多路交错：lanes 条互不相关的轨迹（各自的 x0[i]、y0[i]，共用 u、r）同步推进，
+ * 隐藏单条递推的乘法与查表延迟，结果与逐条调用 keyStream_BlockQ 完全相同
+ * @param m 每条轨迹输出的密钥流长度
+ * @param x、y 第 i 条轨迹的密钥流写入 x[i]、y[i]
+ */
+void keyStream_LanesQ(int lanes, int m, uint8_t *const *x, uint8_t *const *y, uint32_t *x0, uint32_t *y0, uint32_t u,
+                      uint32_t r);
+
+void encode_Diffuse(uint8_t *matrix, int m, int n, const uint8_t *x, const uint8_t *y);
+
+void decode_Diffuse(uint8_t *matrix, int m, int n, const uint8_t *x, const uint8_t *y);
+
+// m * n 块的扩散，x、y 各 blockKeyLength(m, n) 字节，行列数不同的块同样适用。
+// x、y 可以位于 workspace 的密钥流区，扩散只使用 workspace + CHAOS_WORKSPACE_STORE 之后的部分
+void encode_Diffuse(uint8_t *matrix, int m, int n, const uint8_t *x, const uint8_t *y, uint8_t *workspace);
+
+void decode_Diffuse(uint8_t *matrix, int m, int n, const uint8_t *x, const uint8_t *y, uint8_t *workspace);
+
+/**
+ * 生成 size 字节数据的全局块表（三维混沌系统），混沌状态推进到最后一个块之后
+ */
+void buildBlockTable3(CHAOS_BLOCK_TABLE &table, uint64_t size, double &x0, double &y0, double &z0, double &u,
+                      double &r, double &l);
+
+/**
+ * 生成 size 字节数据的全局块表（二维混沌系统，字符串加解密使用），混沌状态推进到最后一个块之后
+ */
+void buildBlockTable(CHAOS_BLOCK_TABLE &table, uint64_t size, double &x0, double &y0, double &u, double &r,
+                     int warmup = CHAOS_WARMUP);
+
+// 块缓冲或工作区申请失败时返回 false，data 未被修改
+bool cryptBufferBlock(uint8_t *data, uint64_t avail, int m, int n, const uint8_t *x, const uint8_t *y, bool decrypt);
+
+/**
+ * 按块表用线程池并行加解密 data 的 len 字节，结果与逐块串行处理完全一致
+ * @param threads 最多使用的线程数，<= 0 表示线程池全部线程
+ * @return 任一块申请块缓冲失败时返回 false，此时 data 中只有部分块被处理
+ */
+bool cryptBlockTable(const CHAOS_BLOCK_TABLE &table, uint8_t *data, uint64_t len, int threads, bool decrypt);
+
+// 当前并行阈值
+uint64_t getParallelThreshold();
+
+/**
+ * 设置内存字符串与缓冲区的并行阈值，低于该长度的数据仍按原来的方式逐块串行处理
+ * @param size 小于 MIN_PARALLEL_SIZE 时按 MIN_PARALLEL_SIZE；UINT64_MAX 表示关闭自动并行
+ */
+void setParallelThreshold(uint64_t size);
+
+/**
+ * 扩散基准测试：在指定扩散核级别下，分别测量行间扩散与列间扩散（加密方向）的吞吐率
+ * 级别只作用于本次测量，不修改 setSimdLevel 的全局设置，可与其他加解密同时进行
+ * @param side 块边长 4~1024
+ * @param rounds 每个扩散过程重复的次数
+ * @param level CHAOS_SIMD_LEVEL，CPU 不支持时返回失败
+ * @return result 为 "行扩散 Gbit/s|列扩散 Gbit/s"，speed 为两者中较小者
+ */
+CHAOS_OPERATION_RESULT benchmarkDiffusePasses(int side, int rounds, int level);
+
 std::string GetMemoryUsage();
 
 void returnInit(std::string hash, double &x0, double &y0, double &u, double &r);
@@ -73,38 +223,316 @@ std::string GetCPUUsage();
 
 int hextoDec(char c);
 
-bool judgeCRC32(const std::string &emstr);
+bool judgeCRC32(std::string_view emstr);
 
 void generateRandom(std::string hash, double &x0, double &y0, double &u, double &r);
 
 void generateRandom3(std::string hash, double &x0, double &y0, double &z0, double &u, double &r, double &l);
 
+// 定点整数映射的参数直接取自 sha256 十六进制摘要，不经过浮点运算：x0、y0 为 Q0.32，u、r 为 Q8.24，取值 [4, 20)
+void generateRandomQ(const std::string &hash, uint32_t &x0, uint32_t &y0, uint32_t &u, uint32_t &r);
+
+// ========================密钥参数缓存
+// 同一密钥反复加解密大量小数据（如聊天消息）时，sha256 与参数推导只在首次使用时计算一次
+// 缓存最多保留的密钥数量，超出时淘汰最久未使用的密钥
+#define CHAOS_KEY_CACHE_SIZE 64
+
+// 二维混沌映射的初始值与控制参数，同 generateRandom
+struct CHAOS_MAP2_PARAMS {
+    double x0, y0, u, r;
+};
+
+// 三维混沌映射的初始值与控制参数，同 generateRandom3
+struct CHAOS_MAP3_PARAMS {
+    double x0, y0, z0, u, r, l;
+};
+
+// 定点整数映射的初始值与控制参数，同 generateRandomQ
+struct CHAOS_MAPQ_PARAMS {
+    uint32_t x0, y0, u, r;
+};
+
+// 由一个密钥推导出的全部参数：字符串加解密使用 map2，文件与内存缓冲区加解密使用 map3，
+// 文件头中的映射为 CHAOS_MAP_FIXED 时文件使用 mapQ
+struct CHAOS_KEY_SCHEDULE {
+    CHAOS_MAP2_PARAMS map2;
+    CHAOS_MAP3_PARAMS map3;
+    CHAOS_MAPQ_PARAMS mapQ;
+    // 以上参数各自预热 CHAOS_WARMUP 次之后的状态，一次预热模式（CHAOS_STR_WARM_ONCE、CHAOS_FILE_FLAG_WARM_ONCE）
+    // 从这里开始生成密钥流，各块不再预热
+    CHAOS_MAP2_PARAMS map2Warm;
+    CHAOS_MAP3_PARAMS map3Warm;
+    CHAOS_MAPQ_PARAMS mapQWarm;
+};
+
+// 由密钥推导参数，不经过缓存
+void deriveKeySchedule(std::string_view key, CHAOS_KEY_SCHEDULE &schedule);
+
+/**
+ * 取密钥对应的参数，线程安全的 LRU 缓存，命中时不再计算 sha256
+ * 缓存中保存密钥原文，淘汰或清空时先擦除
+ */
+CHAOS_KEY_SCHEDULE getKeySchedule(std::string_view key);
+
+// 清空密钥参数缓存
+void clearKeyScheduleCache();
+
+/**
+ * 打开密钥句柄：推导一次参数并保存，之后的加解密只传句柄，句柄表中不保存密钥原文
+ * @param key 密钥 8~256
+ * @return 大于 0 的句柄，密钥长度不合法时返回 -1
+ */
+int openKeyHandle(std::string_view key);
+
+// 取句柄对应的参数，句柄不存在时返回 false
+bool getKeyHandle(int handle, CHAOS_KEY_SCHEDULE &schedule);
+
+// 关闭句柄，句柄不存在时返回 false
+bool closeKeyHandle(int handle);
+
+// ========================文件混沌映射
+// 文件密文使用的混沌映射及其状态，状态按块顺序推进
+struct CHAOS_FILE_MAP {
+    // CHAOS_MAP_ID
+    int mapId;
+    // 各块独立取初值（CHAOS_FILE_FLAG_BLOCK_SEED），此时 map3、mapQ 只作为种子，不再推进
+    bool blockSeed;
+    // 链式模式下每块的预热次数，一次预热（CHAOS_FILE_FLAG_WARM_ONCE）时为 0
+    int warmup;
+    // 矩形分块（CHAOS_FILE_FLAG_RECT_BLOCKS）
+    bool rectBlocks;
+    CHAOS_MAP3_PARAMS map3;
+    CHAOS_MAPQ_PARAMS mapQ;
+};
+
+/**
+ * 按 mapId 与文件头标志从密钥参数初始化映射状态
+ * @param flags CHAOS_FILE_FLAG_*，带 CHAOS_FILE_FLAG_BLOCK_SEED 时各块独立取初值
+ * @return 文件不支持该映射时返回 false
+ */
+bool initFileMap(const CHAOS_KEY_SCHEDULE &schedule, int mapId, int flags, CHAOS_FILE_MAP &map);
+
+/**
+ * 生成块 blockIndex 的密钥流 x、y（各 m 字节）
+ * 链式模式下混沌状态在块之间传递，块必须按顺序生成；独立初值模式下不修改 map，可以任意顺序、多线程调用
+ */
+void keyStream_FileMap(CHAOS_FILE_MAP &map, uint64_t blockIndex, int m, uint8_t *x, uint8_t *y);
+
+/**
+ * 按文件映射生成全局块表，CHAOS_MAP_3D 的链式模式与 buildBlockTable3 相同
+ * 独立初值模式下各块的密钥流由线程池并行生成，定点映射再按 CHAOS_Q_LANES 路交错
+ * @param threads 最多使用的线程数，<= 0 表示线程池全部线程
+ */
+void buildBlockTableMap(CHAOS_BLOCK_TABLE &table, uint64_t size, CHAOS_FILE_MAP &map, int threads = 0);
+
+// 新加密的文件使用的映射，默认 CHAOS_MAP_3D
+int getFileMapId();
+
+/**
+ * 设置新加密的文件使用的映射，解密时以文件头中记录的映射为准
+ * CHAOS_MAP_FIXED 的密文只能由支持该映射的版本解密
+ * @param mapId CHAOS_MAP_3D 或 CHAOS_MAP_FIXED
+ * @return 不支持时返回 false，设置不变
+ */
+bool setFileMapId(int mapId);
+
+// 新加密的文件是否使用独立块初值（CHAOS_FILE_FLAG_BLOCK_SEED），默认否
+bool getFileBlockSeed();
+
+// 设置新加密的文件是否使用独立块初值，这类密文只能由支持该标志的版本解密
+void setFileBlockSeed(bool enable);
+
+// 新加密的文件是否只预热一次（CHAOS_FILE_FLAG_WARM_ONCE），默认否
+bool getFileWarmOnce();
+
+// 设置新加密的文件是否只预热一次，只作用于链式模式；这类密文只能由支持该标志的版本解密
+void setFileWarmOnce(bool enable);
+
+// 新加密的文件是否使用矩形分块（CHAOS_FILE_FLAG_RECT_BLOCKS），默认否
+bool getFileRectBlocks();
+
+// 设置新加密的文件是否使用矩形分块，这类密文只能由支持该标志的版本解密
+void setFileRectBlocks(bool enable);
+
+// 新加密的文件头标志：CHAOS_FILE_FLAG_BLOCK_CRC 加上当前选择的密钥流模式与分块方式
+int newFileFlags();
+
 void getEmLenStr(Len_t &lenBit, std::string &lenBitStr);
 
 // ================================================== start 软件加密 ==================================================
 // ========================字符串加密
+// 密文格式
+enum CHAOS_STR_FORMAT {
+    // 十六进制长度前缀 + 大写十六进制密文 + 8 位十六进制 CRC32，原有格式，约 2 倍膨胀
+    CHAOS_STR_HEX = 0,
+    // 二进制：1 字节长度字段字节数 n + n 字节大端密文长度 + 密文 + 4 字节大端 CRC32（覆盖之前的全部字节）
+    CHAOS_STR_BINARY = 1,
+    // CHAOS_STR_BINARY 的 Base64 编码（标准字母表，带 '=' 填充），约 1.33 倍膨胀
+    CHAOS_STR_BASE64 = 2,
+    // 与 CHAOS_STR_BINARY / CHAOS_STR_BASE64 组合：从密钥的预热状态开始，各块不再预热，短消息的密钥流开销大幅减少。
+    // 密文中长度字段字节数的最高位记录该模式，解密时自动识别，不需要传入；CHAOS_STR_HEX 不支持
+    CHAOS_STR_WARM_ONCE = 0x10,
+};
+
 // =============有密钥
 
 /**
  * 加密
  * @param key  密钥 8~256
- * @param inputStr 待加密字符串
+ * @param inputStr 待加密字符串，按字节处理，可以包含 0 字节
+ * @param format 密文格式 CHAOS_STR_FORMAT，CHAOS_STR_BINARY 时 result 为二进制数据；
+ *               CHAOS_STR_BINARY / CHAOS_STR_BASE64 可以再加上 CHAOS_STR_WARM_ONCE
  * @return
  */
-CHAOS_OPERATION_RESULT encryptStrWithKey(std::string key, std::string inputStr);
+CHAOS_OPERATION_RESULT encryptStrWithKey(std::string_view key, std::string_view inputStr, int format = CHAOS_STR_HEX);
 
 /**
  * 解密
  * @param key 密钥 8~256
  * @param inputStr 待解密字符串
- * @return
+ * @param format 密文格式，须与加密时相同
+ * @return result 为完整的明文字节，不在 0 字节处截断
  */
-CHAOS_OPERATION_RESULT decryptStrWithKey(const std::string& key, const std::string& inputStr);
+CHAOS_OPERATION_RESULT decryptStrWithKey(std::string_view key, std::string_view inputStr, int format = CHAOS_STR_HEX);
+
+// 同 encryptStrWithKey，使用已推导的密钥参数（getKeySchedule / getKeyHandle）
+CHAOS_OPERATION_RESULT
+encryptStrWithSchedule(const CHAOS_KEY_SCHEDULE &schedule, std::string_view inputStr, int format = CHAOS_STR_HEX);
+
+// 同 decryptStrWithKey，使用已推导的密钥参数
+CHAOS_OPERATION_RESULT
+decryptStrWithSchedule(const CHAOS_KEY_SCHEDULE &schedule, std::string_view inputStr, int format = CHAOS_STR_HEX);
+
+/**
+ * 预热基准测试：按若干明文长度（短消息到带尾块的 1 MiB）分别用原有模式与 CHAOS_STR_WARM_ONCE 加密 CHAOS_STR_BINARY 字符串
+ * @param rounds 每个长度重复的次数
+ * @return result 为 "长度:原有模式微秒:一次预热微秒|..."（单次加密的平均耗时），speed 为最短消息上的加速倍数
+ */
+CHAOS_OPERATION_RESULT benchmarkWarmup(int rounds);
 
 // =============无密钥
 
 
+// ========================内存缓冲区加密
+// =============有密钥
+/**
+ * 密钥-内存缓冲区-加密，不写入文件头，密文长度与明文相同（即文件加密的密文数据段）
+ * @param key 密钥 8~256
+ * @param input 待加密数据
+ * @param output 加密结果，调用方分配 len 字节；可与 input 相同，此时原地加密
+ * @param len 数据长度
+ * @return
+ */
+CHAOS_OPERATION_RESULT encryptBufferWithKey(const std::string &key, const uint8_t *input, uint8_t *output, uint64_t len);
+
+/**
+ * 密钥-内存缓冲区-解密
+ * @param key 密钥 8~256
+ * @param input 待解密数据
+ * @param output 解密结果，调用方分配 len 字节；可与 input 相同，此时原地解密
+ * @param len 数据长度
+ * @return
+ */
+CHAOS_OPERATION_RESULT decryptBufferWithKey(const std::string &key, const uint8_t *input, uint8_t *output, uint64_t len);
+
+// 同 encryptBufferWithKey，使用已推导的密钥参数
+CHAOS_OPERATION_RESULT
+encryptBufferWithSchedule(const CHAOS_KEY_SCHEDULE &schedule, const uint8_t *input, uint8_t *output, uint64_t len);
+
+// 同 decryptBufferWithKey，使用已推导的密钥参数
+CHAOS_OPERATION_RESULT
+decryptBufferWithSchedule(const CHAOS_KEY_SCHEDULE &schedule, const uint8_t *input, uint8_t *output, uint64_t len);
+
+
 // ========================文件加密
+// =============文件头
+// v1：getEmLenStr 生成的 ASCII 十六进制长度前缀，长度不固定，只能由旧版本读取后兼容解密。
+// v2：固定 CHAOS_FILE_HEADER_SIZE 字节的二进制文件头，多字节字段均为小端：
+//   0  magic[8]     CHAOS_FILE_MAGIC
+//   8  version      uint16，当前为 2
+//   10 headerSize   uint16，密文数据相对文件开头的偏移，后续版本可在文件头之后追加内容（如块表）
+//   12 mapId        uint16，CHAOS_MAP_ID
+//   14 flags        uint16，读取方不认识的标志位一律拒绝解密
+//   16 blockRows    uint16，分块的最大行数
+//   18 blockCols    uint16，分块的最大列数
+//   20 reserved     uint32，写 0
+//   24 plainLength  uint64，明文长度
+//   32 reserved     写 0
+// v1 以十六进制数字开头，不会与 magic 混淆
+#define CHAOS_FILE_MAGIC "LZUCHAOS"
+#define CHAOS_FILE_VERSION 2
+#define CHAOS_FILE_HEADER_SIZE 64
+// 旧格式最长为 2 + 16 字节
+#define CHAOS_FILE_HEADER_V1_MAX 18
+// 标志位：密文数据之后紧跟块校验表，每块 4 字节小端 CRC32，块的划分同 splitFileBlocks(plainLength, flags)。
+// 校验的是块密文在文件中的有效部分（尾块不含填充），不需要密钥即可检查文件是否完整
+#define CHAOS_FILE_FLAG_BLOCK_CRC 1
+// 标志位：各块的混沌初值由密钥参数与块序号独立生成，块之间不传递混沌状态，密钥流可以多线程、多路交错生成
+#define CHAOS_FILE_FLAG_BLOCK_SEED 2
+// 标志位：链式模式下混沌状态只在文件开头预热一次（从 CHAOS_KEY_SCHEDULE 的预热状态开始），之后的块不再预热，
+// 不与 CHAOS_FILE_FLAG_BLOCK_SEED 同时使用
+#define CHAOS_FILE_FLAG_WARM_ONCE 4
+// 标志位：按 splitBlockRect 分块，除尾块外都是最大块，尾块为 m * n 的矩形；无此标志时按 splitBlockSize 分方块
+#define CHAOS_FILE_FLAG_RECT_BLOCKS 8
+// 本版本支持的全部标志位
+#define CHAOS_FILE_FLAGS_KNOWN (CHAOS_FILE_FLAG_BLOCK_CRC | CHAOS_FILE_FLAG_BLOCK_SEED | CHAOS_FILE_FLAG_WARM_ONCE | \
+                                CHAOS_FILE_FLAG_RECT_BLOCKS)
+
+// 密文使用的混沌映射
+enum CHAOS_MAP_ID {
+    // 二维混沌系统 keyStream_Block
+    CHAOS_MAP_2D = 1,
+    // 三维混沌系统 keyStream_Block3，文件加密默认使用
+    CHAOS_MAP_3D = 2,
+    // 定点整数混沌映射 keyStream_BlockQ，见 setFileMapId
+    CHAOS_MAP_FIXED = 3,
+};
+
+struct CHAOS_FILE_HEADER {
+    int version;
+    // 密文数据在文件中的起始偏移
+    uint64_t dataOffset;
+    int mapId;
+    int flags;
+    int blockRows;
+    int blockCols;
+    uint64_t plainLength;
+    // 块校验表在文件中的偏移，没有校验表时为 0
+    uint64_t crcTableOffset;
+};
+
+/**
+ * 生成 v2 文件头
+ * @param plainLength 明文长度
+ * @param flags CHAOS_FILE_FLAG_*
+ * @param mapId CHAOS_MAP_ID
+ * @param out CHAOS_FILE_HEADER_SIZE 字节
+ */
+void writeFileHeader(uint64_t plainLength, int flags, int mapId, uint8_t *out);
+
+/**
+ * 解析文件头，同时支持 v2 与 v1
+ * @param data 文件开头的内容，建议一次读取 CHAOS_FILE_HEADER_SIZE 字节
+ * @param len data 的有效字节数（文件较短时可小于 CHAOS_FILE_HEADER_SIZE）
+ * @param header 解析结果
+ * @return 格式错误、版本过新或使用了本版本不支持的映射、分块、标志时返回 false
+ */
+bool parseFileHeader(const uint8_t *data, size_t len, CHAOS_FILE_HEADER &header);
+
+// 一个块的 CRC32（slicing-by-8 的 CRC32 类）
+uint32_t blockCrc32(const uint8_t *data, size_t len);
+
+// 任意长度数据的 CRC32，与 blockCrc32 结果相同，较长的数据分段并行计算
+uint32_t bufferCrc32(const uint8_t *data, uint64_t len);
+
+// plainLength 字节明文对应的块校验表字节数
+uint64_t blockCrcTableSize(uint64_t plainLength, int flags);
+
+// 块校验表与字节序列互转，bytes 为 4 * crcs.size() 字节
+void encodeBlockCrcTable(const std::vector<uint32_t> &crcs, uint8_t *bytes);
+
+void decodeBlockCrcTable(const uint8_t *bytes, std::vector<uint32_t> &crcs);
+
 // =============有密钥
 /**
  * 密钥-文件-加密
@@ -151,6 +579,7 @@ CHAOS_OPERATION_RESULT decryptFileNoKey(std::string inputPath, std::string outpu
 // =============有密钥
 /**
  * 有密钥-文件加密-多线程
+ * 密文与线程数无关，与单线程 encryptFileWithKey 的密文相同（尾块不写出填充部分）
  * @param THREAD_NUM 线程数量
  * @param key 密钥
  * @param inputPath 待加密文件
@@ -162,6 +591,7 @@ encryptFileWithKey_OMP(int THREAD_NUM, std::string key, std::string inputPath, s
 
 /**
  * 有密钥-文件解密-多线程
+ * 可解密单线程与多线程加密的文件，旧版本按线程数分段加密的文件无法解密
  * @param THREAD_NUM 线程数量
  * @param key 密钥
  * @param inputPath 待解密文件
@@ -171,6 +601,151 @@ encryptFileWithKey_OMP(int THREAD_NUM, std::string key, std::string inputPath, s
 CHAOS_OPERATION_RESULT
 decryptFileWithKey_OMP(int THREAD_NUM, std::string key, std::string inputPath, std::string outputPath);
 
+/**
+ * 文件完整性校验-多线程，按块校验表并行核对密文，不需要密钥，发现第一个损坏的块即停止
+ * @param THREAD_NUM 线程数量
+ * @param path 带块校验表（CHAOS_FILE_FLAG_BLOCK_CRC）的密文文件
+ * @return 校验失败时 errorMsg 说明原因，result 为第一个被发现的损坏块序号
+ */
+CHAOS_OPERATION_RESULT verifyFile_OMP(int THREAD_NUM, std::string path);
+
+/**
+ * 文件指纹，计算整个文件的 SHA-256，读文件与哈希计算流水线重叠进行
+ * @param path 任意文件
+ * @return result 为 64 位小写十六进制摘要
+ */
+CHAOS_OPERATION_RESULT fingerprintFile(std::string path);
+
+/**
+ * 多线程文件加密的扩展性基准测试，线程数依次取 1、2、4 ... maxThreads，对同一文件分别加密
+ * @param maxThreads 最大线程数
+ * @param key 密钥
+ * @param inputPath 测试文件
+ * @param outputPath 加密输出文件，每轮覆盖
+ * @return result 为 "线程数:Gbit/s|线程数:Gbit/s|..."，speed 为其中最高的速率
+ */
+CHAOS_OPERATION_RESULT
+benchmarkFileScaling_OMP(int maxThreads, const std::string &key, const std::string &inputPath,
+                         const std::string &outputPath);
+
+/**
+ * 内存加密的并行交叉点基准：数据长度从 256 KiB 起每次翻倍直到 maxSize，分别用 1 个线程与 THREAD_NUM 个线程
+ * 按块表加密同一缓冲区，用于确定 DEFAULT_PARALLEL_SIZE / setParallelThreshold 的取值
+ * @param THREAD_NUM 多线程一侧的线程数
+ * @param maxSize 最大数据长度
+ * @return result 为 "长度:单线程Gbit/s:多线程Gbit/s|..."，size 为多线程开始比单线程快 10% 以上的最小长度（没有时为 0）
+ */
+CHAOS_OPERATION_RESULT benchmarkParallelCrossover(int THREAD_NUM, uint64_t maxSize);
+
+// ========================原地文件加密-多线程
+// 原地加密的文件 = 与原文件等长的数据 + CHAOS_INPLACE_TRAILER_SIZE 字节文件尾，多字节字段均为小端：
+//   0  magic[4]  CHAOS_INPLACE_MAGIC
+//   4  state     uint8，CHAOS_INPLACE_STATE
+//   5  flags     uint8，CHAOS_FILE_FLAG_*，只使用密钥流模式与分块方式，不含 CHAOS_FILE_FLAG_BLOCK_CRC
+//   6  mapId     uint16，CHAOS_MAP_ID
+//   8  keyCheck  uint32，密钥的 SHA-256 摘要的前 4 字节，用于拒绝错误的密钥
+//   12 crc       uint32，数据部分当前应有内容的 CRC32，由 state 决定是明文还是密文
+// 明文长度为文件大小减去文件尾。映射、标志取加密时的 setFileMapId、setFileBlockSeed 等设置，
+// 密文部分与相同设置下 encryptFileWithKey_OMP 输出的密文数据（去掉文件头与块校验表）相同。
+// 崩溃安全：原地模式不保留原文件副本。每次改动数据之前先写入并落盘表示"进行中"的文件尾，数据 msync 落盘后再写入
+// 表示"完成"的文件尾，因此中断后再次执行同一操作时：数据仍与文件尾的 CRC 一致则从头重做（或直接截掉文件尾），
+// 否则说明数据已被部分改写，无法恢复，拒绝继续。需要完全可恢复时请使用复制模式。
+#define CHAOS_INPLACE_MAGIC "LZUI"
+#define CHAOS_INPLACE_TRAILER_SIZE 16
+
+// 原地加密文件尾的状态
+enum CHAOS_INPLACE_STATE {
+    // 正在加密，crc 为明文的 CRC32
+    CHAOS_INPLACE_ENCRYPTING = 1,
+    // 加密完成，crc 为密文的 CRC32
+    CHAOS_INPLACE_ENCRYPTED = 2,
+    // 正在解密，crc 为密文的 CRC32
+    CHAOS_INPLACE_DECRYPTING = 3,
+    // 明文已落盘、尚未去掉文件尾，crc 为明文的 CRC32
+    CHAOS_INPLACE_DECRYPTED = 4,
+};
+
+/**
+ * 有密钥-文件原地加密-多线程，通过 MAP_SHARED 映射直接在文件页上加密，不产生第二份文件
+ * @param THREAD_NUM 线程数量
+ * @param key 密钥
+ * @param path 待加密文件，加密后追加文件尾；上次加密被中断且数据未被改动时继续加密
+ * @return
+ */
+CHAOS_OPERATION_RESULT encryptFileInPlace_OMP(int THREAD_NUM, std::string key, std::string path);
+
+/**
+ * 有密钥-文件原地解密-多线程，解密后去掉文件尾
+ * @param THREAD_NUM 线程数量
+ * @param key 密钥，与文件尾中的 keyCheck 不符时拒绝解密，文件不被改动
+ * @param path encryptFileInPlace_OMP 加密的文件；也可以是加密或解密被中断的文件，能恢复时完成解密（或撤销加密）
+ * @return
+ */
+CHAOS_OPERATION_RESULT decryptFileInPlace_OMP(int THREAD_NUM, std::string key, std::string path);
+
+// ========================内存缓冲区加密-多线程
+/**
+ * 有密钥-内存缓冲区加密-多线程，结果与单线程 encryptBufferWithKey 完全一致
+ * @param THREAD_NUM 线程数量
+ * @param key 密钥
+ * @param input 待加密数据
+ * @param output 加密结果，可与 input 相同
+ * @param len 数据长度
+ * @return
+ */
+CHAOS_OPERATION_RESULT
+encryptBufferWithKey_OMP(int THREAD_NUM, const std::string &key, const uint8_t *input, uint8_t *output, uint64_t len);
+
+/**
+ * 有密钥-内存缓冲区解密-多线程
+ * @param THREAD_NUM 线程数量
+ * @param key 密钥
+ * @param input 待解密数据
+ * @param output 解密结果，可与 input 相同
+ * @param len 数据长度
+ * @return
+ */
+CHAOS_OPERATION_RESULT
+decryptBufferWithKey_OMP(int THREAD_NUM, const std::string &key, const uint8_t *input, uint8_t *output, uint64_t len);
+
+// ========================字符串批量加密-多线程
+// 批量加解密的输出：全部消息的结果连续存放在同一块 arena 中
+struct CHAOS_STR_BATCH {
+    std::string arena;
+    // 第 i 条结果位于 arena 的 [offsets[i], offsets[i + 1])，共 count + 1 项
+    std::vector<uint64_t> offsets;
+    // 第 i 条是否成功，失败的消息结果为空
+    std::vector<uint8_t> status;
+};
+
+/**
+ * 有密钥-字符串批量加密-多线程，所有消息只推导一次密钥参数，按消息分给线程池并行处理
+ * 每条结果与 encryptStrWithKey 单独加密完全一致
+ * @param THREAD_NUM 线程数量
+ * @param key 密钥
+ * @param inputs count 条明文，按字节处理
+ * @param format 密文格式 CHAOS_STR_FORMAT
+ * @param batch 输出
+ * @return success 表示整批已处理（单条失败记录在 batch.status 中），result 为失败条数，size 为明文总字节数
+ */
+CHAOS_OPERATION_RESULT
+encryptStrBatch_OMP(int THREAD_NUM, std::string_view key, const std::string_view *inputs, int count, int format,
+                    CHAOS_STR_BATCH &batch);
+
+// 有密钥-字符串批量解密-多线程，参数同 encryptStrBatch_OMP，size 为密文总字节数
+CHAOS_OPERATION_RESULT
+decryptStrBatch_OMP(int THREAD_NUM, std::string_view key, const std::string_view *inputs, int count, int format,
+                    CHAOS_STR_BATCH &batch);
+
+// 同 encryptStrBatch_OMP / decryptStrBatch_OMP，使用已推导的密钥参数
+CHAOS_OPERATION_RESULT
+encryptStrBatchWithSchedule_OMP(int THREAD_NUM, const CHAOS_KEY_SCHEDULE &schedule, const std::string_view *inputs,
+                                int count, int format, CHAOS_STR_BATCH &batch);
+
+CHAOS_OPERATION_RESULT
+decryptStrBatchWithSchedule_OMP(int THREAD_NUM, const CHAOS_KEY_SCHEDULE &schedule, const std::string_view *inputs,
+                                int count, int format, CHAOS_STR_BATCH &batch);
+
 // =============无密钥
 /**
  * 无密钥-文件加密-多线程
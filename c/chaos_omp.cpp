@@ -12,9 +12,17 @@
 #include <cstring>
 #include <iomanip>
 #include <algorithm>
-#include <omp.h>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <thread>
 #include "chaos.h"
 #include "sha256.h"
+#include "block_pool.h"
+#include "thread_pool.h"
+#include "file_io.h"
+#include "pipeline.h"
 #include <set>
 
 const double multiplier = pow(10, 16);
@@ -32,6 +40,512 @@ std::wstring utf8_to_wstring(const std::string& str) {
 #endif
 
 
+// 块在输入、输出文件中的有效长度：尾块只读写有效部分，其余填充48
+static int blockRealSize(const CHAOS_BLOCK_TABLE &table, int i, uint64_t length) {
+    return (int) std::min((uint64_t) table.blockSize(i), length - table.offsets[i]);
+}
+
+// 块校验：加密时记录每块密文有效部分的 CRC32，解密时在解密之前逐块核对，发现损坏后所有线程尽快停止
+struct BLOCK_CHECK {
+    // 块校验表，加密时写入、解密时读取
+    std::vector<uint32_t> crcs;
+    bool verify = false;
+    std::atomic<bool> corrupted{false};
+};
+
+// 处理块 i 的密文 data，check 为空时不校验；核对失败返回 false
+static bool checkBlock(BLOCK_CHECK *check, int i, const uint8_t *data, int realSize) {
+    if (check == nullptr) {
+        return true;
+    }
+    uint32_t crc = blockCrc32(data, realSize);
+    if (!check->verify) {
+        check->crcs[i] = crc;
+        return true;
+    }
+    if (crc != check->crcs[i]) {
+        check->corrupted = true;
+        return false;
+    }
+    return true;
+}
+
+// 各文件后端的结果
+enum FILE_BLOCKS_STATUS {
+    // 读写失败，或解密前块校验失败（BLOCK_CHECK::corrupted）
+    FILE_BLOCKS_FAILED = 0,
+    FILE_BLOCKS_OK = 1,
+    // 后端不可用，调用方改用 pread/pwrite
+    FILE_BLOCKS_UNSUPPORTED = -1,
+    // 块缓冲申请失败
+    FILE_BLOCKS_NO_MEMORY = -2,
+};
+
+// pread/pwrite 后端：空闲线程从共享游标领取下一个块，同步读入、加解密后写到自己的绝对偏移。
+// 各块的写入区域互不重叠，无需加锁
+static int cryptFileBlocksPositional(int THREAD_NUM, const ChaosFile &input, uint64_t readBase,
+                                     const ChaosFile &output, uint64_t writeBase, const CHAOS_BLOCK_TABLE &table,
+                                     uint64_t length, bool decrypt, BLOCK_CHECK *check) {
+    std::atomic<int> nextBlock(0);
+    std::atomic<bool> ioFailed(false);
+    std::atomic<bool> noMemory(false);
+    ThreadPool::shared().parallelFor(THREAD_NUM, THREAD_NUM, [&](int) {
+        BlockPool &pool = BlockPool::local();
+        unsigned char *buffer = pool.acquire();
+        uint8_t *workspace = localWorkspace();
+        if (buffer == nullptr || workspace == nullptr) {
+            pool.release(buffer);
+            noMemory = true;
+            ioFailed = true;
+            return;
+        }
+        for (int i = nextBlock++; i < table.blockNum() && !ioFailed; i = nextBlock++) {
+            int currBlockSize = table.blockSize(i);
+            int m = table.rows(i), n = table.cols(i);
+            int k = table.keyLength(i);
+            int realSize = blockRealSize(table, i, length);
+            int64_t got = input.readAt(buffer, realSize, readBase + table.offsets[i]);
+            if (got < 0) {
+                ioFailed = true;
+                break;
+            }
+            memset(buffer + got, 48, currBlockSize - got);
+            const uint8_t *x = table.keyStream(i);
+            if (decrypt) {
+                if (!checkBlock(check, i, buffer, realSize)) {
+                    ioFailed = true;
+                    break;
+                }
+                decode_Diffuse(buffer, m, n, x, x + k, workspace);
+            } else {
+                encode_Diffuse(buffer, m, n, x, x + k, workspace);
+                checkBlock(check, i, buffer, realSize);
+            }
+            if (!output.writeAt(buffer, realSize * sizeof(char), writeBase + table.offsets[i])) {
+                ioFailed = true;
+                break;
+            }
+        }
+        pool.release(buffer);
+    });
+    return noMemory ? FILE_BLOCKS_NO_MEMORY : ioFailed ? FILE_BLOCKS_FAILED : FILE_BLOCKS_OK;
+}
+
+// io_uring 后端中单个块缓冲的状态
+struct URING_SLOT {
+    // 正在处理的块
+    int block;
+    // 当前读写请求的目标字节数与已完成字节数
+    int want;
+    int done;
+};
+
+// io_uring 后端的最大在途块数
+#define URING_MAX_SLOTS 64
+
+// io_uring 后端：I/O 循环按块顺序提交读请求，使多个块的读写同时在途；
+// 读完的块交给工作线程加解密，算完的块再由 I/O 循环提交写请求。
+// I/O 循环是 parallelFor 的第 0 个任务，不另建线程；没有在途请求时它自己也加解密读好的块，因此线程池没有空闲线程
+// （或 THREAD_NUM 为 1）时也能独自完成全部块。
+// 返回 FILE_BLOCKS_STATUS，无法创建 io_uring 时为 FILE_BLOCKS_UNSUPPORTED（调用方改用 pread/pwrite）
+static int cryptFileBlocksUring(int THREAD_NUM, const ChaosFile &input, uint64_t readBase,
+                                const ChaosFile &output, uint64_t writeBase, const CHAOS_BLOCK_TABLE &table,
+                                uint64_t length, bool decrypt, BLOCK_CHECK *check) {
+    int blockNum = table.blockNum();
+    // 每个工作线程两块（一块在算、一块待算），另留读写在途的余量
+    int slotCount = std::min(std::min(blockNum, 2 * THREAD_NUM + 4), URING_MAX_SLOTS);
+    BlockPool &pool = BlockPool::local();
+    std::vector<uint8_t *> buffers(slotCount);
+    bool allocated = true;
+    for (int s = 0; s < slotCount; s++) {
+        buffers[s] = pool.acquire();
+        allocated = allocated && buffers[s] != nullptr;
+    }
+    ChaosUring ring;
+    if (!allocated || !ring.init(2 * slotCount, buffers.data(), slotCount, pool.bufferSize())) {
+        for (int s = 0; s < slotCount; s++) {
+            pool.release(buffers[s]);
+        }
+        return allocated ? FILE_BLOCKS_UNSUPPORTED : FILE_BLOCKS_NO_MEMORY;
+    }
+
+    std::vector<URING_SLOT> slots(slotCount);
+    std::mutex mutex;
+    std::condition_variable cond;
+    // 读完待算、算完待写的缓冲
+    std::deque<int> readyQueue;
+    std::deque<int> doneQueue;
+    bool closed = false;
+    std::atomic<bool> ioFailed(false);
+    std::atomic<bool> noMemory(false);
+    // 在途请求无法等到完成时为 true，此时放弃全部缓冲区
+    bool leakBuffers = false;
+
+    // 加解密第 s 个缓冲中的块，完成后放入 doneQueue；失败时置 ioFailed 并返回 false
+    auto computeSlot = [&](int s) {
+        int i = slots[s].block;
+        int m = table.rows(i), n = table.cols(i);
+        int k = table.keyLength(i);
+        int realSize = blockRealSize(table, i, length);
+        const uint8_t *x = table.keyStream(i);
+        uint8_t *workspace = localWorkspace();
+        bool ok = workspace != nullptr;
+        if (!ok) {
+            noMemory = true;
+        } else if (decrypt) {
+            ok = checkBlock(check, i, buffers[s], realSize);
+            if (ok) {
+                decode_Diffuse(buffers[s], m, n, x, x + k, workspace);
+            }
+        } else {
+            encode_Diffuse(buffers[s], m, n, x, x + k, workspace);
+            checkBlock(check, i, buffers[s], realSize);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (ok) {
+                doneQueue.push_back(s);
+            } else {
+                ioFailed = true;
+            }
+        }
+        cond.notify_all();
+        return ok;
+    };
+
+    // user_data：缓冲序号 * 2 + 是否为写
+    auto ioLoop = [&] {
+        std::vector<int> freeSlots;
+        for (int s = slotCount - 1; s >= 0; s--) {
+            freeSlots.push_back(s);
+        }
+        int nextRead = 0;
+        int written = 0;
+        int inflight = 0;
+        std::vector<int> toWrite;
+        while (written < blockNum && !ioFailed) {
+            while (!freeSlots.empty() && nextRead < blockNum) {
+                int s = freeSlots.back();
+                freeSlots.pop_back();
+                slots[s] = {nextRead, blockRealSize(table, nextRead, length), 0};
+                if (!ring.prepRead(input, s, buffers[s], slots[s].want, readBase + table.offsets[nextRead],
+                                   (uint64_t) s * 2)) {
+                    ioFailed = true;
+                    break;
+                }
+                inflight++;
+                nextRead++;
+            }
+            int computeNow = -1;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (inflight == 0 && !ioFailed) {
+                    // 没有在途请求：等待工作线程算完，或者自己取一个读好的块来算
+                    cond.wait(lock, [&] { return !doneQueue.empty() || !readyQueue.empty() || ioFailed; });
+                    if (doneQueue.empty() && !readyQueue.empty()) {
+                        computeNow = readyQueue.front();
+                        readyQueue.pop_front();
+                    }
+                }
+                toWrite.assign(doneQueue.begin(), doneQueue.end());
+                doneQueue.clear();
+            }
+            if (computeNow >= 0 && !computeSlot(computeNow)) {
+                break;
+            }
+            for (int s: toWrite) {
+                slots[s].want = blockRealSize(table, slots[s].block, length);
+                slots[s].done = 0;
+                if (!ring.prepWrite(output, s, buffers[s], slots[s].want, writeBase + table.offsets[slots[s].block],
+                                    (uint64_t) s * 2 + 1)) {
+                    ioFailed = true;
+                    break;
+                }
+                inflight++;
+            }
+            if (inflight == 0 || ioFailed) {
+                continue;
+            }
+            if (!ring.submit(1)) {
+                ioFailed = true;
+                break;
+            }
+            uint64_t userData;
+            int res;
+            while (ring.nextCompletion(userData, res)) {
+                inflight--;
+                int s = (int) (userData / 2);
+                bool isWrite = (userData & 1) != 0;
+                URING_SLOT &slot = slots[s];
+                if (res < 0 || (isWrite && res == 0)) {
+                    ioFailed = true;
+                    continue;
+                }
+                slot.done += res;
+                if (res > 0 && slot.done < slot.want) {
+                    // 短读写：继续提交剩余部分
+                    uint64_t offset = table.offsets[slot.block] + slot.done;
+                    bool prepared = isWrite
+                                    ? ring.prepWrite(output, s, buffers[s] + slot.done, slot.want - slot.done,
+                                                     writeBase + offset, userData)
+                                    : ring.prepRead(input, s, buffers[s] + slot.done, slot.want - slot.done,
+                                                    readBase + offset, userData);
+                    if (!prepared) {
+                        ioFailed = true;
+                        continue;
+                    }
+                    inflight++;
+                } else if (isWrite) {
+                    written++;
+                    freeSlots.push_back(s);
+                } else {
+                    memset(buffers[s] + slot.done, 48, table.blockSize(slot.block) - slot.done);
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        readyQueue.push_back(s);
+                    }
+                    cond.notify_all();
+                }
+            }
+        }
+        // 出错时也要等在途请求全部完成（已准备未提交的请求随 submit 一并提交），之后缓冲区才能释放。
+        // 提交失败时先取走已有的完成事件再重试（EBUSY 即完成队列已满）；取不到任何完成事件、无法再等待时，
+        // 内核可能仍在读写这些缓冲区，只能放弃它们，不再归还给缓冲池
+        while (inflight > 0) {
+            bool waited = ring.submit(1);
+            uint64_t userData;
+            int res;
+            bool progressed = false;
+            while (ring.nextCompletion(userData, res)) {
+                inflight--;
+                progressed = true;
+            }
+            if (!waited && !progressed) {
+                leakBuffers = true;
+                break;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        cond.notify_all();
+    };
+
+    // parallelFor 按序号顺序领取任务，I/O 循环总是最先开始
+    ThreadPool::shared().parallelFor(THREAD_NUM, THREAD_NUM, [&](int t) {
+        if (t == 0) {
+            ioLoop();
+            return;
+        }
+        for (;;) {
+            int s;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [&] { return !readyQueue.empty() || closed || ioFailed; });
+                if (readyQueue.empty() || ioFailed) {
+                    return;
+                }
+                s = readyQueue.front();
+                readyQueue.pop_front();
+            }
+            if (!computeSlot(s)) {
+                return;
+            }
+        }
+    });
+    for (int s = 0; s < slotCount; s++) {
+        if (leakBuffers) {
+            pool.abandon(buffers[s]);
+        } else {
+            pool.release(buffers[s]);
+        }
+    }
+    if (noMemory) {
+        return FILE_BLOCKS_NO_MEMORY;
+    }
+    return ioFailed ? FILE_BLOCKS_FAILED : FILE_BLOCKS_OK;
+}
+
+// 直接 I/O 后端每个窗口至少包含的字节数
+#define DIRECT_WINDOW_SIZE (4 * 1024 * 1024)
+
+// 直接 I/O 后端：以若干连续块组成的窗口为单位，按 CHAOS_BUFFER_ALIGN 对齐读写，经三段流水线（读 → 并行加解密 → 写）处理，
+// 数据不进入页缓存，内存占用只与窗口大小有关。文件头使数据在文件中的偏移不对齐：
+// 读时把窗口扩展到对齐边界，写时把不足一个对齐单元的尾部留到下一个窗口一起写出，最后一次写出补齐后再截断文件。
+// 返回 FILE_BLOCKS_STATUS，文件系统不支持直接 I/O 时为 FILE_BLOCKS_UNSUPPORTED（调用方改用 pread/pwrite）
+static int cryptFileBlocksDirect(int THREAD_NUM, ChaosFile &input, uint64_t readBase, ChaosFile &output,
+                                 uint64_t writeBase, const CHAOS_BLOCK_TABLE &table, uint64_t length, bool decrypt,
+                                 BLOCK_CHECK *check) {
+    const uint64_t align = CHAOS_BUFFER_ALIGN;
+    // 输出文件中与 writeBase 处于同一对齐单元、已经写好的内容（加密时为文件头），随第一个窗口一起写出。
+    // 必须在开启直接 I/O 之前读取
+    uint64_t outStart = writeBase / align * align;
+    size_t carryLen = (size_t) (writeBase - outStart);
+    std::vector<uint8_t> head(carryLen);
+    if (carryLen > 0 && output.readAt(head.data(), carryLen, outStart) != (int64_t) carryLen) {
+        return FILE_BLOCKS_FAILED;
+    }
+    if (!input.setDirect(true) || !output.setDirect(true)) {
+        input.setDirect(false);
+        output.setDirect(false);
+        return FILE_BLOCKS_UNSUPPORTED;
+    }
+
+    // 划分窗口：每个窗口至少 DIRECT_WINDOW_SIZE 字节，且块数足够所有线程同时计算
+    int blockNum = table.blockNum();
+    uint64_t windowTarget = std::max((uint64_t) DIRECT_WINDOW_SIZE,
+                                     (uint64_t) THREAD_NUM * MAX_BLOCKROW * MAX_BLOCKCOL);
+    std::vector<int> windows(1, 0);
+    for (int i = 1; i < blockNum; i++) {
+        if (table.offsets[i] - table.offsets[windows.back()] >= windowTarget) {
+            windows.push_back(i);
+        }
+    }
+    int windowNum = (int) windows.size();
+    windows.push_back(blockNum);
+    auto windowBegin = [&](int w) {
+        return table.offsets[windows[w]];
+    };
+    auto windowEnd = [&](int w) {
+        return w + 1 < windowNum ? table.offsets[windows[w + 1]] : length;
+    };
+    uint64_t windowMax = 0;
+    for (int w = 0; w < windowNum; w++) {
+        windowMax = std::max(windowMax, windowEnd(w) - windowBegin(w));
+    }
+    // 窗口前后各需一个对齐单元的余量
+    size_t slotSize = (size_t) ((windowMax + 2 * align + align - 1) / align * align);
+    uint8_t *slots[CHAOS_PIPELINE_DEPTH] = {nullptr};
+    uint8_t *staging = (uint8_t *) alignedAlloc(slotSize, align, false);
+    bool allocated = staging != nullptr;
+    for (int s = 0; s < CHAOS_PIPELINE_DEPTH; s++) {
+        slots[s] = (uint8_t *) alignedAlloc(slotSize, align, false);
+        allocated = allocated && slots[s] != nullptr;
+    }
+    // 窗口数据在槽内的起始位置：读取从对齐边界开始
+    auto windowDelta = [&](int w) {
+        return (size_t) ((readBase + windowBegin(w)) % align);
+    };
+
+    std::atomic<bool> noMemory(!allocated);
+    bool ok = allocated && runBlockPipeline(
+            windowNum, slots,
+            [&](int w, uint8_t *buffer) {
+                uint64_t begin = readBase + windowBegin(w);
+                uint64_t end = readBase + windowEnd(w);
+                uint64_t alignedBegin = begin / align * align;
+                uint64_t alignedEnd = (end + align - 1) / align * align;
+                int64_t got = input.readAt(buffer, alignedEnd - alignedBegin, alignedBegin);
+                if (got < 0) {
+                    return false;
+                }
+                // 与 pread 后端一致：输入被截断时缺少的部分按 48 填充
+                uint64_t avail = std::min((uint64_t) std::max(got, (int64_t) 0), end - alignedBegin);
+                if (avail < end - alignedBegin) {
+                    uint64_t from = std::max(avail, begin - alignedBegin);
+                    memset(buffer + from, 48, end - alignedBegin - from);
+                }
+                return true;
+            },
+            [&](int w, uint8_t *buffer) {
+                uint8_t *data = buffer + windowDelta(w);
+                int first = windows[w];
+                ThreadPool::shared().parallelFor(windows[w + 1] - first, THREAD_NUM, [&](int k) {
+                    int i = first + k;
+                    uint8_t *block = data + (table.offsets[i] - windowBegin(w));
+                    int realSize = blockRealSize(table, i, length);
+                    const uint8_t *x = table.keyStream(i);
+                    // 校验失败的窗口不再写出，写线程据此停止流水线
+                    if (decrypt && !checkBlock(check, i, block, realSize)) {
+                        return;
+                    }
+                    if (!cryptBufferBlock(block, length - table.offsets[i], table.rows(i), table.cols(i), x,
+                                          x + table.keyLength(i), decrypt)) {
+                        noMemory = true;
+                        return;
+                    }
+                    if (!decrypt) {
+                        checkBlock(check, i, block, realSize);
+                    }
+                });
+            },
+            [&](int w, const uint8_t *buffer) {
+                if ((check != nullptr && check->corrupted) || noMemory) {
+                    return false;
+                }
+                // staging 开头是上一次写出后剩下的不足一个对齐单元的内容
+                if (w == 0 && carryLen > 0) {
+                    memcpy(staging, head.data(), carryLen);
+                }
+                size_t len = (size_t) (windowEnd(w) - windowBegin(w));
+                memcpy(staging + carryLen, buffer + windowDelta(w), len);
+                size_t total = carryLen + len;
+                size_t writeLen = total / align * align;
+                if (w + 1 == windowNum && writeLen < total) {
+                    // 最后一次写出补齐到对齐边界，多出的部分随后截断
+                    writeLen += align;
+                    memset(staging + total, 0, writeLen - total);
+                }
+                if (writeLen > 0 && !output.writeAt(staging, writeLen, outStart)) {
+                    return false;
+                }
+                outStart += writeLen;
+                carryLen = total > writeLen ? total - writeLen : 0;
+                memmove(staging, staging + writeLen, carryLen);
+                return true;
+            });
+
+    for (int s = 0; s < CHAOS_PIPELINE_DEPTH; s++) {
+        alignedFree(slots[s]);
+    }
+    alignedFree(staging);
+    input.setDirect(false);
+    output.setDirect(false);
+    if (noMemory) {
+        return FILE_BLOCKS_NO_MEMORY;
+    }
+    return ok && output.truncate(writeBase + length) ? FILE_BLOCKS_OK : FILE_BLOCKS_FAILED;
+}
+
+// 按全局块表并行加解密整个文件：input 中 readBase 之后的 length 字节写到 output 的 writeBase 之后
+// check 为空时不生成也不核对块校验表
+// 返回 FILE_BLOCKS_OK、FILE_BLOCKS_FAILED 或 FILE_BLOCKS_NO_MEMORY
+static int cryptFileBlocks_OMP(int THREAD_NUM, ChaosFile &input, uint64_t readBase, ChaosFile &output,
+                               uint64_t writeBase, const CHAOS_BLOCK_TABLE &table, uint64_t length, bool decrypt,
+                               BLOCK_CHECK *check) {
+    if (table.blockNum() == 0) {
+        return FILE_BLOCKS_OK;
+    }
+    int backend = getFileIoBackend();
+    int ret = FILE_BLOCKS_UNSUPPORTED;
+    if (backend == CHAOS_IO_URING) {
+        ret = cryptFileBlocksUring(THREAD_NUM, input, readBase, output, writeBase, table, length, decrypt, check);
+    } else if (backend == CHAOS_IO_DIRECT) {
+        ret = cryptFileBlocksDirect(THREAD_NUM, input, readBase, output, writeBase, table, length, decrypt, check);
+    }
+    if (ret != FILE_BLOCKS_UNSUPPORTED) {
+        return ret;
+    }
+    return cryptFileBlocksPositional(THREAD_NUM, input, readBase, output, writeBase, table, length, decrypt, check);
+}
+
+// 读取块校验表，文件短于校验表末尾（被截断）时返回 false
+static bool readBlockCrcTable(const ChaosFile &file, const CHAOS_FILE_HEADER &header, int blockNum,
+                              std::vector<uint32_t> &crcs) {
+    uint64_t crcTableSize = 4 * (uint64_t) blockNum;
+    if (file.size() < header.crcTableOffset + crcTableSize) {
+        return false;
+    }
+    std::vector<uint8_t> bytes(crcTableSize);
+    if (file.readAt(bytes.data(), crcTableSize, header.crcTableOffset) != (int64_t) crcTableSize) {
+        return false;
+    }
+    crcs.resize(blockNum);
+    decodeBlockCrcTable(bytes.data(), crcs);
+    return true;
+}
+
 /**
  * 有密钥-文件加密-多线程
  * @param THREAD_NUM 线程数量
@@ -62,131 +576,72 @@ encryptFileWithKey_OMP(int THREAD_NUM, std::string key, std::string inputPath, s
         result.errorMsg = "Output file path cannot be empty.";
         return result;
     }
+    // 4.线程数量
+    if (THREAD_NUM < 1) {
+        result.errorMsg = "Thread count must be at least 1.";
+        return result;
+    }
 
     // 计算一个加密时间
     uint64_t fileLength = 0;
     auto start = std::chrono::steady_clock::now();
-//     #ifdef _WIN32
-//         std::wstring wInput = utf8_to_wstring(inputPath);
-//         std::wstring wOutput = utf8_to_wstring(outputPath);
-//         std::ifstream file(wInput, std::ios::binary);
-//         std::ofstream outputFile(wOutput, std::ios::binary);
-//     #else
-       std::ifstream file(fs::u8path(inputPath).wstring(), std::ios::binary);
-               std::ofstream outputFile(fs::u8path(outputPath).wstring(), std::ios::binary);
-//     #endif
-    if (!file) {
+    ChaosFile file;
+    ChaosFile outputFile;
+    if (!file.openRead(inputPath)) {
         result.success = 0;
         result.errorMsg = "无法打开文件,加密失败";
         return result;
     }
+    if (!outputFile.openWrite(outputPath)) {
+        result.errorMsg = "无法创建输出文件,加密失败";
+        return result;
+    }
 //     printf("执行进入了 生成随机数\n");
-    double x0, y0, z0,  u, r, l;
-    std::string hash = sha256_hash(key);
-    generateRandom3(hash, x0, y0,  z0,u, r,l);
+    int flags = newFileFlags();
+    CHAOS_FILE_MAP map;
+    initFileMap(getKeySchedule(key), getFileMapId(), flags, map);
 
 
     // 确定文件大小
-    file.seekg(0, std::ios::end);
-    std::streampos fileSize = file.tellg();
-    fileLength = (uint64_t) fileSize;
-    // 到文件开头,写入密文前缀
-    std::string emLenStr = "";
-    Len_t lenBit;
-    lenBit.len64 = static_cast<uint64_t>(fileSize);
-    getEmLenStr(lenBit, emLenStr);
-    outputFile.write(emLenStr.c_str(), emLenStr.length() * sizeof(char));
-    // file.close();
-    omp_set_num_threads(THREAD_NUM);
-#pragma omp parallel firstprivate(x0, y0,z0, u, r,l)
-    {
-        std::ifstream localfile(fs::u8path(inputPath).wstring(), std::ios::binary);
-        // std::ifstream threadFile = file;
-        int numThreads = omp_get_num_threads();
-//         printf( "Thread NUMS: %d\n", numThreads);
-//         std::cout << "Thread NUMS: " << numThreads << std::endl;
-        int id = omp_get_thread_num();
-        // std::cout << "id: " << id << " 线程数目：" << numThreads << std::endl;
-
-        uint64_t fileSize_own = fileSize / numThreads;
-        // std::cout << "input file size: " << (uint64_t)fileSize << " B" << std::endl;
-        std::vector<int> blockSizeArr = splitBlockSize(fileSize_own);
-
-        int blockIndex = 0;
-        int indexAll = blockSizeArr.size();
-        uint64_t read_offset = 0;
-        uint64_t write_offset = 0;
-        uint64_t startLoc = id * fileSize_own;
-        uint64_t limitLoc = (id + 1) * fileSize_own;
-        uint64_t resetSize;
-        // 实际获取长度
-        int realSize;
-        // std::cout << "ID: " << id << " 读取位置：" << id * fileSize_own << std::endl;
-        for (blockIndex = 0; blockIndex < indexAll; blockIndex = blockIndex + 2) {
-            // if (!localfile.good())
-            // {
-            //     std::cerr << "ID: " << id << "Error with file state." << std::endl;
-            //     return 0;
-            //     // 可能需要退出或采取其他措施
-            //     // exit;
-            // }
-            // 读取当前数据块的字节数据
-            int currBlockSize = blockSizeArr[blockIndex];
-            unsigned char *buffer = (unsigned char *) malloc(currBlockSize * sizeof(unsigned char));
-            memset(buffer, 48, currBlockSize);
-            // #pragma omp critical
-            //             {
-            // // 更新文件状态
-            // std::cout << "ID:" << id << " open: " << outputFile.is_open() << " eof: " << outputFile.eof() << " bad: " << outputFile.bad() << " fail: " << outputFile.fail() << std::endl;
-            // std::cout << "ID:" << id << " open: " << file.is_open() << " eof: " << file.eof() << " bad: " << file.bad() << " fail: " << file.fail() << std::endl;
-
-            localfile.seekg(startLoc + read_offset, std::ios::beg);
-            // 获取当前文件指针的位置
-            // std::cout << "ID: " << id << " 开始位置：" << startLoc + read_offset;
-            std::streampos currentPosition = localfile.tellg();
-            // std::cout << " 当前位置：" << currentPosition << " 限制位置: " << limitLoc - 1 << std::endl;
-            resetSize = limitLoc - static_cast<uint64_t>(currentPosition);
-            localfile.read(reinterpret_cast<char *>(buffer), currBlockSize);
-            realSize = resetSize > currBlockSize ? localfile.gcount() : resetSize;
-            // if (resetSize > currBlockSize)
-            // {
-            //     realSize = localfile.gcount();
-            // }
-            // else
-            // {
-            //     realSize = resetSize;
-            // }
-
-            // std::cout << "ID: " << id << " 当前位置：" << currentPosition << " 限制位置：" << limitLoc << " 剩余长度：" << resetSize << " 实际长度：" << realSize << " buffer大小：" << currBlockSize << " 矩阵宽度： " << blockSizeArr[blockIndex + 1] << std::endl;
-            encode_Block3(buffer, blockSizeArr[blockIndex + 1], blockSizeArr[blockIndex + 1], x0, y0,z0, u, r,l);
-#pragma omp critical
-            {
-                outputFile.seekp(emLenStr.length() + startLoc + write_offset, std::ios::beg);
-                outputFile.write(reinterpret_cast<char *>(buffer), realSize * sizeof(char));
-                free(buffer);
-            }
-
-            read_offset += realSize;
-            write_offset += realSize;
-            // #pragma omp barrier
-        }
-        // }
-        // #pragma omp barrier
-        localfile.close();
+    uint64_t fileSize = file.size();
+    fileLength = fileSize;
+    // 到文件开头,写入 v2 文件头
+    uint8_t header[CHAOS_FILE_HEADER_SIZE];
+    writeFileHeader(fileSize, flags, map.mapId, header);
+    uint64_t write_loc_start_up = CHAOS_FILE_HEADER_SIZE;
+    // 全局块表：整个文件只分一次块，混沌状态按块顺序串行推进（独立块初值时并行生成），各块的密钥流预先生成
+    CHAOS_BLOCK_TABLE table;
+    buildBlockTableMap(table, fileLength, map, THREAD_NUM);
+    // 输出文件一次分配到最终大小（含块校验表），各线程的写入不会再扩展文件
+    uint64_t crcTableSize = 4 * (uint64_t) table.blockNum();
+    outputFile.preallocate(write_loc_start_up + fileLength + crcTableSize);
+    if (!outputFile.writeAt(header, CHAOS_FILE_HEADER_SIZE, 0)) {
+        result.errorMsg = "写入文件失败,加密失败";
+        return result;
     }
-    // 剩余内容直接写入
-    uint64_t reSize = fileSize - (fileSize / THREAD_NUM) * THREAD_NUM;
-    if (reSize) {
-        file.seekg((fileSize / THREAD_NUM) * THREAD_NUM, std::ios::beg);
-        outputFile.seekp(emLenStr.length() + (fileSize / THREAD_NUM) * THREAD_NUM, std::ios::beg);
-        char *buffer = (char *) malloc(reSize * sizeof(char));
-        file.read(buffer, reSize);
-        outputFile.write(buffer, reSize * sizeof(char));
-        free(buffer);
+    // 空闲线程领取下一个块，慢核只会少处理几个块，不会拖住整体，也没有串行收尾；
+    // 各块密文的 CRC32 在加密后随即计算
+    BLOCK_CHECK check;
+    check.crcs.resize(table.blockNum());
+    int status = cryptFileBlocks_OMP(THREAD_NUM, file, 0, outputFile, write_loc_start_up, table, fileLength, false,
+                                     &check);
+    bool ok = status == FILE_BLOCKS_OK;
+    if (ok && crcTableSize > 0) {
+        std::vector<uint8_t> crcTable(crcTableSize);
+        encodeBlockCrcTable(check.crcs, crcTable.data());
+        ok = outputFile.writeAt(crcTable.data(), crcTableSize, write_loc_start_up + fileLength);
     }
     // 关闭文件
     file.close();
     outputFile.close();
+    if (status == FILE_BLOCKS_NO_MEMORY) {
+        result.errorMsg = "内存不足,加密失败";
+        return result;
+    }
+    if (!ok) {
+        result.errorMsg = "读写文件失败,加密失败";
+        return result;
+    }
     // 计算速度
     auto end = std::chrono::steady_clock::now();
     auto durationMill = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
@@ -219,131 +674,75 @@ decryptFileWithKey_OMP(int THREAD_NUM, std::string key, std::string inputPath, s
         result.errorMsg = "Output file path cannot be empty.";
         return result;
     }
+    // 4.线程数量
+    if (THREAD_NUM < 1) {
+        result.errorMsg = "Thread count must be at least 1.";
+        return result;
+    }
     // 计算一个加密时间
     uint64_t fileLength = 0;
     auto start = std::chrono::steady_clock::now();
-//     #ifdef _WIN32
-//         std::wstring wInput = utf8_to_wstring(inputPath);
-//         std::wstring wOutput = utf8_to_wstring(outputPath);
-//         std::ifstream file(wInput, std::ios::binary);
-//         std::ofstream outputFile(wOutput, std::ios::binary);
-//     #else
-        std::ifstream file(fs::u8path(inputPath).wstring(), std::ios::binary);
-                       std::ofstream outputFile(fs::u8path(outputPath).wstring(), std::ios::binary);
-//     #endif
-    if (!file) {
+    ChaosFile file;
+    ChaosFile outputFile;
+    if (!file.openRead(inputPath)) {
         result.success = 0;
         result.errorMsg = "无法打开文件,加密失败";
         return result;
     }
+    if (!outputFile.openWrite(outputPath)) {
+        result.errorMsg = "无法创建输出文件,解密失败";
+        return result;
+    }
 
-    double x0, y0,z0, u, r,l;
-    std::string hash = sha256_hash(key);
-    generateRandom3(hash, x0, y0,z0, u, r,l);
-
-    // 读取密文前缀长
-    file.seekg(0, std::ios::beg);
-    char *lenbf = (char *) malloc(3 * sizeof(char));
-    file.read(lenbf, 2 * sizeof(char));
-    lenbf[2] = '\0';
-    int len8 = static_cast<int>(std::stoi(lenbf, 0, 16));
-    char *lenBuffer = (char *) malloc((len8 / 4 + 1) * sizeof(char));
-    file.read(lenBuffer, len8 / 4 * sizeof(char));
-    lenBuffer[len8 / 4] = '\0';
-    uint64_t len64 = static_cast<uint64_t>(std::stoi(lenBuffer, 0, 16));
-    uint64_t fileSize = len64;
+    // 一次读取文件头，兼容 v1 的十六进制长度前缀
+    uint8_t headerBuf[CHAOS_FILE_HEADER_SIZE];
+    int64_t headerGot = file.readAt(headerBuf, CHAOS_FILE_HEADER_SIZE, 0);
+    CHAOS_FILE_HEADER header;
+    if (headerGot < 0 || !parseFileHeader(headerBuf, (size_t) headerGot, header)) {
+        result.errorMsg = "密文格式错误,解密失败";
+        return result;
+    }
+    // 使用文件头中记录的映射
+    CHAOS_FILE_MAP map;
+    initFileMap(getKeySchedule(key), header.mapId, header.flags, map);
+    uint64_t fileSize = header.plainLength;
     fileLength = (uint64_t) fileSize;
-    uint64_t read_loc_start_up = 2 + len8 / 4;
+    uint64_t read_loc_start_up = header.dataOffset;
     std::cout << "input file size: " << (uint64_t)fileSize << " B" << std::endl;
-    free(lenBuffer);
-    free(lenbf);
-
-    omp_set_num_threads(THREAD_NUM);
-#pragma omp parallel firstprivate(x0, y0,z0, u, r,l)
-    {
-        std::ifstream localfile(fs::u8path(inputPath).wstring(), std::ios::binary);
-        int numThreads = omp_get_num_threads();
-//        std::cout << "Thread NUMS: " << numThreads << std::endl;
-        int id = omp_get_thread_num();
-        // std::cout << "id: " << id << " 线程数目：" << numThreads << std::endl;
-        uint64_t fileSize_own = fileSize / numThreads;
-
-        std::vector<int> blockSizeArr = splitBlockSize(fileSize_own);
-
-        int blockIndex = 0;
-        int indexAll = blockSizeArr.size();
-        uint64_t read_offset = 0;
-        uint64_t write_offset = 0;
-        uint64_t startLoc = read_loc_start_up + id * fileSize_own;
-        uint64_t limitLoc = read_loc_start_up + (id + 1) * fileSize_own;
-        uint64_t resetSize;
-
-        // 实际获取长度
-        int realSize;
-
-        for (blockIndex = 0; blockIndex < indexAll; blockIndex = blockIndex + 2) {
-            // if (!localfile.good())
-            // {
-            //     std::cerr << "ID: " << id << "Error with file state." << std::endl;
-            //     return 0;
-            //     // 可能需要退出或采取其他措施
-            //     // exit;
-            // }
-            // 读取当前数据块的字节数据
-            int currBlockSize = blockSizeArr[blockIndex];
-
-            unsigned char *buffer = (unsigned char *) malloc(currBlockSize * sizeof(unsigned char));
-            // std::cout << "ID: " << id << " 创建分区： " << currBlockSize << std::endl;
-            memset(buffer, 48, currBlockSize);
-
-            localfile.seekg(startLoc + read_offset, std::ios::beg);
-            // std::cout << "前缀长度：" << read_loc_start_up << " 写入位置：" << id * fileSize_own << std::endl;
-            //  获取当前文件指针的位置
-            // std::cout << "ID: " << id << " 开始位置：" << startLoc + read_offset;
-            std::streampos currentPosition = localfile.tellg();
-            // std::cout << " 当前位置：" << currentPosition << " 限制位置: " << limitLoc - 1 << std::endl;
-            resetSize = limitLoc - static_cast<uint64_t>(currentPosition);
-            localfile.read(reinterpret_cast<char *>(buffer), currBlockSize);
-            realSize = resetSize > currBlockSize ? localfile.gcount() : resetSize;
-            // if (resetSize > currBlockSize)
-            // {
-            //     realSize = localfile.gcount();
-            // }
-            // else
-            // {
-            //     realSize = resetSize;
-            // }
-            // std::cout << "ID: " << id << " 当前位置：" << currentPosition << " 限制位置：" << limitLoc << " 剩余长度：" << resetSize << " 实际长度：" << realSize << " buffer大小：" << currBlockSize << " 矩阵宽度： " << blockSizeArr[blockIndex + 1] << std::endl;
-            decode_Block3(buffer, blockSizeArr[blockIndex + 1], blockSizeArr[blockIndex + 1], x0, y0,z0, u, r,l);
-#pragma omp critical
-            {
-                outputFile.seekp(id * fileSize_own + write_offset, std::ios::beg);
-                outputFile.write(reinterpret_cast<char *>(buffer), realSize * sizeof(char));
-                free(buffer);
-            }
-
-            read_offset += realSize;
-            write_offset += realSize;
-            // std::cout << "ID: " << id << " 释放分区：" << currBlockSize << std ::endl;
-        }
 
-        // #pragma omp barrier
-        localfile.close();
-    }
-    // 剩余内容直接写入
-    uint64_t reSize = fileSize - (fileSize / THREAD_NUM) * THREAD_NUM;
-    if (reSize) {
-        file.seekg(read_loc_start_up + (fileSize / THREAD_NUM) * THREAD_NUM, std::ios::beg);
-        outputFile.seekp((fileSize / THREAD_NUM) * THREAD_NUM, std::ios::beg);
-        char *buffer = (char *) malloc(reSize * sizeof(char));
-        file.read(buffer, reSize);
-        outputFile.write(buffer, reSize * sizeof(char));
-        free(buffer);
+    // 与加密相同的全局块表
+    CHAOS_BLOCK_TABLE table;
+    buildBlockTableMap(table, fileLength, map, THREAD_NUM);
+    // 带块校验表的密文在解密每块之前先核对，v1 与不带校验表的密文不校验
+    BLOCK_CHECK check;
+    check.verify = true;
+    if (header.crcTableOffset != 0 && !readBlockCrcTable(file, header, table.blockNum(), check.crcs)) {
+        result.errorMsg = "密文不完整,解密失败";
+        return result;
     }
+    outputFile.preallocate(fileLength);
+    int status = cryptFileBlocks_OMP(THREAD_NUM, file, read_loc_start_up, outputFile, 0, table, fileLength, true,
+                                     header.crcTableOffset != 0 ? &check : nullptr);
 
     // 关闭文件
     file.close();
+    if (check.corrupted || status == FILE_BLOCKS_NO_MEMORY) {
+        // 不留下部分解密的内容
+        outputFile.truncate(0);
+    }
     outputFile.close();
+    if (check.corrupted) {
+        result.errorMsg = "密文校验失败,文件已损坏";
+        return result;
+    }
+    if (status == FILE_BLOCKS_NO_MEMORY) {
+        result.errorMsg = "内存不足,解密失败";
+        return result;
+    }
+    if (status != FILE_BLOCKS_OK) {
+        result.errorMsg = "读写文件失败,解密失败";
+        return result;
+    }
     // 计算速度
     auto end = std::chrono::steady_clock::now();
     auto durationMill = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
@@ -357,3 +756,640 @@ decryptFileWithKey_OMP(int THREAD_NUM, std::string key, std::string inputPath, s
 }
 
 
+
+CHAOS_OPERATION_RESULT verifyFile_OMP(int THREAD_NUM, std::string path) {
+    CHAOS_OPERATION_RESULT result = {0, "", ""};
+    if (THREAD_NUM < 1) {
+        result.errorMsg = "Thread count must be at least 1.";
+        return result;
+    }
+    auto start = std::chrono::steady_clock::now();
+    ChaosFile file;
+    if (!file.openRead(path)) {
+        result.errorMsg = "无法打开文件,校验失败";
+        return result;
+    }
+    uint8_t headerBuf[CHAOS_FILE_HEADER_SIZE];
+    int64_t headerGot = file.readAt(headerBuf, CHAOS_FILE_HEADER_SIZE, 0);
+    CHAOS_FILE_HEADER header;
+    if (headerGot < 0 || !parseFileHeader(headerBuf, (size_t) headerGot, header)) {
+        result.errorMsg = "密文格式错误,校验失败";
+        return result;
+    }
+    if (header.crcTableOffset == 0) {
+        result.errorMsg = "密文没有块校验表,无法校验";
+        return result;
+    }
+    uint64_t length = header.plainLength;
+    std::vector<int> blockSizeArr = splitFileBlocks(length, header.flags);
+    int blockNum = (int) blockSizeArr.size() / 2;
+    std::vector<uint32_t> crcs;
+    if (!readBlockCrcTable(file, header, blockNum, crcs)) {
+        result.errorMsg = "密文不完整";
+        return result;
+    }
+    std::vector<uint64_t> offsets(blockNum);
+    for (int i = 1; i < blockNum; i++) {
+        offsets[i] = offsets[i - 1] + blockSizeArr[2 * (i - 1)];
+    }
+    // 空闲线程领取下一个块，读出后只计算 CRC32，不做加解密
+    std::atomic<int> nextBlock(0);
+    std::atomic<int> badBlock(-1);
+    std::atomic<bool> ioFailed(false);
+    std::atomic<bool> noMemory(false);
+    ThreadPool::shared().parallelFor(THREAD_NUM, THREAD_NUM, [&](int) {
+        BlockPool &pool = BlockPool::local();
+        uint8_t *buffer = pool.acquire();
+        if (buffer == nullptr) {
+            noMemory = true;
+            ioFailed = true;
+            return;
+        }
+        for (int i = nextBlock++; i < blockNum && badBlock < 0 && !ioFailed; i = nextBlock++) {
+            int realSize = (int) std::min((uint64_t) blockSizeArr[2 * i], length - offsets[i]);
+            int64_t got = file.readAt(buffer, realSize, header.dataOffset + offsets[i]);
+            if (got < 0) {
+                ioFailed = true;
+                break;
+            }
+            if (got != realSize || blockCrc32(buffer, realSize) != crcs[i]) {
+                int expected = -1;
+                badBlock.compare_exchange_strong(expected, i);
+                break;
+            }
+        }
+        pool.release(buffer);
+    });
+    if (noMemory) {
+        result.errorMsg = "内存不足,校验失败";
+        return result;
+    }
+    if (ioFailed) {
+        result.errorMsg = "读取文件失败,校验失败";
+        return result;
+    }
+    if (badBlock >= 0) {
+        result.errorMsg = "第 " + std::to_string(badBlock.load()) + " 块校验失败,文件已损坏";
+        result.result = std::to_string(badBlock.load());
+        return result;
+    }
+    auto end = std::chrono::steady_clock::now();
+    auto durationMill = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    result.mill = durationMill.count();
+    result.size = length;
+    result.speed =
+            static_cast<float >(length) * 8 / 1024 / 1024 / 1024 / static_cast<float>(durationMill.count()) * 1000;
+    result.success = 1;
+    return result;
+}
+
+CHAOS_OPERATION_RESULT fingerprintFile(std::string path) {
+    CHAOS_OPERATION_RESULT result = {0, "", ""};
+    auto start = std::chrono::steady_clock::now();
+    ChaosFile file;
+    if (!file.openRead(path)) {
+        result.errorMsg = "无法打开文件,计算指纹失败";
+        return result;
+    }
+    uint64_t length = file.size();
+    // SHA-256 只能顺序计算，按块缓冲大小分段，读线程预读下一段的同时调用线程哈希当前段
+    const uint64_t chunkSize = BlockPool::local().bufferSize();
+    int chunkNum = (int) ((length + chunkSize - 1) / chunkSize);
+    auto chunkLength = [&](int i) {
+        return (size_t) std::min(chunkSize, length - (uint64_t) i * chunkSize);
+    };
+    SHA256_CTX ctx;
+    sha256_init(&ctx);
+    bool ok = runBlockPipeline(
+            chunkNum,
+            [&](int i, uint8_t *buffer) {
+                return file.readAt(buffer, chunkLength(i), (uint64_t) i * chunkSize) == (int64_t) chunkLength(i);
+            },
+            [&](int i, uint8_t *buffer) {
+                sha256_update(&ctx, buffer, chunkLength(i));
+            },
+            [](int, const uint8_t *) {
+                return true;
+            });
+    if (!ok) {
+        result.errorMsg = "读取文件失败,计算指纹失败";
+        return result;
+    }
+    BYTE digest[SHA256_BLOCK_SIZE];
+    sha256_final(&ctx, digest);
+    auto end = std::chrono::steady_clock::now();
+    auto durationMill = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    result.result = sha256_to_hex(digest);
+    result.mill = durationMill.count();
+    result.size = length;
+    result.speed =
+            static_cast<float >(length) * 8 / 1024 / 1024 / 1024 / static_cast<float>(durationMill.count()) * 1000;
+    result.success = 1;
+    return result;
+}
+
+// 原地加密的文件尾
+struct INPLACE_TRAILER {
+    int state;
+    int flags;
+    int mapId;
+    uint32_t keyCheck;
+    uint32_t crc;
+};
+
+// 原地模式的密钥校验值：magic 与密钥拼接后 SHA-256 摘要的前 4 字节
+static uint32_t inPlaceKeyCheck(const std::string &key) {
+    std::string salted = CHAOS_INPLACE_MAGIC + key;
+    BYTE digest[SHA256_BLOCK_SIZE];
+    sha256_digest(salted.data(), salted.length(), digest);
+    return digest[0] | ((uint32_t) digest[1] << 8) | ((uint32_t) digest[2] << 16) | ((uint32_t) digest[3] << 24);
+}
+
+// 读取原地加密的文件尾，没有文件尾或状态、映射、标志不被本版本支持时返回 false
+static bool readInPlaceTrailer(const ChaosFile &file, uint64_t fileSize, INPLACE_TRAILER &trailer) {
+    if (fileSize < CHAOS_INPLACE_TRAILER_SIZE) {
+        return false;
+    }
+    uint8_t buf[CHAOS_INPLACE_TRAILER_SIZE];
+    if (file.readAt(buf, CHAOS_INPLACE_TRAILER_SIZE, fileSize - CHAOS_INPLACE_TRAILER_SIZE) !=
+        CHAOS_INPLACE_TRAILER_SIZE || memcmp(buf, CHAOS_INPLACE_MAGIC, 4) != 0) {
+        return false;
+    }
+    trailer.state = buf[4];
+    trailer.flags = buf[5];
+    trailer.mapId = buf[6] | (buf[7] << 8);
+    trailer.keyCheck = buf[8] | ((uint32_t) buf[9] << 8) | ((uint32_t) buf[10] << 16) | ((uint32_t) buf[11] << 24);
+    trailer.crc = buf[12] | ((uint32_t) buf[13] << 8) | ((uint32_t) buf[14] << 16) | ((uint32_t) buf[15] << 24);
+    return trailer.state >= CHAOS_INPLACE_ENCRYPTING && trailer.state <= CHAOS_INPLACE_DECRYPTED &&
+           (trailer.mapId == CHAOS_MAP_3D || trailer.mapId == CHAOS_MAP_FIXED) &&
+           (trailer.flags & ~(CHAOS_FILE_FLAGS_KNOWN & ~CHAOS_FILE_FLAG_BLOCK_CRC)) == 0;
+}
+
+// 在 offset 处写入文件尾并落盘
+static bool writeInPlaceTrailer(const ChaosFile &file, uint64_t offset, const INPLACE_TRAILER &trailer) {
+    uint8_t buf[CHAOS_INPLACE_TRAILER_SIZE];
+    memcpy(buf, CHAOS_INPLACE_MAGIC, 4);
+    buf[4] = (uint8_t) trailer.state;
+    buf[5] = (uint8_t) trailer.flags;
+    buf[6] = (uint8_t) trailer.mapId;
+    buf[7] = (uint8_t) (trailer.mapId >> 8);
+    for (int i = 0; i < 4; i++) {
+        buf[8 + i] = (uint8_t) (trailer.keyCheck >> (8 * i));
+        buf[12 + i] = (uint8_t) (trailer.crc >> (8 * i));
+    }
+    return file.writeAt(buf, CHAOS_INPLACE_TRAILER_SIZE, offset) && file.sync();
+}
+
+// cryptMappedFile_OMP 的额外结果：数据的 CRC32 与文件尾记录的不一致
+#define INPLACE_CRC_MISMATCH (-3)
+
+/**
+ * 原地加解密的一次状态转换：映射数据，核对其 CRC32 与 trailer.crc，写入 running 状态的文件尾后按文件尾记录的映射、
+ * 标志加解密，数据 msync 落盘后写入 done 状态与新数据的 CRC32
+ * @param verify 为 false 时不核对（数据还没有文件尾）
+ * @return FILE_BLOCKS_STATUS；数据与 trailer.crc 不一致时为 INPLACE_CRC_MISMATCH，文件未被改动
+ */
+static int cryptMappedFile_OMP(int THREAD_NUM, const std::string &key, const ChaosFile &file, uint64_t length,
+                               INPLACE_TRAILER &trailer, int running, int done, bool verify, bool decrypt) {
+    uint8_t *data = nullptr;
+    if (length > 0) {
+        data = file.map(length);
+        if (data == nullptr) {
+            return FILE_BLOCKS_FAILED;
+        }
+    }
+    uint32_t crc = bufferCrc32(data, length);
+    if (verify && crc != trailer.crc) {
+        if (data != nullptr) {
+            file.unmap(data, length);
+        }
+        return INPLACE_CRC_MISMATCH;
+    }
+    trailer.state = running;
+    trailer.crc = crc;
+    if (!writeInPlaceTrailer(file, length, trailer)) {
+        if (data != nullptr) {
+            file.unmap(data, length);
+        }
+        return FILE_BLOCKS_FAILED;
+    }
+    bool ok = true;
+    if (data != nullptr) {
+        CHAOS_FILE_MAP map;
+        initFileMap(getKeySchedule(key), trailer.mapId, trailer.flags, map);
+        CHAOS_BLOCK_TABLE table;
+        buildBlockTableMap(table, length, map, THREAD_NUM);
+        ok = cryptBlockTable(table, data, length, THREAD_NUM, decrypt);
+        crc = bufferCrc32(data, length);
+        if (!file.unmap(data, length)) {
+            return FILE_BLOCKS_FAILED;
+        }
+    }
+    // 部分块没有处理时停留在 running 状态
+    if (!ok) {
+        return FILE_BLOCKS_NO_MEMORY;
+    }
+    trailer.state = done;
+    trailer.crc = crc;
+    return writeInPlaceTrailer(file, length, trailer) ? FILE_BLOCKS_OK : FILE_BLOCKS_FAILED;
+}
+
+/**
+ * 有密钥-文件原地加密-多线程
+ */
+CHAOS_OPERATION_RESULT encryptFileInPlace_OMP(int THREAD_NUM, std::string key, std::string path) {
+    // 初始化结果为失败,错误信息为空
+    CHAOS_OPERATION_RESULT result = {0, "", ""};
+    if (key.length() < 8 || key.length() > 256) {
+        result.errorMsg = "Key must be between 8 and 256 characters.";
+        return result;
+    }
+    if (path.empty()) {
+        result.errorMsg = "File path cannot be empty.";
+        return result;
+    }
+    if (THREAD_NUM < 1) {
+        result.errorMsg = "Thread count must be at least 1.";
+        return result;
+    }
+    auto start = std::chrono::steady_clock::now();
+    ChaosFile file;
+    if (!file.openReadWrite(path)) {
+        result.errorMsg = "无法打开文件,加密失败";
+        return result;
+    }
+    uint64_t fileLength = file.size();
+    INPLACE_TRAILER trailer;
+    bool resume = readInPlaceTrailer(file, fileLength, trailer);
+    if (resume) {
+        // 只有被中断的加密可以继续，沿用文件尾中记录的映射与标志
+        if (trailer.state != CHAOS_INPLACE_ENCRYPTING) {
+            result.errorMsg = "文件已经是原地加密的密文";
+            return result;
+        }
+        if (trailer.keyCheck != inPlaceKeyCheck(key)) {
+            result.errorMsg = "密钥与被中断的加密不一致,加密失败";
+            return result;
+        }
+        fileLength -= CHAOS_INPLACE_TRAILER_SIZE;
+    } else {
+        trailer.flags = newFileFlags() & ~CHAOS_FILE_FLAG_BLOCK_CRC;
+        trailer.mapId = getFileMapId();
+        trailer.keyCheck = inPlaceKeyCheck(key);
+        trailer.crc = 0;
+    }
+    int status = cryptMappedFile_OMP(THREAD_NUM, key, file, fileLength, trailer, CHAOS_INPLACE_ENCRYPTING,
+                                     CHAOS_INPLACE_ENCRYPTED, resume, false);
+    if (status != FILE_BLOCKS_OK) {
+        if (status == INPLACE_CRC_MISMATCH) {
+            result.errorMsg = "上次加密被中断且数据已部分加密,无法恢复";
+        } else {
+            result.errorMsg = status == FILE_BLOCKS_NO_MEMORY ? "内存不足,加密失败" : "文件映射失败,加密失败";
+        }
+        return result;
+    }
+    file.close();
+
+    auto end = std::chrono::steady_clock::now();
+    auto durationMill = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    result.mill = durationMill.count();
+    result.size = fileLength;
+    result.speed = durationMill.count() > 0
+                   ? static_cast<float>(fileLength) * 8 / 1024 / 1024 / 1024 / static_cast<float>(durationMill.count()) * 1000
+                   : 0;
+    result.success = 1;
+    return result;
+}
+
+/**
+ * 有密钥-文件原地解密-多线程
+ */
+CHAOS_OPERATION_RESULT decryptFileInPlace_OMP(int THREAD_NUM, std::string key, std::string path) {
+    // 初始化结果为失败,错误信息为空
+    CHAOS_OPERATION_RESULT result = {0, "", ""};
+    if (key.length() < 8 || key.length() > 256) {
+        result.errorMsg = "Key must be between 8 and 256 characters.";
+        return result;
+    }
+    if (path.empty()) {
+        result.errorMsg = "File path cannot be empty.";
+        return result;
+    }
+    if (THREAD_NUM < 1) {
+        result.errorMsg = "Thread count must be at least 1.";
+        return result;
+    }
+    auto start = std::chrono::steady_clock::now();
+    ChaosFile file;
+    if (!file.openReadWrite(path)) {
+        result.errorMsg = "无法打开文件,解密失败";
+        return result;
+    }
+    INPLACE_TRAILER trailer;
+    uint64_t fileSize = file.size();
+    if (!readInPlaceTrailer(file, fileSize, trailer)) {
+        result.errorMsg = "不是原地加密的密文,无法解密";
+        return result;
+    }
+    if (trailer.keyCheck != inPlaceKeyCheck(key)) {
+        result.errorMsg = "密钥错误,解密失败";
+        return result;
+    }
+    uint64_t plainLength = fileSize - CHAOS_INPLACE_TRAILER_SIZE;
+    if (trailer.state == CHAOS_INPLACE_ENCRYPTED || trailer.state == CHAOS_INPLACE_DECRYPTING) {
+        // 解密被中断时，密文未被改动才能重新解密
+        int status = cryptMappedFile_OMP(THREAD_NUM, key, file, plainLength, trailer, CHAOS_INPLACE_DECRYPTING,
+                                         CHAOS_INPLACE_DECRYPTED, true, true);
+        if (status != FILE_BLOCKS_OK) {
+            if (status == INPLACE_CRC_MISMATCH) {
+                result.errorMsg = trailer.state == CHAOS_INPLACE_ENCRYPTED ? "密文校验失败,文件已损坏"
+                                                                         : "上次解密被中断且数据已部分解密,无法恢复";
+            } else {
+                result.errorMsg = status == FILE_BLOCKS_NO_MEMORY ? "内存不足,解密失败" : "文件映射失败,解密失败";
+            }
+            return result;
+        }
+    } else {
+        // 加密被中断或明文已落盘：数据就是明文，核对后只需去掉文件尾
+        uint8_t *data = plainLength > 0 ? file.map(plainLength) : nullptr;
+        if (plainLength > 0 && data == nullptr) {
+            result.errorMsg = "文件映射失败,解密失败";
+            return result;
+        }
+        bool intact = bufferCrc32(data, plainLength) == trailer.crc;
+        if (data != nullptr) {
+            file.unmap(data, plainLength);
+        }
+        if (!intact) {
+            result.errorMsg = trailer.state == CHAOS_INPLACE_ENCRYPTING ? "上次加密被中断且数据已部分加密,无法恢复"
+                                                                       : "明文校验失败,文件已损坏";
+            return result;
+        }
+    }
+    // 明文落盘之后再去掉文件尾
+    if (!file.truncate(plainLength) || !file.sync()) {
+        result.errorMsg = "去除文件尾失败,解密失败";
+        return result;
+    }
+    file.close();
+
+    auto end = std::chrono::steady_clock::now();
+    auto durationMill = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    result.mill = durationMill.count();
+    result.size = plainLength;
+    result.speed = durationMill.count() > 0
+                   ? static_cast<float>(plainLength) * 8 / 1024 / 1024 / 1024 / static_cast<float>(durationMill.count()) * 1000
+                   : 0;
+    result.success = 1;
+    return result;
+}
+
+// 多线程加密扩展性基准测试
+CHAOS_OPERATION_RESULT
+benchmarkFileScaling_OMP(int maxThreads, const std::string &key, const std::string &inputPath,
+                         const std::string &outputPath) {
+    CHAOS_OPERATION_RESULT result = {0, "", ""};
+    if (maxThreads < 1) {
+        result.errorMsg = "Thread count must be at least 1.";
+        return result;
+    }
+    std::string speeds = "";
+    auto start = std::chrono::steady_clock::now();
+    // 线程数依次取 1、2、4 ... 直到 maxThreads
+    for (int threads = 1;; threads = std::min(threads * 2, maxThreads)) {
+        auto runStart = std::chrono::steady_clock::now();
+        CHAOS_OPERATION_RESULT run = encryptFileWithKey_OMP(threads, key, inputPath, outputPath);
+        auto runEnd = std::chrono::steady_clock::now();
+        if (!run.success) {
+            return run;
+        }
+        double seconds = std::chrono::duration<double>(runEnd - runStart).count();
+        double speed = seconds > 0 ? static_cast<double>(run.size) * 8 / 1024 / 1024 / 1024 / seconds : 0;
+        if (!speeds.empty()) {
+            speeds += "|";
+        }
+        speeds += std::to_string(threads) + ":" + std::to_string(speed);
+        result.size = run.size;
+        result.speed = static_cast<float>(std::max((double) result.speed, speed));
+        if (threads == maxThreads) {
+            break;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    result.mill = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    result.result = speeds;
+    result.success = 1;
+    return result;
+}
+
+// 内存缓冲区加解密-多线程的公共部分
+// 混沌状态在块之间串行传递：先按顺序为每个块生成密钥流（每块仅 2*边长 字节），再由各线程并行完成扩散，
+// 因此结果与单线程版本逐字节一致，且与线程数无关
+static CHAOS_OPERATION_RESULT
+cryptBufferWithKey_OMP(int THREAD_NUM, const std::string &key, const uint8_t *input, uint8_t *output, uint64_t len,
+                       bool decrypt) {
+    // 初始化结果为失败,错误信息为空
+    CHAOS_OPERATION_RESULT result = {0, "", ""};
+    if (key.length() < 8 || key.length() > 256) {
+        result.errorMsg = "Key must be between 8 and 256 characters.";
+        return result;
+    }
+    if (input == nullptr || output == nullptr || len == 0) {
+        result.errorMsg = "Input buffer cannot be empty.";
+        return result;
+    }
+    if (THREAD_NUM < 1) {
+        result.errorMsg = "Thread count must be at least 1.";
+        return result;
+    }
+    auto start = std::chrono::steady_clock::now();
+    if (output != input) {
+        memmove(output, input, len);
+    }
+    const CHAOS_MAP3_PARAMS p = getKeySchedule(key).map3;
+    double x0 = p.x0, y0 = p.y0, z0 = p.z0, u = p.u, r = p.r, l = p.l;
+
+    CHAOS_BLOCK_TABLE table;
+    buildBlockTable3(table, len, x0, y0, z0, u, r, l);
+    if (!cryptBlockTable(table, output, len, THREAD_NUM, decrypt)) {
+        result.errorMsg = "Out of memory.";
+        return result;
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    auto durationMill = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    result.mill = durationMill.count();
+    result.size = len;
+    result.speed = durationMill.count() > 0
+                   ? static_cast<float>(len) * 8 / 1024 / 1024 / 1024 / static_cast<float>(durationMill.count()) * 1000
+                   : 0;
+    result.success = 1;
+    return result;
+}
+
+CHAOS_OPERATION_RESULT
+encryptBufferWithKey_OMP(int THREAD_NUM, const std::string &key, const uint8_t *input, uint8_t *output, uint64_t len) {
+    return cryptBufferWithKey_OMP(THREAD_NUM, key, input, output, len, false);
+}
+
+CHAOS_OPERATION_RESULT
+decryptBufferWithKey_OMP(int THREAD_NUM, const std::string &key, const uint8_t *input, uint8_t *output, uint64_t len) {
+    return cryptBufferWithKey_OMP(THREAD_NUM, key, input, output, len, true);
+}
+
+// 批量任务的粒度：每个线程池任务处理的消息条数，避免数万条短消息逐条争抢任务计数
+#define STR_BATCH_CHUNK 64
+
+// 字符串批量加解密的公共部分
+// 各条消息先并行处理到独立的结果中，再按前缀和得到偏移，并行拷贝进同一块 arena
+static CHAOS_OPERATION_RESULT
+cryptStrBatch_OMP(int THREAD_NUM, const CHAOS_KEY_SCHEDULE &schedule, const std::string_view *inputs, int count,
+                  int format, CHAOS_STR_BATCH &batch, bool decrypt) {
+    // 初始化结果为失败,错误信息为空
+    CHAOS_OPERATION_RESULT result = {0, "", ""};
+    if (count < 0 || (count > 0 && inputs == nullptr)) {
+        result.errorMsg = "Invalid batch input.";
+        return result;
+    }
+    int baseFormat = format & ~CHAOS_STR_WARM_ONCE;
+    if (baseFormat < CHAOS_STR_HEX || baseFormat > CHAOS_STR_BASE64 ||
+        (!decrypt && format != baseFormat && baseFormat == CHAOS_STR_HEX)) {
+        result.errorMsg = "Unsupported output format.";
+        return result;
+    }
+    if (THREAD_NUM < 1) {
+        result.errorMsg = "Thread count must be at least 1.";
+        return result;
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::string> outputs(count);
+    batch.status.assign(count, 0);
+    int chunks = (count + STR_BATCH_CHUNK - 1) / STR_BATCH_CHUNK;
+    ThreadPool::shared().parallelFor(chunks, THREAD_NUM, [&](int chunk) {
+        int end = std::min(count, (chunk + 1) * STR_BATCH_CHUNK);
+        for (int i = chunk * STR_BATCH_CHUNK; i < end; i++) {
+            CHAOS_OPERATION_RESULT one = decrypt ? decryptStrWithSchedule(schedule, inputs[i], format)
+                                                 : encryptStrWithSchedule(schedule, inputs[i], format);
+            if (one.success) {
+                outputs[i] = std::move(one.result);
+                batch.status[i] = 1;
+            }
+        }
+    });
+
+    uint64_t inputLength = 0;
+    int failed = 0;
+    batch.offsets.resize((size_t) count + 1);
+    batch.offsets[0] = 0;
+    for (int i = 0; i < count; i++) {
+        inputLength += inputs[i].length();
+        failed += batch.status[i] ? 0 : 1;
+        batch.offsets[i + 1] = batch.offsets[i] + outputs[i].length();
+    }
+    batch.arena.resize(batch.offsets[count]);
+    ThreadPool::shared().parallelFor(chunks, THREAD_NUM, [&](int chunk) {
+        int end = std::min(count, (chunk + 1) * STR_BATCH_CHUNK);
+        for (int i = chunk * STR_BATCH_CHUNK; i < end; i++) {
+            memcpy(&batch.arena[batch.offsets[i]], outputs[i].data(), outputs[i].length());
+            std::string().swap(outputs[i]);
+        }
+    });
+
+    auto end = std::chrono::steady_clock::now();
+    auto durationMill = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    result.mill = durationMill.count();
+    result.size = inputLength;
+    result.speed = durationMill.count() > 0
+                   ? static_cast<float>(inputLength) * 8 / 1024 / 1024 / 1024 / static_cast<float>(durationMill.count()) * 1000
+                   : 0;
+    result.result = std::to_string(failed);
+    result.success = 1;
+    return result;
+}
+
+CHAOS_OPERATION_RESULT
+encryptStrBatchWithSchedule_OMP(int THREAD_NUM, const CHAOS_KEY_SCHEDULE &schedule, const std::string_view *inputs,
+                                int count, int format, CHAOS_STR_BATCH &batch) {
+    return cryptStrBatch_OMP(THREAD_NUM, schedule, inputs, count, format, batch, false);
+}
+
+CHAOS_OPERATION_RESULT
+decryptStrBatchWithSchedule_OMP(int THREAD_NUM, const CHAOS_KEY_SCHEDULE &schedule, const std::string_view *inputs,
+                                int count, int format, CHAOS_STR_BATCH &batch) {
+    return cryptStrBatch_OMP(THREAD_NUM, schedule, inputs, count, format, batch, true);
+}
+
+CHAOS_OPERATION_RESULT
+encryptStrBatch_OMP(int THREAD_NUM, std::string_view key, const std::string_view *inputs, int count, int format,
+                    CHAOS_STR_BATCH &batch) {
+    if (key.length() < 8 || key.length() > 256) {
+        CHAOS_OPERATION_RESULT result = {0, "", ""};
+        result.errorMsg = "Key must be between 8 and 256 characters.";
+        return result;
+    }
+    return cryptStrBatch_OMP(THREAD_NUM, getKeySchedule(key), inputs, count, format, batch, false);
+}
+
+CHAOS_OPERATION_RESULT
+decryptStrBatch_OMP(int THREAD_NUM, std::string_view key, const std::string_view *inputs, int count, int format,
+                    CHAOS_STR_BATCH &batch) {
+    if (key.length() < 8 || key.length() > 256) {
+        CHAOS_OPERATION_RESULT result = {0, "", ""};
+        result.errorMsg = "Key must be between 8 and 256 characters.";
+        return result;
+    }
+    return cryptStrBatch_OMP(THREAD_NUM, getKeySchedule(key), inputs, count, format, batch, true);
+}
+
+// 内存加密并行交叉点基准测试
+CHAOS_OPERATION_RESULT benchmarkParallelCrossover(int THREAD_NUM, uint64_t maxSize) {
+    CHAOS_OPERATION_RESULT result = {0, "", ""};
+    if (THREAD_NUM < 1) {
+        result.errorMsg = "Thread count must be at least 1.";
+        return result;
+    }
+    const uint64_t minSize = 256 * 1024;
+    if (maxSize < minSize) {
+        result.errorMsg = "Benchmark size must be at least 256 KiB.";
+        return result;
+    }
+    const std::string key = "benchmarkParallelCrossover";
+    std::vector<uint8_t> buffer(maxSize);
+    for (uint64_t i = 0; i < maxSize; i++) {
+        buffer[i] = (uint8_t) (i * 131 + 7);
+    }
+    // 每个长度至少重复 3 次且累计不少于 50ms，取平均速度
+    auto measure = [&](int threads, uint64_t len) {
+        int runs = 0;
+        double seconds = 0;
+        while (runs < 3 || seconds < 0.05) {
+            auto runStart = std::chrono::steady_clock::now();
+            encryptBufferWithKey_OMP(threads, key, buffer.data(), buffer.data(), len);
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+            runs++;
+        }
+        return static_cast<double>(len) * runs * 8 / 1024 / 1024 / 1024 / seconds;
+    };
+    std::string speeds = "";
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t len = minSize;; len = std::min(len * 2, maxSize)) {
+        double single = measure(1, len);
+        double multi = measure(THREAD_NUM, len);
+        if (!speeds.empty()) {
+            speeds += "|";
+        }
+        speeds += std::to_string(len) + ":" + std::to_string(single) + ":" + std::to_string(multi);
+        if (result.size == 0 && multi > single * 1.1) {
+            result.size = len;
+        }
+        result.speed = static_cast<float>(std::max((double) result.speed, multi));
+        if (len == maxSize) {
+            break;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    result.mill = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    result.result = speeds;
+    result.success = 1;
+    return result;
+}
@@ -0,0 +1,814 @@
+#include <atomic>
+#include <cstring>
+#include "chaos_simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CHAOS_SIMD_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define CHAOS_SIMD_ARM 1
+#include <arm_neon.h>
+#endif
+
+static const char hexDigits[] = "0123456789ABCDEF";
+
+// ================================================== 标量实现 ==================================================
+
+static void xorRow3_scalar(uint8_t *a, const uint8_t *k, const uint8_t *c, int n) {
+    for (int i = 0; i < n; ++i) {
+        a[i] ^= k[i] ^ c[i];
+    }
+}
+
+static void xorRow2_scalar(uint8_t *a, const uint8_t *k, int n) {
+    for (int i = 0; i < n; ++i) {
+        a[i] ^= k[i];
+    }
+}
+
+static void scanRow_scalar(uint8_t *a, const uint8_t *k, int n) {
+    uint8_t prev = 0;
+    for (int i = 0; i < n; ++i) {
+        prev = a[i] ^ k[i] ^ prev;
+        a[i] = prev;
+    }
+}
+
+static void diffRow_scalar(uint8_t *a, const uint8_t *k, int n) {
+    uint8_t prev = 0;
+    for (int i = 0; i < n; ++i) {
+        uint8_t v = a[i];
+        a[i] = v ^ k[i] ^ prev;
+        prev = v;
+    }
+}
+
+// 向量主循环之后的剩余字节，prev 为上一字节（scan 为新值，diff 为原值）
+static inline void scanTail(uint8_t *a, const uint8_t *k, int i, int n, uint8_t prev) {
+    for (; i < n; ++i) {
+        prev = a[i] ^ k[i] ^ prev;
+        a[i] = prev;
+    }
+}
+
+static inline void diffTail(uint8_t *a, const uint8_t *k, int i, int n, uint8_t prev) {
+    for (; i < n; ++i) {
+        uint8_t v = a[i];
+        a[i] = v ^ k[i] ^ prev;
+        prev = v;
+    }
+}
+
+#ifdef CHAOS_SIMD_X86
+// ================================================== SSE2 ==================================================
+
+__attribute__((target("sse2")))
+static void xorRow3_sse2(uint8_t *a, const uint8_t *k, const uint8_t *c, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (a + i));
+        v = _mm_xor_si128(v, _mm_loadu_si128((const __m128i *) (k + i)));
+        v = _mm_xor_si128(v, _mm_loadu_si128((const __m128i *) (c + i)));
+        _mm_storeu_si128((__m128i *) (a + i), v);
+    }
+    for (; i < n; ++i) {
+        a[i] ^= k[i] ^ c[i];
+    }
+}
+
+__attribute__((target("sse2")))
+static void xorRow2_sse2(uint8_t *a, const uint8_t *k, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (a + i));
+        v = _mm_xor_si128(v, _mm_loadu_si128((const __m128i *) (k + i)));
+        _mm_storeu_si128((__m128i *) (a + i), v);
+    }
+    for (; i < n; ++i) {
+        a[i] ^= k[i];
+    }
+}
+
+__attribute__((target("sse2")))
+static void scanRow_sse2(uint8_t *a, const uint8_t *k, int n) {
+    // carry 为上一段末字节的广播
+    __m128i carry = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (a + i));
+        v = _mm_xor_si128(v, _mm_loadu_si128((const __m128i *) (k + i)));
+        v = _mm_xor_si128(v, _mm_slli_si128(v, 1));
+        v = _mm_xor_si128(v, _mm_slli_si128(v, 2));
+        v = _mm_xor_si128(v, _mm_slli_si128(v, 4));
+        v = _mm_xor_si128(v, _mm_slli_si128(v, 8));
+        v = _mm_xor_si128(v, carry);
+        _mm_storeu_si128((__m128i *) (a + i), v);
+        __m128i t = _mm_unpackhi_epi8(v, v);
+        t = _mm_unpackhi_epi16(t, t);
+        carry = _mm_shuffle_epi32(t, 0xFF);
+    }
+    scanTail(a, k, i, n, i > 0 ? a[i - 1] : 0);
+}
+
+__attribute__((target("sse2")))
+static void diffRow_sse2(uint8_t *a, const uint8_t *k, int n) {
+    __m128i prev = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (a + i));
+        __m128i s = _mm_or_si128(_mm_slli_si128(v, 1), _mm_srli_si128(prev, 15));
+        s = _mm_xor_si128(s, _mm_loadu_si128((const __m128i *) (k + i)));
+        _mm_storeu_si128((__m128i *) (a + i), _mm_xor_si128(v, s));
+        prev = v;
+    }
+    diffTail(a, k, i, n, (uint8_t) (_mm_extract_epi16(prev, 7) >> 8));
+}
+
+// ================================================== AVX2 ==================================================
+
+__attribute__((target("avx2")))
+static void xorRow3_avx2(uint8_t *a, const uint8_t *k, const uint8_t *c, int n) {
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (a + i));
+        v = _mm256_xor_si256(v, _mm256_loadu_si256((const __m256i *) (k + i)));
+        v = _mm256_xor_si256(v, _mm256_loadu_si256((const __m256i *) (c + i)));
+        _mm256_storeu_si256((__m256i *) (a + i), v);
+    }
+    for (; i < n; ++i) {
+        a[i] ^= k[i] ^ c[i];
+    }
+}
+
+__attribute__((target("avx2")))
+static void xorRow2_avx2(uint8_t *a, const uint8_t *k, int n) {
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (a + i));
+        v = _mm256_xor_si256(v, _mm256_loadu_si256((const __m256i *) (k + i)));
+        _mm256_storeu_si256((__m256i *) (a + i), v);
+    }
+    for (; i < n; ++i) {
+        a[i] ^= k[i];
+    }
+}
+
+__attribute__((target("avx2")))
+static void scanRow_avx2(uint8_t *a, const uint8_t *k, int n) {
+    const __m256i last = _mm256_set1_epi8(15);
+    __m256i carry = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (a + i));
+        v = _mm256_xor_si256(v, _mm256_loadu_si256((const __m256i *) (k + i)));
+        // 两个 128 位通道内各自做前缀异或
+        v = _mm256_xor_si256(v, _mm256_slli_si256(v, 1));
+        v = _mm256_xor_si256(v, _mm256_slli_si256(v, 2));
+        v = _mm256_xor_si256(v, _mm256_slli_si256(v, 4));
+        v = _mm256_xor_si256(v, _mm256_slli_si256(v, 8));
+        // 低通道末字节并入高通道
+        __m256i c = _mm256_shuffle_epi8(v, last);
+        v = _mm256_xor_si256(v, _mm256_permute2x128_si256(c, c, 0x08));
+        v = _mm256_xor_si256(v, carry);
+        _mm256_storeu_si256((__m256i *) (a + i), v);
+        c = _mm256_shuffle_epi8(v, last);
+        carry = _mm256_permute2x128_si256(c, c, 0x11);
+    }
+    scanTail(a, k, i, n, i > 0 ? a[i - 1] : 0);
+}
+
+__attribute__((target("avx2")))
+static void diffRow_avx2(uint8_t *a, const uint8_t *k, int n) {
+    __m256i prev = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (a + i));
+        // s = [prev[31], v[0..30]]
+        __m256i s = _mm256_alignr_epi8(v, _mm256_permute2x128_si256(prev, v, 0x21), 15);
+        s = _mm256_xor_si256(s, _mm256_loadu_si256((const __m256i *) (k + i)));
+        _mm256_storeu_si256((__m256i *) (a + i), _mm256_xor_si256(v, s));
+        prev = v;
+    }
+    diffTail(a, k, i, n, (uint8_t) (_mm256_extract_epi16(prev, 15) >> 8));
+}
+
+// ================================================== AVX-512 ==================================================
+
+__attribute__((target("avx512f,avx512bw")))
+static void xorRow3_avx512(uint8_t *a, const uint8_t *k, const uint8_t *c, int n) {
+    int i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512i v = _mm512_loadu_si512((const void *) (a + i));
+        v = _mm512_xor_si512(v, _mm512_loadu_si512((const void *) (k + i)));
+        v = _mm512_xor_si512(v, _mm512_loadu_si512((const void *) (c + i)));
+        _mm512_storeu_si512((void *) (a + i), v);
+    }
+    xorRow3_avx2(a + i, k + i, c + i, n - i);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void xorRow2_avx512(uint8_t *a, const uint8_t *k, int n) {
+    int i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512i v = _mm512_loadu_si512((const void *) (a + i));
+        v = _mm512_xor_si512(v, _mm512_loadu_si512((const void *) (k + i)));
+        _mm512_storeu_si512((void *) (a + i), v);
+    }
+    xorRow2_avx2(a + i, k + i, n - i);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void scanRow_avx512(uint8_t *a, const uint8_t *k, int n) {
+    const __m512i last = _mm512_set1_epi8(15);
+    // 以 64 位为单位把 128 位通道整体上移一个 / 两个通道
+    const __m512i up1 = _mm512_set_epi64(5, 4, 3, 2, 1, 0, 0, 0);
+    const __m512i up2 = _mm512_set_epi64(3, 2, 1, 0, 0, 0, 0, 0);
+    const __m512i top = _mm512_set_epi64(7, 6, 7, 6, 7, 6, 7, 6);
+    __m512i carry = _mm512_setzero_si512();
+    int i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512i v = _mm512_loadu_si512((const void *) (a + i));
+        v = _mm512_xor_si512(v, _mm512_loadu_si512((const void *) (k + i)));
+        v = _mm512_xor_si512(v, _mm512_bslli_epi128(v, 1));
+        v = _mm512_xor_si512(v, _mm512_bslli_epi128(v, 2));
+        v = _mm512_xor_si512(v, _mm512_bslli_epi128(v, 4));
+        v = _mm512_xor_si512(v, _mm512_bslli_epi128(v, 8));
+        // 通道末字节在 4 个通道间再做一次前缀异或
+        __m512i c = _mm512_shuffle_epi8(v, last);
+        c = _mm512_maskz_permutexvar_epi64(0xFC, up1, c);
+        c = _mm512_xor_si512(c, _mm512_maskz_permutexvar_epi64(0xFC, up1, c));
+        c = _mm512_xor_si512(c, _mm512_maskz_permutexvar_epi64(0xF0, up2, c));
+        v = _mm512_xor_si512(v, c);
+        v = _mm512_xor_si512(v, carry);
+        _mm512_storeu_si512((void *) (a + i), v);
+        // 带全 1 掩码的 maskz 形式与不带掩码的结果相同，避免内联展开后 GCC 对未定义寄存器的告警
+        carry = _mm512_maskz_permutexvar_epi64(0xFF, top, _mm512_shuffle_epi8(v, last));
+    }
+    scanTail(a, k, i, n, i > 0 ? a[i - 1] : 0);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void diffRow_avx512(uint8_t *a, const uint8_t *k, int n) {
+    // [prev 的第 3 通道, v 的第 0~2 通道]
+    const __m512i shiftIdx = _mm512_set_epi64(13, 12, 11, 10, 9, 8, 7, 6);
+    __m512i prev = _mm512_setzero_si512();
+    int i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512i v = _mm512_loadu_si512((const void *) (a + i));
+        __m512i s = _mm512_alignr_epi8(v, _mm512_permutex2var_epi64(prev, shiftIdx, v), 15);
+        s = _mm512_xor_si512(s, _mm512_loadu_si512((const void *) (k + i)));
+        _mm512_storeu_si512((void *) (a + i), _mm512_xor_si512(v, s));
+        prev = v;
+    }
+    diffTail(a, k, i, n, (uint8_t) (_mm_extract_epi16(_mm512_maskz_extracti32x4_epi32(0xF, prev, 3), 7) >> 8));
+}
+
+#endif
+
+#ifdef CHAOS_SIMD_ARM
+// ================================================== NEON ==================================================
+
+static void xorRow3_neon(uint8_t *a, const uint8_t *k, const uint8_t *c, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t v = veorq_u8(vld1q_u8(a + i), vld1q_u8(k + i));
+        vst1q_u8(a + i, veorq_u8(v, vld1q_u8(c + i)));
+    }
+    for (; i < n; ++i) {
+        a[i] ^= k[i] ^ c[i];
+    }
+}
+
+static void xorRow2_neon(uint8_t *a, const uint8_t *k, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        vst1q_u8(a + i, veorq_u8(vld1q_u8(a + i), vld1q_u8(k + i)));
+    }
+    for (; i < n; ++i) {
+        a[i] ^= k[i];
+    }
+}
+
+static void scanRow_neon(uint8_t *a, const uint8_t *k, int n) {
+    const uint8x16_t zero = vdupq_n_u8(0);
+    uint8x16_t carry = zero;
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t v = veorq_u8(vld1q_u8(a + i), vld1q_u8(k + i));
+        v = veorq_u8(v, vextq_u8(zero, v, 15));
+        v = veorq_u8(v, vextq_u8(zero, v, 14));
+        v = veorq_u8(v, vextq_u8(zero, v, 12));
+        v = veorq_u8(v, vextq_u8(zero, v, 8));
+        v = veorq_u8(v, carry);
+        vst1q_u8(a + i, v);
+        carry = vdupq_lane_u8(vget_high_u8(v), 7);
+    }
+    scanTail(a, k, i, n, i > 0 ? a[i - 1] : 0);
+}
+
+static void diffRow_neon(uint8_t *a, const uint8_t *k, int n) {
+    uint8x16_t prev = vdupq_n_u8(0);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t v = vld1q_u8(a + i);
+        uint8x16_t s = veorq_u8(vextq_u8(prev, v, 15), vld1q_u8(k + i));
+        vst1q_u8(a + i, veorq_u8(v, s));
+        prev = v;
+    }
+    diffTail(a, k, i, n, vgetq_lane_u8(prev, 15));
+}
+
+#endif
+
+// ================================================== 分发 ==================================================
+
+static const CHAOS_DIFFUSE_KERNELS kernelTable[] = {
+        {xorRow3_scalar, xorRow2_scalar, scanRow_scalar, diffRow_scalar},
+#ifdef CHAOS_SIMD_X86
+        {xorRow3_sse2,   xorRow2_sse2,   scanRow_sse2,   diffRow_sse2},
+        {xorRow3_avx2,   xorRow2_avx2,   scanRow_avx2,   diffRow_avx2},
+        {xorRow3_avx512, xorRow2_avx512, scanRow_avx512, diffRow_avx512},
+#else
+        {xorRow3_scalar, xorRow2_scalar, scanRow_scalar, diffRow_scalar},
+        {xorRow3_scalar, xorRow2_scalar, scanRow_scalar, diffRow_scalar},
+        {xorRow3_scalar, xorRow2_scalar, scanRow_scalar, diffRow_scalar},
+#endif
+#ifdef CHAOS_SIMD_ARM
+        {xorRow3_neon,   xorRow2_neon,   scanRow_neon,   diffRow_neon},
+#else
+        {xorRow3_scalar, xorRow2_scalar, scanRow_scalar, diffRow_scalar},
+#endif
+};
+
+static bool levelSupported(int level) {
+    switch (level) {
+        case CHAOS_SIMD_SCALAR:
+            return true;
+#ifdef CHAOS_SIMD_X86
+        case CHAOS_SIMD_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case CHAOS_SIMD_AVX2:
+            return __builtin_cpu_supports("avx2");
+        case CHAOS_SIMD_AVX512:
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#endif
+#ifdef CHAOS_SIMD_ARM
+        case CHAOS_SIMD_NEON:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+static int detectLevel() {
+#ifdef CHAOS_NO_SIMD
+    return CHAOS_SIMD_SCALAR;
+#else
+#ifdef CHAOS_SIMD_X86
+    __builtin_cpu_init();
+#endif
+    const int order[] = {CHAOS_SIMD_AVX512, CHAOS_SIMD_AVX2, CHAOS_SIMD_NEON, CHAOS_SIMD_SSE2};
+    for (int level: order) {
+        if (levelSupported(level)) {
+            return level;
+        }
+    }
+    return CHAOS_SIMD_SCALAR;
+#endif
+}
+
+static std::atomic<int> &currentLevel() {
+    static std::atomic<int> level(detectLevel());
+    return level;
+}
+
+int getSimdLevel() {
+    return currentLevel().load(std::memory_order_relaxed);
+}
+
+bool isSimdLevelSupported(int level) {
+    return level >= CHAOS_SIMD_SCALAR && level <= CHAOS_SIMD_NEON && levelSupported(level);
+}
+
+bool setSimdLevel(int level) {
+    if (!isSimdLevelSupported(level)) {
+        return false;
+    }
+    currentLevel().store(level, std::memory_order_relaxed);
+    return true;
+}
+
+const CHAOS_DIFFUSE_KERNELS &getDiffuseKernels() {
+    return kernelTable[getSimdLevel()];
+}
+
+const CHAOS_DIFFUSE_KERNELS &getDiffuseKernels(int level) {
+    return kernelTable[level];
+}
+
+// ================================================== 十六进制编解码 ==================================================
+
+static void hexEncode_scalar(const uint8_t *in, size_t len, char *out) {
+    for (size_t i = 0; i < len; ++i) {
+        out[2 * i] = hexDigits[in[i] >> 4];
+        out[2 * i + 1] = hexDigits[in[i] & 15];
+    }
+}
+
+// 字符到数值的表，非十六进制字符为 0xFF
+struct HEX_DECODE_TABLE {
+    uint8_t value[256];
+
+    HEX_DECODE_TABLE() {
+        for (int c = 0; c < 256; ++c) {
+            value[c] = 0xFF;
+        }
+        for (int v = 0; v < 16; ++v) {
+            value[(uint8_t) hexDigits[v]] = (uint8_t) v;
+            value[(uint8_t) "0123456789abcdef"[v]] = (uint8_t) v;
+        }
+    }
+};
+
+static bool hexDecode_scalar(const char *in, size_t len, uint8_t *out) {
+    static const HEX_DECODE_TABLE table;
+    // 非法字符的 0xFF 高位会被累积进 bad，循环中不分支
+    uint8_t bad = 0;
+    for (size_t i = 0; i < len / 2; ++i) {
+        uint8_t hi = table.value[(uint8_t) in[2 * i]];
+        uint8_t lo = table.value[(uint8_t) in[2 * i + 1]];
+        bad |= hi | lo;
+        out[i] = (uint8_t) (hi << 4 | lo);
+    }
+    return (bad & 0xF0) == 0;
+}
+
+#ifdef CHAOS_SIMD_X86
+
+__attribute__((target("ssse3")))
+static void hexEncode_ssse3(const uint8_t *in, size_t len, char *out) {
+    const __m128i lut = _mm_loadu_si128((const __m128i *) hexDigits);
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (in + i));
+        __m128i hi = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(v, 4), mask));
+        __m128i lo = _mm_shuffle_epi8(lut, _mm_and_si128(v, mask));
+        _mm_storeu_si128((__m128i *) (out + 2 * i), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i *) (out + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+    hexEncode_scalar(in + i, len - i, out + 2 * i);
+}
+
+// 16 个字符转为 0~15 的数值，valid 中非十六进制字符对应的字节为 0
+__attribute__((target("ssse3")))
+static inline __m128i hexValues_ssse3(__m128i c, __m128i &valid) {
+    __m128i digit = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    __m128i letter = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+    __m128i isLetter = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)), letter);
+    valid = _mm_or_si128(isDigit, isLetter);
+    return _mm_or_si128(_mm_and_si128(isDigit, digit),
+                        _mm_and_si128(isLetter, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+}
+
+__attribute__((target("ssse3")))
+static bool hexDecode_ssse3(const char *in, size_t len, uint8_t *out) {
+    // 每对 (高位, 低位) 乘以 (16, 1) 后相加
+    const __m128i weights = _mm_set1_epi16(0x0110);
+    __m128i allValid = _mm_set1_epi8(-1);
+    size_t n = len / 2;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i valid0, valid1;
+        __m128i v0 = hexValues_ssse3(_mm_loadu_si128((const __m128i *) (in + 2 * i)), valid0);
+        __m128i v1 = hexValues_ssse3(_mm_loadu_si128((const __m128i *) (in + 2 * i + 16)), valid1);
+        allValid = _mm_and_si128(allValid, _mm_and_si128(valid0, valid1));
+        __m128i b0 = _mm_maddubs_epi16(v0, weights);
+        __m128i b1 = _mm_maddubs_epi16(v1, weights);
+        _mm_storeu_si128((__m128i *) (out + i), _mm_packus_epi16(b0, b1));
+    }
+    if (_mm_movemask_epi8(allValid) != 0xFFFF) {
+        return false;
+    }
+    return hexDecode_scalar(in + 2 * i, len - 2 * i, out + i);
+}
+
+#endif
+
+#if defined(CHAOS_SIMD_ARM) && defined(__aarch64__)
+#define CHAOS_HEX_NEON 1
+
+static void hexEncode_neon(const uint8_t *in, size_t len, char *out) {
+    const uint8x16_t lut = vld1q_u8((const uint8_t *) hexDigits);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t v = vld1q_u8(in + i);
+        uint8x16x2_t chars;
+        chars.val[0] = vqtbl1q_u8(lut, vshrq_n_u8(v, 4));
+        chars.val[1] = vqtbl1q_u8(lut, vandq_u8(v, vdupq_n_u8(0x0F)));
+        vst2q_u8((uint8_t *) out + 2 * i, chars);
+    }
+    hexEncode_scalar(in + i, len - i, out + 2 * i);
+}
+
+static inline uint8x16_t hexValues_neon(uint8x16_t c, uint8x16_t &valid) {
+    uint8x16_t digit = vsubq_u8(c, vdupq_n_u8('0'));
+    uint8x16_t letter = vsubq_u8(vorrq_u8(c, vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+    uint8x16_t isDigit = vcltq_u8(digit, vdupq_n_u8(10));
+    uint8x16_t isLetter = vcltq_u8(letter, vdupq_n_u8(6));
+    valid = vorrq_u8(isDigit, isLetter);
+    return vorrq_u8(vandq_u8(isDigit, digit), vandq_u8(isLetter, vaddq_u8(letter, vdupq_n_u8(10))));
+}
+
+static bool hexDecode_neon(const char *in, size_t len, uint8_t *out) {
+    uint8x16_t allValid = vdupq_n_u8(0xFF);
+    size_t n = len / 2;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        // vld2q 把偶数位（高四位字符）与奇数位（低四位字符）分开
+        uint8x16x2_t chars = vld2q_u8((const uint8_t *) in + 2 * i);
+        uint8x16_t valid0, valid1;
+        uint8x16_t hi = hexValues_neon(chars.val[0], valid0);
+        uint8x16_t lo = hexValues_neon(chars.val[1], valid1);
+        allValid = vandq_u8(allValid, vandq_u8(valid0, valid1));
+        vst1q_u8(out + i, vorrq_u8(vshlq_n_u8(hi, 4), lo));
+    }
+    if (vminvq_u8(allValid) != 0xFF) {
+        return false;
+    }
+    return hexDecode_scalar(in + 2 * i, len - 2 * i, out + i);
+}
+
+#endif
+
+#ifdef CHAOS_SIMD_X86
+
+// 扩散核级别只保证 SSE2，SSSE3 单独检测
+static bool hexSsse3Supported() {
+    static const bool supported = __builtin_cpu_supports("ssse3");
+    return supported;
+}
+
+#endif
+
+// ================================================== Base64 ==================================================
+
+static const char base64Digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static void base64Encode_scalar(const uint8_t *in, size_t len, char *out) {
+    size_t i = 0;
+    for (; i + 3 <= len; i += 3, out += 4) {
+        uint32_t v = (uint32_t) in[i] << 16 | (uint32_t) in[i + 1] << 8 | in[i + 2];
+        out[0] = base64Digits[v >> 18];
+        out[1] = base64Digits[(v >> 12) & 63];
+        out[2] = base64Digits[(v >> 6) & 63];
+        out[3] = base64Digits[v & 63];
+    }
+    if (i < len) {
+        uint32_t v = (uint32_t) in[i] << 16 | (i + 1 < len ? (uint32_t) in[i + 1] << 8 : 0);
+        out[0] = base64Digits[v >> 18];
+        out[1] = base64Digits[(v >> 12) & 63];
+        out[2] = i + 1 < len ? base64Digits[(v >> 6) & 63] : '=';
+        out[3] = '=';
+    }
+}
+
+// 字符到 6 位数值的表，非 Base64 字符为 0xFF
+struct BASE64_DECODE_TABLE {
+    uint8_t value[256];
+
+    BASE64_DECODE_TABLE() {
+        for (int c = 0; c < 256; ++c) {
+            value[c] = 0xFF;
+        }
+        for (int v = 0; v < 64; ++v) {
+            value[(uint8_t) base64Digits[v]] = (uint8_t) v;
+        }
+    }
+};
+
+// 解码不含填充的完整 4 字符组，返回 false 表示出现非法字符
+static bool base64DecodeQuads_scalar(const char *in, size_t quads, uint8_t *out) {
+    static const BASE64_DECODE_TABLE table;
+    uint8_t bad = 0;
+    for (size_t q = 0; q < quads; ++q, in += 4, out += 3) {
+        uint8_t a = table.value[(uint8_t) in[0]];
+        uint8_t b = table.value[(uint8_t) in[1]];
+        uint8_t c = table.value[(uint8_t) in[2]];
+        uint8_t d = table.value[(uint8_t) in[3]];
+        bad |= a | b | c | d;
+        uint32_t v = (uint32_t) a << 18 | (uint32_t) b << 12 | (uint32_t) c << 6 | d;
+        out[0] = (uint8_t) (v >> 16);
+        out[1] = (uint8_t) (v >> 8);
+        out[2] = (uint8_t) v;
+    }
+    return (bad & 0xC0) == 0;
+}
+
+// 末尾的一组，可能带一个或两个 '='
+static bool base64DecodeLast(const char *in, uint8_t *out, size_t &outLen) {
+    int pad = in[3] == '=' ? (in[2] == '=' ? 2 : 1) : 0;
+    char quad[4] = {in[0], in[1], pad == 2 ? 'A' : in[2], pad > 0 ? 'A' : in[3]};
+    uint8_t bytes[3];
+    if (!base64DecodeQuads_scalar(quad, 1, bytes)) {
+        return false;
+    }
+    // 填充位必须为 0，保证编码唯一
+    if ((pad == 2 && bytes[1] != 0) || (pad == 1 && bytes[2] != 0)) {
+        return false;
+    }
+    memcpy(out, bytes, 3 - pad);
+    outLen = 3 - pad;
+    return true;
+}
+
+#ifdef CHAOS_SIMD_X86
+
+// 每次读取 16 字节、编码其中 12 字节为 16 个字符
+__attribute__((target("ssse3")))
+static size_t base64Encode_ssse3(const uint8_t *in, size_t len, char *out) {
+    const __m128i shuffle = _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    // 6 位索引的分段偏移：<26 为 'A'，<52 为 'a' - 26，其后为数字、'+'、'/'
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                          '/' - 63, 'A', 0, 0);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 12, out += 16) {
+        __m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (in + i)), shuffle);
+        // 每个 32 位通道内拆出 4 个 6 位索引
+        __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(v, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+        __m128i t1 = _mm_mullo_epi16(_mm_and_si128(v, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+        __m128i indices = _mm_or_si128(t0, t1);
+        __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+        __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+        range = _mm_or_si128(range, _mm_and_si128(less, _mm_set1_epi8(13)));
+        _mm_storeu_si128((__m128i *) out, _mm_add_epi8(indices, _mm_shuffle_epi8(offsets, range)));
+    }
+    return i;
+}
+
+// 16 个字符解码为 12 字节，写出 16 字节，调用方保证其后还有至少 4 字节的输出空间
+__attribute__((target("ssse3")))
+static size_t base64DecodeQuads_ssse3(const char *in, size_t quads, uint8_t *out, bool &valid) {
+    const __m128i lutLo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lutHi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask2F = _mm_set1_epi8(0x2F);
+    const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    __m128i bad = _mm_setzero_si128();
+    size_t q = 0;
+    for (; q + 6 <= quads; q += 4, in += 16, out += 12) {
+        __m128i c = _mm_loadu_si128((const __m128i *) in);
+        // 按高低半字节查表，两者按位与不为 0 的是非法字符
+        __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(c, 4), mask2F);
+        __m128i hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+        __m128i lo = _mm_shuffle_epi8(lutLo, _mm_and_si128(c, mask2F));
+        bad = _mm_or_si128(bad, _mm_and_si128(lo, hi));
+        __m128i roll = _mm_shuffle_epi8(lutRoll, _mm_add_epi8(_mm_cmpeq_epi8(c, mask2F), hiNibbles));
+        __m128i values = _mm_add_epi8(c, roll);
+        // 4 个 6 位值合并为 24 位
+        __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+        merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        _mm_storeu_si128((__m128i *) out, _mm_shuffle_epi8(merged, pack));
+    }
+    valid = _mm_movemask_epi8(_mm_cmpeq_epi8(bad, _mm_setzero_si128())) == 0xFFFF;
+    return q;
+}
+
+#endif
+
+#ifdef CHAOS_HEX_NEON
+
+// vld3q 把 48 字节按 3 字节一组拆到三个寄存器，编码为 64 个字符后由 vst4q 交错写出
+static size_t base64Encode_neon(const uint8_t *in, size_t len, char *out) {
+    const uint8x16x4_t lut = vld1q_u8_x4((const uint8_t *) base64Digits);
+    const uint8x16_t mask = vdupq_n_u8(63);
+    size_t i = 0;
+    for (; i + 48 <= len; i += 48, out += 64) {
+        uint8x16x3_t v = vld3q_u8(in + i);
+        uint8x16x4_t chars;
+        chars.val[0] = vqtbl4q_u8(lut, vshrq_n_u8(v.val[0], 2));
+        chars.val[1] = vqtbl4q_u8(lut, vandq_u8(vorrq_u8(vshlq_n_u8(v.val[0], 4), vshrq_n_u8(v.val[1], 4)), mask));
+        chars.val[2] = vqtbl4q_u8(lut, vandq_u8(vorrq_u8(vshlq_n_u8(v.val[1], 2), vshrq_n_u8(v.val[2], 6)), mask));
+        chars.val[3] = vqtbl4q_u8(lut, vandq_u8(v.val[2], mask));
+        vst4q_u8((uint8_t *) out, chars);
+    }
+    return i;
+}
+
+static size_t base64DecodeQuads_neon(const char *in, size_t quads, uint8_t *out, bool &valid) {
+    static const BASE64_DECODE_TABLE table;
+    // 字符 0~127 的数值表，超出范围的字符查表得 0 后由最高位检查排除
+    const uint8x16x4_t lut0 = vld1q_u8_x4(table.value);
+    const uint8x16x4_t lut1 = vld1q_u8_x4(table.value + 64);
+    uint8x16_t bad = vdupq_n_u8(0);
+    size_t q = 0;
+    for (; q + 16 <= quads; q += 16, in += 64, out += 48) {
+        uint8x16x4_t c = vld4q_u8((const uint8_t *) in);
+        uint8x16_t v[4];
+        for (int k = 0; k < 4; ++k) {
+            uint8x16_t lo = vqtbl4q_u8(lut0, c.val[k]);
+            v[k] = vqtbx4q_u8(lo, lut1, vsubq_u8(c.val[k], vdupq_n_u8(64)));
+            bad = vorrq_u8(bad, vorrq_u8(v[k], vandq_u8(c.val[k], vdupq_n_u8(0x80))));
+        }
+        uint8x16x3_t bytes;
+        bytes.val[0] = vorrq_u8(vshlq_n_u8(v[0], 2), vshrq_n_u8(v[1], 4));
+        bytes.val[1] = vorrq_u8(vshlq_n_u8(v[1], 4), vshrq_n_u8(v[2], 2));
+        bytes.val[2] = vorrq_u8(vshlq_n_u8(v[2], 6), v[3]);
+        vst3q_u8(out, bytes);
+    }
+    valid = (vmaxvq_u8(bad) & 0xC0) == 0;
+    return q;
+}
+
+#endif
+
+void base64Encode(const uint8_t *in, size_t len, char *out) {
+    int level = getSimdLevel();
+    size_t done = 0;
+#ifdef CHAOS_SIMD_X86
+    if (level != CHAOS_SIMD_SCALAR && hexSsse3Supported()) {
+        done = base64Encode_ssse3(in, len, out);
+    }
+#endif
+#ifdef CHAOS_HEX_NEON
+    if (level == CHAOS_SIMD_NEON) {
+        done = base64Encode_neon(in, len, out);
+    }
+#endif
+    (void) level;
+    base64Encode_scalar(in + done, len - done, out + done / 3 * 4);
+}
+
+bool base64Decode(const char *in, size_t len, uint8_t *out, size_t &outLen) {
+    outLen = 0;
+    if (len % 4 != 0) {
+        return false;
+    }
+    if (len == 0) {
+        return true;
+    }
+    // 最后一组单独处理填充，之前的都是完整的 4 字符组
+    size_t quads = len / 4 - 1;
+    size_t done = 0;
+    bool valid = true;
+    int level = getSimdLevel();
+#ifdef CHAOS_SIMD_X86
+    if (level != CHAOS_SIMD_SCALAR && hexSsse3Supported()) {
+        done = base64DecodeQuads_ssse3(in, quads, out, valid);
+    }
+#endif
+#ifdef CHAOS_HEX_NEON
+    if (level == CHAOS_SIMD_NEON) {
+        done = base64DecodeQuads_neon(in, quads, out, valid);
+    }
+#endif
+    (void) level;
+    if (!valid || !base64DecodeQuads_scalar(in + 4 * done, quads - done, out + 3 * done)) {
+        return false;
+    }
+    size_t last;
+    if (!base64DecodeLast(in + 4 * quads, out + 3 * quads, last)) {
+        return false;
+    }
+    outLen = 3 * quads + last;
+    return true;
+}
+
+void hexEncode(const uint8_t *in, size_t len, char *out) {
+    int level = getSimdLevel();
+#ifdef CHAOS_SIMD_X86
+    if (level != CHAOS_SIMD_SCALAR && hexSsse3Supported()) {
+        hexEncode_ssse3(in, len, out);
+        return;
+    }
+#endif
+#ifdef CHAOS_HEX_NEON
+    if (level == CHAOS_SIMD_NEON) {
+        hexEncode_neon(in, len, out);
+        return;
+    }
+#endif
+    (void) level;
+    hexEncode_scalar(in, len, out);
+}
+
+bool hexDecode(const char *in, size_t len, uint8_t *out) {
+    int level = getSimdLevel();
+#ifdef CHAOS_SIMD_X86
+    if (level != CHAOS_SIMD_SCALAR && hexSsse3Supported()) {
+        return hexDecode_ssse3(in, len, out);
+    }
+#endif
+#ifdef CHAOS_HEX_NEON
+    if (level == CHAOS_SIMD_NEON) {
+        return hexDecode_neon(in, len, out);
+    }
+#endif
+    (void) level;
+    return hexDecode_scalar(in, len, out);
+}
@@ -0,0 +1,93 @@
+#ifndef __CHAOS_SIMD_H__
+#define __CHAOS_SIMD_H__
+
+#include <cstddef>
+#include <cstdint>
+
+// 扩散核的实现级别
+enum CHAOS_SIMD_LEVEL {
+    CHAOS_SIMD_SCALAR = 0,
+    CHAOS_SIMD_SSE2 = 1,
+    CHAOS_SIMD_AVX2 = 2,
+    CHAOS_SIMD_AVX512 = 3,
+    CHAOS_SIMD_NEON = 4,
+};
+
+// 扩散核函数表
+// 列间扩散在第 i 列只依赖第 i-1 列，因此按行展开后，每一行都是一次沿行方向的连续处理：
+// 加密为前缀异或（scanRow），解密为相邻差分（diffRow），两者都可以按 16/32/64 字节向量化
+struct CHAOS_DIFFUSE_KERNELS {
+    // 行间扩散：a[i] ^= k[i] ^ c[i]
+    void (*xorRow3)(uint8_t *a, const uint8_t *k, const uint8_t *c, int n);
+
+    // 首行扩散：a[i] ^= k[i]
+    void (*xorRow2)(uint8_t *a, const uint8_t *k, int n);
+
+    // 加密列扩散（按行）：a[i] = a[i] ^ k[i] ^ a[i-1]，a[i-1] 为已更新的值，a[-1] 视为 0
+    void (*scanRow)(uint8_t *a, const uint8_t *k, int n);
+
+    // 解密列扩散（按行）：a[i] = a[i] ^ k[i] ^ a[i-1]，a[i-1] 为原值，a[-1] 视为 0
+    void (*diffRow)(uint8_t *a, const uint8_t *k, int n);
+};
+
+/**
+ * 当前使用的扩散核级别，首次调用时按 CPU 能力自动选择
+ * @return CHAOS_SIMD_LEVEL
+ */
+int getSimdLevel();
+
+/**
+ * 强制指定扩散核级别，用于对比测试与基准测试
+ * @param level CHAOS_SIMD_LEVEL
+ * @return CPU 不支持该级别时返回 false，级别不变
+ */
+bool setSimdLevel(int level);
+
+// CPU 是否支持该扩散核级别
+bool isSimdLevelSupported(int level);
+
+/**
+ * 当前级别对应的扩散核，CHAOS_SIMD_SCALAR 级别同样返回可用的标量实现
+ */
+const CHAOS_DIFFUSE_KERNELS &getDiffuseKernels();
+
+/**
+ * 指定级别的扩散核，不改变当前级别
+ * @param level 必须是 isSimdLevelSupported 返回 true 的级别
+ */
+const CHAOS_DIFFUSE_KERNELS &getDiffuseKernels(int level);
+
+/**
+ * 二进制转大写十六进制，直接写入调用方预先分配的 out（2 * len 字节，不追加结尾 0）
+ * x86 支持 SSSE3、ARM64 使用 NEON 时按 16 字节向量化，CHAOS_SIMD_SCALAR 级别使用查表实现
+ * 允许 in == out + len，即数据放在输出的后半部分原地展开
+ */
+void hexEncode(const uint8_t *in, size_t len, char *out);
+
+/**
+ * 十六进制（大小写均可）转二进制，out 为 len / 2 字节，len 为奇数时忽略最后一个字符
+ * @return 出现非十六进制字符时返回 false，out 内容不确定
+ */
+bool hexDecode(const char *in, size_t len, uint8_t *out);
+
+// Base64 编码后的长度（标准字母表，带 '=' 填充）
+inline size_t base64EncodedLength(size_t len) {
+    return (len + 2) / 3 * 4;
+}
+
+/**
+ * 二进制转 Base64，写入调用方预先分配的 out（base64EncodedLength(len) 字节，不追加结尾 0）
+ * 向量化条件与 hexEncode 相同，每次处理 12（SSSE3）或 48（NEON）字节
+ * 允许原地展开：in 位于同一缓冲区内且 in >= out + len / 3 + 64
+ */
+void base64Encode(const uint8_t *in, size_t len, char *out);
+
+/**
+ * Base64 转二进制，len 必须是 4 的倍数，只允许末尾出现 '=' 填充
+ * @param out 至少 len / 4 * 3 字节
+ * @param outLen 解码后的字节数
+ * @return 长度或字符不合法时返回 false
+ */
+bool base64Decode(const char *in, size_t len, uint8_t *out, size_t &outLen);
+
+#endif
@@ -5,6 +5,7 @@
 //
 
 #include "crc32.h"
+#include <atomic>
 
 //// big endian architectures need #define __BYTE_ORDER __BIG_ENDIAN
 //#ifndef _MSC_VER
@@ -335,11 +336,10 @@ namespace
 }
 
 
-/// add arbitrary number of bytes
-void CRC32::add(const void* data, size_t numBytes)
+/// slicing-by-8 on the inverted state, portable fallback
+static uint32_t crc32Slicing8(uint32_t crc, const void* data, size_t numBytes)
 {
   uint32_t* current = (uint32_t*) data;
-  uint32_t crc = ~m_hash;
 
   // process eight bytes at once
   while (numBytes >= 8)
@@ -375,7 +375,282 @@ void CRC32::add(const void* data, size_t numBytes)
   while (numBytes--)
     crc = (crc >> 8) ^ crc32Lookup[0][(crc & 0xFF) ^ *currentChar++];
 
-  m_hash = ~crc;
+  return crc;
+}
+
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(CHAOS_NO_SIMD)
+#define CRC32_X86 1
+#include <immintrin.h>
+
+/// carry-less multiplication folding (Intel "Fast CRC Computation Using PCLMULQDQ"),
+/// numBytes must be a multiple of 16 and at least 64
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t crc32Pclmul(uint32_t crc, const unsigned char* buffer, size_t numBytes)
+{
+  // x^(4*128+32) mod P, x^(4*128-32) mod P, x^(128+32) mod P, x^(128-32) mod P, x^64 mod P, reflected
+  alignas(16) static const uint64_t k1k2[] = { 0x0154442bd4, 0x01c6e41596 };
+  alignas(16) static const uint64_t k3k4[] = { 0x01751997d0, 0x00ccaa009e };
+  alignas(16) static const uint64_t k5k0[] = { 0x0163cd6124, 0x0000000000 };
+  // P(x) and its Barrett constant mu, reflected
+  alignas(16) static const uint64_t poly[] = { 0x01db710641, 0x01f7011641 };
+
+  __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+  x1 = _mm_loadu_si128((const __m128i*)(buffer + 0x00));
+  x2 = _mm_loadu_si128((const __m128i*)(buffer + 0x10));
+  x3 = _mm_loadu_si128((const __m128i*)(buffer + 0x20));
+  x4 = _mm_loadu_si128((const __m128i*)(buffer + 0x30));
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int) crc));
+  x0 = _mm_load_si128((const __m128i*) k1k2);
+  buffer   += 64;
+  numBytes -= 64;
+
+  // fold 4 x 128 bits in parallel
+  while (numBytes >= 64)
+  {
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+    x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+    y5 = _mm_loadu_si128((const __m128i*)(buffer + 0x00));
+    y6 = _mm_loadu_si128((const __m128i*)(buffer + 0x10));
+    y7 = _mm_loadu_si128((const __m128i*)(buffer + 0x20));
+    y8 = _mm_loadu_si128((const __m128i*)(buffer + 0x30));
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+    buffer   += 64;
+    numBytes -= 64;
+  }
+
+  // fold into 128 bits
+  x0 = _mm_load_si128((const __m128i*) k3k4);
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+  // remaining 16 byte blocks
+  while (numBytes >= 16)
+  {
+    x2 = _mm_loadu_si128((const __m128i*) buffer);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    buffer   += 16;
+    numBytes -= 16;
+  }
+
+  // fold 128 bits to 64 bits
+  x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+  x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+  x1 = _mm_srli_si128(x1, 8);
+  x1 = _mm_xor_si128(x1, x2);
+  x0 = _mm_loadl_epi64((const __m128i*) k5k0);
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, x3);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  // Barrett reduction to 32 bits
+  x0 = _mm_load_si128((const __m128i*) poly);
+  x2 = _mm_and_si128(x1, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+  x2 = _mm_and_si128(x2, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+  return (uint32_t) _mm_extract_epi32(x1, 1);
+}
+
+static uint32_t crc32Hardware(uint32_t crc, const void* data, size_t numBytes)
+{
+  const unsigned char* buffer = (const unsigned char*) data;
+  if (numBytes >= 64)
+  {
+    size_t chunk = numBytes & ~(size_t) 15;
+    crc = crc32Pclmul(crc, buffer, chunk);
+    buffer   += chunk;
+    numBytes -= chunk;
+  }
+  return crc32Slicing8(crc, buffer, numBytes);
+}
+
+static bool crc32HardwareSupported()
+{
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+}
+
+#elif defined(__aarch64__) && !defined(CHAOS_NO_SIMD)
+#define CRC32_ARM 1
+#include <arm_acle.h>
+#include <cstring>
+#if defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+// the crc32 instructions are optional in ARMv8.0, enable them for this function only
+#if defined(__clang__)
+#define CRC32_ARM_TARGET __attribute__((target("crc")))
+#else
+#define CRC32_ARM_TARGET __attribute__((target("+crc")))
+#endif
+
+/// ARMv8 crc32b/crc32d use the same reflected polynomial 0xEDB88320
+CRC32_ARM_TARGET
+static uint32_t crc32Hardware(uint32_t crc, const void* data, size_t numBytes)
+{
+  const unsigned char* buffer = (const unsigned char*) data;
+  // four independent 8 byte lanes would need a combine step, a single chain already runs near 1 byte/cycle
+  while (numBytes >= 8)
+  {
+    uint64_t value;
+    memcpy(&value, buffer, 8);
+    crc = __crc32d(crc, value);
+    buffer   += 8;
+    numBytes -= 8;
+  }
+  while (numBytes--)
+    crc = __crc32b(crc, *buffer++);
+  return crc;
+}
+
+static bool crc32HardwareSupported()
+{
+#if defined(__APPLE__)
+  return true;
+#elif defined(__linux__) && defined(HWCAP_CRC32)
+  return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#else
+  return false;
+#endif
+}
+
+#endif
+
+
+namespace
+{
+  typedef uint32_t (*Crc32Function)(uint32_t crc, const void* data, size_t numBytes);
+
+  /// cleared by CRC32::setHardwareEnabled(false)
+  std::atomic<bool> hardwareEnabled(true);
+
+  /// CPU check runs once
+  bool hardwareAvailable()
+  {
+#if defined(CRC32_X86) || defined(CRC32_ARM)
+    static const bool available = crc32HardwareSupported();
+    return available;
+#else
+    return false;
+#endif
+  }
+
+  /// PCLMULQDQ on x86, crc32 instructions on arm64, slicing-by-8 otherwise
+  Crc32Function crc32Implementation()
+  {
+#if defined(CRC32_X86) || defined(CRC32_ARM)
+    if (hardwareEnabled.load(std::memory_order_relaxed) && hardwareAvailable())
+      return crc32Hardware;
+#endif
+    return crc32Slicing8;
+  }
+}
+
+
+/// allow (default) or forbid the hardware path, returns true if add() uses it from now on
+bool CRC32::setHardwareEnabled(bool enable)
+{
+  hardwareEnabled = enable;
+  return enable && hardwareAvailable();
+}
+
+
+/// add arbitrary number of bytes
+void CRC32::add(const void* data, size_t numBytes)
+{
+  m_hash = ~crc32Implementation()(~m_hash, data, numBytes);
+}
+
+
+namespace
+{
+  const uint32_t Polynomial = 0xEDB88320;
+
+  /// a * b modulo P, both reflected
+  uint32_t multModP(uint32_t a, uint32_t b)
+  {
+    uint32_t m = 1u << 31;
+    uint32_t p = 0;
+    for (;;)
+    {
+      if (a & m)
+      {
+        p ^= b;
+        if ((a & (m - 1)) == 0)
+          break;
+      }
+      m >>= 1;
+      b = (b & 1) ? (b >> 1) ^ Polynomial : b >> 1;
+    }
+    return p;
+  }
+
+  /// x^(2^k) modulo P for k = 0..31
+  struct PowerTable
+  {
+    uint32_t x2n[32];
+    PowerTable()
+    {
+      uint32_t p = 1u << 30; // x^1
+      x2n[0] = p;
+      for (int k = 1; k < 32; k++)
+        x2n[k] = p = multModP(p, p);
+    }
+  };
+
+  /// x^(n * 2^k) modulo P
+  uint32_t x2nModP(uint64_t n, unsigned k)
+  {
+    static const PowerTable table;
+    uint32_t p = 1u << 31; // x^0
+    while (n)
+    {
+      if (n & 1)
+        p = multModP(table.x2n[k & 31], p);
+      n >>= 1;
+      k++;
+    }
+    return p;
+  }
+}
+
+
+/// CRC32 of A followed by B, computed from crc(A), crc(B) and the length of B (same result as zlib's crc32_combine)
+uint32_t CRC32::combine(uint32_t crcA, uint32_t crcB, uint64_t lengthB)
+{
+  // shifting A by lengthB bytes means multiplying with x^(8 * lengthB)
+  return multModP(x2nModP(lengthB, 3), crcA) ^ crcB;
+}
+
+
+/// append the hash of data that directly follows the bytes hashed so far
+void CRC32::addHash(const CRC32& next, uint64_t numBytes)
+{
+  m_hash = combine(m_hash, next.m_hash, numBytes);
 }
 
 
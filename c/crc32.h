@@ -34,9 +34,9 @@ typedef unsigned __int32 uint32_t;
     std::string myHash3 = crc32.getHash();
 
     Note:
-    You can find code for the faster Slicing-by-16 algorithm on my website, too:
-    http://create.stephan-brumme.com/crc32/
-    Its unrolled version is about twice as fast but its look-up table doubled in size as well.
+    add() switches at runtime to PCLMULQDQ folding on x86 and to the crc32 instructions on arm64
+    when the CPU has them, and falls back to slicing-by-8 otherwise; all paths give the same hash.
+    Chunks hashed independently (e.g. by several threads) can be merged with addHash() / combine().
   */
 class CRC32 //: public Hash
 {
@@ -63,6 +63,16 @@ public:
   /// restart
   void reset();
 
+  /// append the hash of data that directly follows the bytes hashed so far, e.g. a chunk hashed by another thread
+  void addHash(const CRC32& next, uint64_t numBytes);
+
+  /// CRC32 of A followed by B, computed from crc(A), crc(B) and the length of B
+  static uint32_t combine(uint32_t crcA, uint32_t crcB, uint64_t lengthB);
+
+  /// allow (default) or forbid the hardware path, e.g. to test slicing-by-8 on a CPU that has PCLMULQDQ;
+  /// returns true if add() uses the hardware path from now on
+  static bool setHardwareEnabled(bool enable);
+
 private:
   /// hash
   uint32_t m_hash;
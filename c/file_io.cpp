@@ -0,0 +1,563 @@
+#include <atomic>
+#include <cstring>
+#include <vector>
+#include "file_io.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <algorithm>
+#include <filesystem>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef CHAOS_HAS_IO_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+#if defined(__ANDROID__) && !defined(__LP64__)
+// 32 位 Android 的 off_t 只有 32 位，需要显式使用 64 位偏移的版本
+#define chaos_pread pread64
+#define chaos_pwrite pwrite64
+#define chaos_ftruncate ftruncate64
+#define chaos_fallocate posix_fallocate64
+#define chaos_fstat fstat64
+typedef struct stat64 chaos_stat_t;
+#else
+#define chaos_pread pread
+#define chaos_pwrite pwrite
+#define chaos_ftruncate ftruncate
+#define chaos_fallocate posix_fallocate
+#define chaos_fstat fstat
+typedef struct stat chaos_stat_t;
+#endif
+
+// 单次读写的上限，避免 32 位平台 size_t/ssize_t 溢出
+#define CHAOS_IO_CHUNK (1U << 30)
+
+#ifdef _WIN32
+
+ChaosFile::ChaosFile() : m_direct(false), m_handle(INVALID_HANDLE_VALUE) {
+}
+
+ChaosFile::~ChaosFile() {
+    close();
+}
+
+bool ChaosFile::openRead(const std::string &path) {
+    close();
+    m_handle = CreateFileW(std::filesystem::u8path(path).wstring().c_str(), GENERIC_READ,
+                           FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    return isOpen();
+}
+
+bool ChaosFile::openWrite(const std::string &path) {
+    close();
+    m_handle = CreateFileW(std::filesystem::u8path(path).wstring().c_str(), GENERIC_READ | GENERIC_WRITE,
+                           FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    return isOpen();
+}
+
+bool ChaosFile::openReadWrite(const std::string &path) {
+    close();
+    m_handle = CreateFileW(std::filesystem::u8path(path).wstring().c_str(), GENERIC_READ | GENERIC_WRITE,
+                           FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    return isOpen();
+}
+
+bool ChaosFile::isOpen() const {
+    return m_handle != INVALID_HANDLE_VALUE;
+}
+
+void ChaosFile::close() {
+    if (isOpen()) {
+        CloseHandle(m_handle);
+        m_handle = INVALID_HANDLE_VALUE;
+        m_direct = false;
+    }
+}
+
+uint64_t ChaosFile::size() const {
+    LARGE_INTEGER size;
+    return isOpen() && GetFileSizeEx(m_handle, &size) ? (uint64_t) size.QuadPart : 0;
+}
+
+bool ChaosFile::preallocate(uint64_t size) {
+    return truncate(size);
+}
+
+bool ChaosFile::truncate(uint64_t size) {
+    FILE_END_OF_FILE_INFO info;
+    info.EndOfFile.QuadPart = (LONGLONG) size;
+    return isOpen() && SetFileInformationByHandle(m_handle, FileEndOfFileInfo, &info, sizeof(info));
+}
+
+int64_t ChaosFile::readAt(void *buffer, size_t len, uint64_t offset) const {
+    size_t done = 0;
+    while (done < len) {
+        OVERLAPPED overlapped = {};
+        uint64_t pos = offset + done;
+        overlapped.Offset = (DWORD) pos;
+        overlapped.OffsetHigh = (DWORD) (pos >> 32);
+        DWORD want = (DWORD) std::min(len - done, (size_t) CHAOS_IO_CHUNK);
+        DWORD got = 0;
+        if (!ReadFile(m_handle, (char *) buffer + done, want, &got, &overlapped)) {
+            if (GetLastError() == ERROR_HANDLE_EOF) {
+                break;
+            }
+            return -1;
+        }
+        if (got == 0) {
+            break;
+        }
+        done += got;
+    }
+    return (int64_t) done;
+}
+
+bool ChaosFile::writeAt(const void *buffer, size_t len, uint64_t offset) const {
+    size_t done = 0;
+    while (done < len) {
+        OVERLAPPED overlapped = {};
+        uint64_t pos = offset + done;
+        overlapped.Offset = (DWORD) pos;
+        overlapped.OffsetHigh = (DWORD) (pos >> 32);
+        DWORD want = (DWORD) std::min(len - done, (size_t) CHAOS_IO_CHUNK);
+        DWORD put = 0;
+        if (!WriteFile(m_handle, (const char *) buffer + done, want, &put, &overlapped) || put == 0) {
+            return false;
+        }
+        done += put;
+    }
+    return true;
+}
+
+bool ChaosFile::sync() const {
+    return isOpen() && FlushFileBuffers(m_handle);
+}
+
+// FILE_FLAG_NO_BUFFERING 只能在打开文件时指定，Windows 暂不提供直接 I/O
+bool ChaosFile::setDirect(bool enable) {
+    return !enable;
+}
+
+// 原地加密只在 Android/iOS 上使用，Windows 暂不提供映射
+uint8_t *ChaosFile::map(uint64_t len) const {
+    return nullptr;
+}
+
+bool ChaosFile::unmap(uint8_t *data, uint64_t len) const {
+    return false;
+}
+
+#else
+
+ChaosFile::ChaosFile() : m_direct(false), m_fd(-1) {
+}
+
+ChaosFile::~ChaosFile() {
+    close();
+}
+
+bool ChaosFile::openRead(const std::string &path) {
+    close();
+    m_fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    return isOpen();
+}
+
+bool ChaosFile::openWrite(const std::string &path) {
+    close();
+    m_fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    return isOpen();
+}
+
+bool ChaosFile::openReadWrite(const std::string &path) {
+    close();
+    m_fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+    return isOpen();
+}
+
+bool ChaosFile::isOpen() const {
+    return m_fd >= 0;
+}
+
+void ChaosFile::close() {
+    if (isOpen()) {
+        ::close(m_fd);
+        m_fd = -1;
+        m_direct = false;
+    }
+}
+
+uint64_t ChaosFile::size() const {
+    chaos_stat_t st;
+    return isOpen() && chaos_fstat(m_fd, &st) == 0 ? (uint64_t) st.st_size : 0;
+}
+
+bool ChaosFile::preallocate(uint64_t size) {
+    if (!isOpen()) {
+        return false;
+    }
+#if defined(__linux__)
+    if (size > 0 && chaos_fallocate(m_fd, 0, size) == 0) {
+        return true;
+    }
+#endif
+    return truncate(size);
+}
+
+bool ChaosFile::truncate(uint64_t size) {
+    return isOpen() && chaos_ftruncate(m_fd, size) == 0;
+}
+
+int64_t ChaosFile::readAt(void *buffer, size_t len, uint64_t offset) const {
+    size_t done = 0;
+    while (done < len) {
+        size_t want = len - done < CHAOS_IO_CHUNK ? len - done : CHAOS_IO_CHUNK;
+        ssize_t got = chaos_pread(m_fd, (char *) buffer + done, want, offset + done);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (got == 0) {
+            break;
+        }
+        done += (size_t) got;
+        // 直接 I/O 在文件末尾短读后，剩余部分的偏移不再对齐，不能继续读
+        if (m_direct && done < len && offset + done >= size()) {
+            break;
+        }
+    }
+    return (int64_t) done;
+}
+
+bool ChaosFile::writeAt(const void *buffer, size_t len, uint64_t offset) const {
+    size_t done = 0;
+    while (done < len) {
+        size_t want = len - done < CHAOS_IO_CHUNK ? len - done : CHAOS_IO_CHUNK;
+        ssize_t put = chaos_pwrite(m_fd, (const char *) buffer + done, want, offset + done);
+        if (put < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        done += (size_t) put;
+    }
+    return true;
+}
+
+bool ChaosFile::sync() const {
+    return isOpen() && fsync(m_fd) == 0;
+}
+
+bool ChaosFile::setDirect(bool enable) {
+    if (!isOpen()) {
+        return false;
+    }
+    if (enable == m_direct) {
+        return true;
+    }
+#if defined(O_DIRECT)
+    // 文件系统不支持 O_DIRECT 时 F_SETFL 返回 EINVAL
+    int flags = fcntl(m_fd, F_GETFL);
+    if (flags < 0 || fcntl(m_fd, F_SETFL, enable ? flags | O_DIRECT : flags & ~O_DIRECT) != 0) {
+        return false;
+    }
+#elif defined(F_NOCACHE)
+    if (fcntl(m_fd, F_NOCACHE, enable ? 1 : 0) != 0) {
+        return false;
+    }
+#else
+    return false;
+#endif
+    m_direct = enable;
+    return true;
+}
+
+uint8_t *ChaosFile::map(uint64_t len) const {
+    if (!isOpen() || len == 0 || len > (uint64_t) SIZE_MAX) {
+        return nullptr;
+    }
+    void *data = mmap(nullptr, (size_t) len, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    return data == MAP_FAILED ? nullptr : (uint8_t *) data;
+}
+
+bool ChaosFile::unmap(uint8_t *data, uint64_t len) const {
+    bool synced = msync(data, (size_t) len, MS_SYNC) == 0;
+    return munmap(data, (size_t) len) == 0 && synced;
+}
+
+#endif
+
+// ================================================== io_uring ==================================================
+
+#ifdef CHAOS_HAS_IO_URING
+
+struct ChaosUring::Ring {
+    int fd = -1;
+    bool fixed = false;
+    // 提交队列
+    void *sqMap = nullptr;
+    size_t sqMapLen = 0;
+    unsigned *sqHead = nullptr;
+    unsigned *sqTail = nullptr;
+    unsigned *sqMask = nullptr;
+    unsigned *sqArray = nullptr;
+    io_uring_sqe *sqes = nullptr;
+    size_t sqesLen = 0;
+    unsigned sqLocalTail = 0;
+    unsigned sqSubmitted = 0;
+    // 完成队列，内核支持 IORING_FEAT_SINGLE_MMAP 时与提交队列共用一次映射
+    void *cqMap = nullptr;
+    size_t cqMapLen = 0;
+    unsigned *cqHead = nullptr;
+    unsigned *cqTail = nullptr;
+    unsigned *cqMask = nullptr;
+    io_uring_cqe *cqes = nullptr;
+
+    ~Ring() {
+        if (sqes != nullptr) {
+            munmap(sqes, sqesLen);
+        }
+        if (cqMap != nullptr && cqMap != sqMap) {
+            munmap(cqMap, cqMapLen);
+        }
+        if (sqMap != nullptr) {
+            munmap(sqMap, sqMapLen);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    bool setup(unsigned entries) {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+        if (fd < 0) {
+            return false;
+        }
+        sqMapLen = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqMapLen = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) {
+            sqMapLen = cqMapLen = sqMapLen > cqMapLen ? sqMapLen : cqMapLen;
+        }
+        sqMap = mmap(nullptr, sqMapLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sqMap == MAP_FAILED) {
+            sqMap = nullptr;
+            return false;
+        }
+        if (single) {
+            cqMap = sqMap;
+        } else {
+            cqMap = mmap(nullptr, cqMapLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (cqMap == MAP_FAILED) {
+                cqMap = nullptr;
+                return false;
+            }
+        }
+        sqesLen = params.sq_entries * sizeof(io_uring_sqe);
+        void *sqesMap = mmap(nullptr, sqesLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                             IORING_OFF_SQES);
+        if (sqesMap == MAP_FAILED) {
+            return false;
+        }
+        sqes = (io_uring_sqe *) sqesMap;
+        char *sq = (char *) sqMap;
+        sqHead = (unsigned *) (sq + params.sq_off.head);
+        sqTail = (unsigned *) (sq + params.sq_off.tail);
+        sqMask = (unsigned *) (sq + params.sq_off.ring_mask);
+        sqArray = (unsigned *) (sq + params.sq_off.array);
+        sqLocalTail = *sqTail;
+        sqSubmitted = sqLocalTail;
+        char *cq = (char *) cqMap;
+        cqHead = (unsigned *) (cq + params.cq_off.head);
+        cqTail = (unsigned *) (cq + params.cq_off.tail);
+        cqMask = (unsigned *) (cq + params.cq_off.ring_mask);
+        cqes = (io_uring_cqe *) (cq + params.cq_off.cqes);
+        return true;
+    }
+
+    io_uring_sqe *nextSqe() {
+        unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+        if (sqLocalTail - head > *sqMask) {
+            return nullptr;
+        }
+        unsigned index = sqLocalTail & *sqMask;
+        io_uring_sqe *sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqArray[index] = index;
+        sqLocalTail++;
+        return sqe;
+    }
+
+    bool prep(uint8_t op, uint8_t fixedOp, int fileFd, int bufferIndex, const void *addr, size_t len, uint64_t offset,
+              uint64_t userData) {
+        io_uring_sqe *sqe = nextSqe();
+        if (sqe == nullptr) {
+            return false;
+        }
+        sqe->opcode = fixed ? fixedOp : op;
+        sqe->fd = fileFd;
+        sqe->off = offset;
+        sqe->addr = (uint64_t) (uintptr_t) addr;
+        sqe->len = (uint32_t) len;
+        sqe->user_data = userData;
+        if (fixed) {
+            sqe->buf_index = (uint16_t) bufferIndex;
+        }
+        return true;
+    }
+};
+
+ChaosUring::ChaosUring() : m_ring(nullptr) {
+}
+
+ChaosUring::~ChaosUring() {
+    delete m_ring;
+}
+
+bool ChaosUring::init(unsigned entries, uint8_t *const *buffers, int bufferCount, size_t bufferSize) {
+    delete m_ring;
+    m_ring = new Ring();
+    if (!m_ring->setup(entries)) {
+        delete m_ring;
+        m_ring = nullptr;
+        return false;
+    }
+    // 固定缓冲区会锁定内存，超出 RLIMIT_MEMLOCK 时注册失败，此时使用普通读写请求
+    std::vector<iovec> iovecs(bufferCount);
+    for (int i = 0; i < bufferCount; i++) {
+        iovecs[i].iov_base = buffers[i];
+        iovecs[i].iov_len = bufferSize;
+    }
+    m_ring->fixed = bufferCount > 0 &&
+                    syscall(__NR_io_uring_register, m_ring->fd, IORING_REGISTER_BUFFERS, iovecs.data(),
+                            (unsigned) bufferCount) == 0;
+    return true;
+}
+
+bool ChaosUring::prepRead(const ChaosFile &file, int bufferIndex, uint8_t *addr, size_t len, uint64_t offset,
+                          uint64_t userData) {
+    return m_ring != nullptr &&
+           m_ring->prep(IORING_OP_READ, IORING_OP_READ_FIXED, file.m_fd, bufferIndex, addr, len, offset, userData);
+}
+
+bool ChaosUring::prepWrite(const ChaosFile &file, int bufferIndex, const uint8_t *addr, size_t len, uint64_t offset,
+                           uint64_t userData) {
+    return m_ring != nullptr &&
+           m_ring->prep(IORING_OP_WRITE, IORING_OP_WRITE_FIXED, file.m_fd, bufferIndex, addr, len, offset, userData);
+}
+
+bool ChaosUring::submit(unsigned waitCount) {
+    if (m_ring == nullptr) {
+        return false;
+    }
+    __atomic_store_n(m_ring->sqTail, m_ring->sqLocalTail, __ATOMIC_RELEASE);
+    unsigned toSubmit = m_ring->sqLocalTail - m_ring->sqSubmitted;
+    for (;;) {
+        long ret = syscall(__NR_io_uring_enter, m_ring->fd, toSubmit, waitCount,
+                           waitCount > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+        if (ret >= 0) {
+            m_ring->sqSubmitted += (unsigned) ret;
+            return true;
+        }
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+}
+
+bool ChaosUring::nextCompletion(uint64_t &userData, int &res) {
+    if (m_ring == nullptr) {
+        return false;
+    }
+    unsigned head = *m_ring->cqHead;
+    if (head == __atomic_load_n(m_ring->cqTail, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    const io_uring_cqe &cqe = m_ring->cqes[head & *m_ring->cqMask];
+    userData = cqe.user_data;
+    res = cqe.res;
+    __atomic_store_n(m_ring->cqHead, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static bool probeIoUring() {
+    ChaosUring ring;
+    return ring.init(4, nullptr, 0, 0);
+}
+
+#else
+
+ChaosUring::ChaosUring() : m_ring(nullptr) {
+}
+
+ChaosUring::~ChaosUring() {
+}
+
+bool ChaosUring::init(unsigned entries, uint8_t *const *buffers, int bufferCount, size_t bufferSize) {
+    return false;
+}
+
+bool ChaosUring::prepRead(const ChaosFile &file, int bufferIndex, uint8_t *addr, size_t len, uint64_t offset,
+                          uint64_t userData) {
+    return false;
+}
+
+bool ChaosUring::prepWrite(const ChaosFile &file, int bufferIndex, const uint8_t *addr, size_t len, uint64_t offset,
+                           uint64_t userData) {
+    return false;
+}
+
+bool ChaosUring::submit(unsigned waitCount) {
+    return false;
+}
+
+bool ChaosUring::nextCompletion(uint64_t &userData, int &res) {
+    return false;
+}
+
+static bool probeIoUring() {
+    return false;
+}
+
+#endif
+
+// -1 表示尚未探测
+static std::atomic<int> currentBackend(-1);
+
+int getFileIoBackend() {
+    int backend = currentBackend.load();
+    if (backend < 0) {
+        backend = probeIoUring() ? CHAOS_IO_URING : CHAOS_IO_PREAD;
+        currentBackend.store(backend);
+    }
+    return backend;
+}
+
+// 编译期能否使用直接 I/O，具体文件系统是否支持要到 ChaosFile::setDirect 时才知道
+#if !defined(_WIN32) && (defined(O_DIRECT) || defined(F_NOCACHE))
+#define CHAOS_HAS_DIRECT_IO 1
+#else
+#define CHAOS_HAS_DIRECT_IO 0
+#endif
+
+bool setFileIoBackend(int backend) {
+    if (backend == CHAOS_IO_PREAD || (backend == CHAOS_IO_URING && probeIoUring()) ||
+        (backend == CHAOS_IO_DIRECT && CHAOS_HAS_DIRECT_IO)) {
+        currentBackend.store(backend);
+        return true;
+    }
+    return false;
+}
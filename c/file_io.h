@@ -0,0 +1,173 @@
+#ifndef __FILE_IO_H__
+#define __FILE_IO_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Linux（不含 Android）上编译 io_uring 后端，可用 -DCHAOS_NO_IO_URING 关闭。
+// Android 的应用 seccomp 策略不允许 io_uring 系统调用，调用会直接终止进程，因此不编译
+#if defined(__linux__) && !defined(__ANDROID__) && !defined(CHAOS_NO_IO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define CHAOS_HAS_IO_URING 1
+#endif
+#endif
+
+// 文件读写后端
+enum CHAOS_IO_BACKEND {
+    // pread / pwrite，每个工作线程同步读写自己的块
+    CHAOS_IO_PREAD = 0,
+    // io_uring，由一个 I/O 线程保持多个块的读写同时在途，工作线程只做加解密
+    CHAOS_IO_URING = 1,
+    // 直接 I/O，按对齐的窗口流式读写、绕过页缓存，处理大于内存的文件时不挤占其他进程的缓存
+    CHAOS_IO_DIRECT = 2,
+};
+
+/**
+ * 当前使用的文件读写后端，首次调用时探测：编译了 io_uring 且内核允许创建 io_uring 时为 CHAOS_IO_URING
+ * CHAOS_IO_DIRECT 不会被自动选中，需要调用方通过 setFileIoBackend 显式开启
+ * @return CHAOS_IO_BACKEND
+ */
+int getFileIoBackend();
+
+/**
+ * 指定文件读写后端
+ * @param backend CHAOS_IO_BACKEND
+ * @return 未编译或内核不支持该后端时返回 false，后端不变
+ */
+bool setFileIoBackend(int backend);
+
+/**
+ * 按绝对偏移读写的文件
+ * readAt / writeAt 不移动共享的文件指针，多个线程可以不加锁地同时读写同一文件的不同区域
+ */
+class ChaosFile {
+public:
+    ChaosFile();
+
+    ~ChaosFile();
+
+    ChaosFile(const ChaosFile &) = delete;
+
+    ChaosFile &operator=(const ChaosFile &) = delete;
+
+    // 以只读方式打开，path 为 UTF-8 路径
+    bool openRead(const std::string &path);
+
+    // 以读写方式打开，文件不存在时创建，已存在时清空
+    bool openWrite(const std::string &path);
+
+    // 以读写方式打开已存在的文件，保留原内容
+    bool openReadWrite(const std::string &path);
+
+    bool isOpen() const;
+
+    void close();
+
+    // 文件当前大小，失败返回 0
+    uint64_t size() const;
+
+    /**
+     * 预先分配 size 字节，避免并行写入时反复扩展文件
+     * Linux/Android 使用 posix_fallocate 真正占用磁盘块，不支持时退回 ftruncate
+     */
+    bool preallocate(uint64_t size);
+
+    // 将文件截断或扩展为 size 字节
+    bool truncate(uint64_t size);
+
+    /**
+     * 从 offset 处读取最多 len 字节，内部处理短读与 EINTR
+     * @return 实际读取的字节数，只有到达文件末尾时才会小于 len；出错返回 -1
+     */
+    int64_t readAt(void *buffer, size_t len, uint64_t offset) const;
+
+    // 向 offset 处写入 len 字节，全部写入才返回 true
+    bool writeAt(const void *buffer, size_t len, uint64_t offset) const;
+
+    // 将已写入的数据刷到存储设备
+    bool sync() const;
+
+    /**
+     * 开启或关闭直接 I/O（Linux/Android 为 O_DIRECT，Apple 平台为 F_NOCACHE），读写不经过页缓存
+     * 开启后 readAt / writeAt 的偏移、长度与缓冲区地址都必须按 CHAOS_BUFFER_ALIGN 对齐，
+     * 只有读到文件末尾时长度可以不对齐
+     * @return 平台或文件系统不支持时返回 false，文件保持原模式
+     */
+    bool setDirect(bool enable);
+
+    bool isDirect() const {
+        return m_direct;
+    }
+
+    /**
+     * 以 MAP_SHARED 读写方式映射文件的前 len 字节，对映射内存的修改直接写回文件
+     * 地址空间不足（如 32 位进程映射超大文件）或平台不支持时返回 nullptr
+     */
+    uint8_t *map(uint64_t len) const;
+
+    // 同步（msync）并解除 map 得到的映射
+    bool unmap(uint8_t *data, uint64_t len) const;
+
+private:
+    friend class ChaosUring;
+
+    bool m_direct;
+#ifdef _WIN32
+    void *m_handle;
+#else
+    int m_fd;
+#endif
+};
+
+/**
+ * io_uring 提交/完成队列，直接使用系统调用，不依赖 liburing
+ * 一个实例只能由一个线程使用；未编译 io_uring 时 init 始终返回 false
+ */
+class ChaosUring {
+public:
+    ChaosUring();
+
+    ~ChaosUring();
+
+    ChaosUring(const ChaosUring &) = delete;
+
+    ChaosUring &operator=(const ChaosUring &) = delete;
+
+    /**
+     * 创建队列，并尝试把 buffers 注册为固定缓冲区（注册失败时退回普通读写请求）
+     * @param entries 队列深度
+     * @param buffers 缓冲区地址
+     * @param bufferCount 缓冲区数量
+     * @param bufferSize 每个缓冲区的字节数
+     * @return 内核不支持或被禁用时返回 false
+     */
+    bool init(unsigned entries, uint8_t *const *buffers, int bufferCount, size_t bufferSize);
+
+    /**
+     * 准备一个读请求：从 file 的 offset 处读 len 字节到第 bufferIndex 个缓冲区内的 addr
+     * @param userData 完成时原样返回
+     */
+    bool prepRead(const ChaosFile &file, int bufferIndex, uint8_t *addr, size_t len, uint64_t offset,
+                  uint64_t userData);
+
+    // 准备一个写请求，参数同 prepRead
+    bool prepWrite(const ChaosFile &file, int bufferIndex, const uint8_t *addr, size_t len, uint64_t offset,
+                   uint64_t userData);
+
+    // 提交已准备的请求，并等待至少 waitCount 个请求完成
+    bool submit(unsigned waitCount);
+
+    /**
+     * 取出一个完成事件
+     * @param res 读写的字节数，失败时为负的 errno
+     * @return 没有完成事件时返回 false
+     */
+    bool nextCompletion(uint64_t &userData, int &res);
+
+private:
+    struct Ring;
+    Ring *m_ring;
+};
+
+#endif
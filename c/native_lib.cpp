@@ -8,7 +8,10 @@
 #include <algorithm>
 #include <filesystem>
 #include "chaos.h"
-#include "sha256.h" // Needed for sha256_hash in file impl
+#include "chaos_simd.h"
+#include "block_pool.h"
+#include "pipeline.h"
+#include "file_io.h"
 
 #ifdef __ANDROID__
 #include <android/log.h>
@@ -55,49 +58,71 @@ CHAOS_OPERATION_RESULT encryptFileWithKey(std::string key, std::string inputPath
         return result;
     }
 
-    double x0, y0, z0, u, r, l;
-    std::string hash = sha256_hash(key);
-    generateRandom3(hash, x0, y0, z0, u, r, l);
+    int flags = newFileFlags();
+    CHAOS_FILE_MAP map;
+    initFileMap(getKeySchedule(key), getFileMapId(), flags, map);
 
     file.seekg(0, std::ios::end);
     std::streampos fileSize = file.tellg();
     fileLength = (uint64_t) fileSize;
     
-    // Write header
-    std::string emLenStr = "";
-    Len_t lenBit;
-    lenBit.len64 = static_cast<uint64_t>(fileSize);
-    getEmLenStr(lenBit, emLenStr);
-    outputFile.write(emLenStr.c_str(), emLenStr.length() * sizeof(char));
+    // Write the fixed-size v2 header
+    uint8_t header[CHAOS_FILE_HEADER_SIZE];
+    writeFileHeader(fileLength, flags, map.mapId, header);
+    outputFile.write(reinterpret_cast<const char *>(header), CHAOS_FILE_HEADER_SIZE);
 
     file.seekg(0, std::ios::beg);
 
     // Single threaded processing
-    std::vector<int> blockSizeArr = splitBlockSize(fileLength);
-    int blockIndex = 0;
+    std::vector<int> blockSizeArr = splitFileBlocks(fileLength, flags);
     int indexAll = blockSizeArr.size();
+    // Per-block CRC32 of the ciphertext, appended after the data
+    std::vector<uint32_t> crcs(indexAll / 2);
+    uint64_t written = 0;
     
-    // Buffer for reading
-    // reuse logic
-    for (blockIndex = 0; blockIndex < indexAll; blockIndex = blockIndex + 2) {
-        int currBlockSize = blockSizeArr[blockIndex];
-        unsigned char *buffer = (unsigned char *) malloc(currBlockSize * sizeof(unsigned char));
-        memset(buffer, 48, currBlockSize);
-
-        file.read(reinterpret_cast<char *>(buffer), currBlockSize);
-        // Handle read count? splitBlockSize ensures exact fit? 
-        // splitBlockSize creates blocks that sum up to size.
-        // But read might fail? 
-        // chaos_omp logic uses complex read/seek. Simple read should work if blocks are sequential.
-        
-        encode_Block3(buffer, blockSizeArr[blockIndex + 1], blockSizeArr[blockIndex + 1], x0, y0, z0, u, r, l);
-        
-        outputFile.write(reinterpret_cast<char *>(buffer), currBlockSize * sizeof(char));
-        free(buffer);
+    // Read, encrypt and write run as a three-stage pipeline: the chaos state still
+    // flows through the blocks in order on this thread while I/O overlaps with it
+    uint8_t *workspace = localWorkspace();
+    if (workspace == nullptr) {
+        result.errorMsg = "Out of memory.";
+        return result;
+    }
+    bool ok = runBlockPipeline(indexAll / 2,
+        [&](int i, uint8_t *buffer) {
+            int currBlockSize = blockSizeArr[2 * i];
+            file.read(reinterpret_cast<char *>(buffer), currBlockSize);
+            // Only the padded last block comes up short; pad it with 48 like a fresh block
+            memset(buffer + file.gcount(), 48, currBlockSize - file.gcount());
+            return !file.bad();
+        },
+        [&](int i, uint8_t *buffer) {
+            int n = blockSizeArr[2 * i + 1];
+            int m = blockSizeArr[2 * i] / n;
+            int k = blockKeyLength(m, n);
+            keyStream_FileMap(map, i, k, workspace, workspace + k);
+            encode_Diffuse(buffer, m, n, workspace, workspace + k, workspace);
+        },
+        [&](int i, const uint8_t *buffer) {
+            // Only the real bytes are written, so the output matches the multi-threaded path
+            uint64_t realSize = std::min((uint64_t) blockSizeArr[2 * i], fileLength - written);
+            crcs[i] = blockCrc32(buffer, realSize);
+            outputFile.write(reinterpret_cast<const char *>(buffer), realSize);
+            written += realSize;
+            return outputFile.good();
+        });
+    if (ok && !crcs.empty()) {
+        std::vector<uint8_t> crcTable(4 * crcs.size());
+        encodeBlockCrcTable(crcs, crcTable.data());
+        outputFile.write(reinterpret_cast<const char *>(crcTable.data()), crcTable.size());
+        ok = outputFile.good();
     }
 
     file.close();
     outputFile.close();
+    if (!ok) {
+        result.errorMsg = "File read/write failed.";
+        return result;
+    }
 
     auto end = std::chrono::steady_clock::now();
     auto durationMill = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
@@ -130,47 +155,87 @@ CHAOS_OPERATION_RESULT decryptFileWithKey(std::string key, std::string inputPath
         return result;
     }
 
-    double x0, y0, z0, u, r, l;
-    std::string hash = sha256_hash(key);
-    generateRandom3(hash, x0, y0, z0, u, r, l);
-
-    // Read header
-    // 2 bytes for len8
-    char lenbf[3];
-    file.read(lenbf, 2);
-    lenbf[2] = '\0';
-    int len8 = std::stoi(lenbf, 0, 16);
-    
-    int lenBufferLen = len8 / 4;
-    char *lenBuffer = (char *) malloc((lenBufferLen + 1) * sizeof(char));
-    file.read(lenBuffer, lenBufferLen);
-    lenBuffer[lenBufferLen] = '\0';
-    
-    uint64_t len64 = static_cast<uint64_t>(std::stoi(lenBuffer, 0, 16));
-    uint64_t fileSize = len64;
+    // Read the header in one go; v1 (ASCII hex length prefix) files are still accepted
+    uint8_t headerBuf[CHAOS_FILE_HEADER_SIZE];
+    file.read(reinterpret_cast<char *>(headerBuf), CHAOS_FILE_HEADER_SIZE);
+    CHAOS_FILE_HEADER header;
+    if (!parseFileHeader(headerBuf, static_cast<size_t>(file.gcount()), header)) {
+        result.errorMsg = "Invalid or unsupported file header.";
+        return result;
+    }
+    // The chaos map recorded in the header, not the current default
+    CHAOS_FILE_MAP map;
+    initFileMap(getKeySchedule(key), header.mapId, header.flags, map);
+    uint64_t fileSize = header.plainLength;
     fileLength = fileSize;
-    
-    free(lenBuffer);
-    
-    std::vector<int> blockSizeArr = splitBlockSize(fileSize);
-    int blockIndex = 0;
+
+    std::vector<int> blockSizeArr = splitFileBlocks(fileSize, header.flags);
     int indexAll = blockSizeArr.size();
 
-    for (blockIndex = 0; blockIndex < indexAll; blockIndex = blockIndex + 2) {
-        int currBlockSize = blockSizeArr[blockIndex];
-        unsigned char *buffer = (unsigned char *) malloc(currBlockSize * sizeof(unsigned char));
-        memset(buffer, 48, currBlockSize);
+    // Files carrying a block checksum table are checked block by block before decryption
+    bool hasCrcTable = header.crcTableOffset != 0;
+    std::vector<uint32_t> crcs(indexAll / 2);
+    if (hasCrcTable) {
+        std::vector<uint8_t> crcTable(4 * crcs.size());
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(header.crcTableOffset), std::ios::beg);
+        file.read(reinterpret_cast<char *>(crcTable.data()), crcTable.size());
+        if (static_cast<size_t>(file.gcount()) != crcTable.size()) {
+            result.errorMsg = "File is truncated.";
+            return result;
+        }
+        decodeBlockCrcTable(crcTable.data(), crcs);
+    }
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(header.dataOffset), std::ios::beg);
 
-        file.read(reinterpret_cast<char *>(buffer), currBlockSize);
-        
-        decode_Block3(buffer, blockSizeArr[blockIndex + 1], blockSizeArr[blockIndex + 1], x0, y0, z0, u, r, l);
-        
-        outputFile.write(reinterpret_cast<char *>(buffer), currBlockSize * sizeof(char));
-        free(buffer);
+    uint8_t *workspace = localWorkspace();
+    if (workspace == nullptr) {
+        result.errorMsg = "Out of memory.";
+        return result;
     }
+    uint64_t readPos = 0;
+    uint64_t written = 0;
+    bool corrupted = false;
+    bool ok = runBlockPipeline(indexAll / 2,
+        [&](int i, uint8_t *buffer) {
+            int currBlockSize = blockSizeArr[2 * i];
+            uint64_t realSize = std::min((uint64_t) currBlockSize, fileSize - readPos);
+            file.read(reinterpret_cast<char *>(buffer), realSize);
+            memset(buffer + file.gcount(), 48, currBlockSize - file.gcount());
+            readPos += realSize;
+            if (hasCrcTable && blockCrc32(buffer, realSize) != crcs[i]) {
+                corrupted = true;
+                return false;
+            }
+            return !file.bad();
+        },
+        [&](int i, uint8_t *buffer) {
+            int n = blockSizeArr[2 * i + 1];
+            int m = blockSizeArr[2 * i] / n;
+            int k = blockKeyLength(m, n);
+            keyStream_FileMap(map, i, k, workspace, workspace + k);
+            decode_Diffuse(buffer, m, n, workspace, workspace + k, workspace);
+        },
+        [&](int i, const uint8_t *buffer) {
+            uint64_t realSize = std::min((uint64_t) blockSizeArr[2 * i], fileSize - written);
+            outputFile.write(reinterpret_cast<const char *>(buffer), realSize);
+            written += realSize;
+            return outputFile.good();
+        });
 
     file.close();
     outputFile.close();
+    if (corrupted) {
+        // Do not leave partially decrypted data behind
+        std::ofstream(outputPath, std::ios::binary | std::ios::trunc);
+        result.errorMsg = "File is corrupted (block checksum mismatch).";
+        return result;
+    }
+    if (!ok) {
+        result.errorMsg = "File read/write failed.";
+        return result;
+    }
 
     auto end = std::chrono::steady_clock::now();
     auto durationMill = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
@@ -198,14 +263,31 @@ extern "C" {
         }
     }
 
+    // Like string_to_char, but copies every byte of str, including embedded NULs
+    static char* string_to_buffer(const std::string& str) {
+        char* buffer = (char*)malloc(str.length() + 1);
+        if (buffer == nullptr) return nullptr;
+        memcpy(buffer, str.data(), str.length());
+        buffer[str.length()] = '\0';
+        return buffer;
+    }
+
+    // Returns result.result through string_to_buffer with its length in *out_len, or nullptr on failure
+    static char* str_result_to_buffer(const CHAOS_OPERATION_RESULT& result, uint64_t* out_len, const char* what) {
+        if (!result.success) {
+            LOGE("%s string failed: %s", what, result.errorMsg.c_str());
+            return nullptr;
+        }
+        *out_len = result.result.length();
+        return string_to_buffer(result.result);
+    }
+
     // Encrypt string with key
     // Returns a newly allocated char* that must be freed by caller using free_memory
+    // input is NUL-terminated; use encrypt_string_bytes for plaintext that may contain NULs
     char* encrypt_string(char* key, char* input) {
         if (key == nullptr || input == nullptr) return nullptr;
-        std::string keyStr(key);
-        std::string inputStr(input);
-        
-        CHAOS_OPERATION_RESULT result = encryptStrWithKey(keyStr, inputStr);
+        CHAOS_OPERATION_RESULT result = encryptStrWithKey(std::string_view(key), std::string_view(input));
         
         if (result.success) {
             return string_to_char(result.result);
@@ -216,19 +298,75 @@ extern "C" {
     }
 
     // Decrypt string with key
+    // The plaintext is returned NUL-terminated; use decrypt_string_bytes if it may contain NULs
     char* decrypt_string(char* key, char* input) {
         if (key == nullptr || input == nullptr) return nullptr;
-        std::string keyStr(key);
-        std::string inputStr(input);
+        CHAOS_OPERATION_RESULT result = decryptStrWithKey(std::string_view(key), std::string_view(input));
         
-        CHAOS_OPERATION_RESULT result = decryptStrWithKey(keyStr, inputStr);
+        if (result.success) {
+            return string_to_char(result.result);
+        } else {
+            LOGE("Decrypt string failed: %s", result.errorMsg.c_str());
+            return nullptr;
+        }
+    }
+
+    // Binary-safe encrypt_string: encrypts input_len bytes of input (may contain NULs)
+    // Returns a newly allocated hex string that must be freed by caller using free_memory, or nullptr on failure
+    char* encrypt_string_bytes(char* key, char* input, uint64_t input_len) {
+        if (key == nullptr || input == nullptr) return nullptr;
+        CHAOS_OPERATION_RESULT result = encryptStrWithKey(std::string_view(key), std::string_view(input, input_len));
         
         if (result.success) {
             return string_to_char(result.result);
         } else {
+            LOGE("Encrypt string failed: %s", result.errorMsg.c_str());
+            return nullptr;
+        }
+    }
+
+    // Binary-safe decrypt_string
+    // Returns a newly allocated buffer holding *out_len plaintext bytes plus a trailing NUL, or nullptr on failure
+    char* decrypt_string_bytes(char* key, char* input, uint64_t* out_len) {
+        if (key == nullptr || input == nullptr || out_len == nullptr) return nullptr;
+        CHAOS_OPERATION_RESULT result = decryptStrWithKey(std::string_view(key), std::string_view(input));
+        return str_result_to_buffer(result, out_len, "Decrypt");
+    }
+
+    // Encrypt string with key in the given CHAOS_STR_FORMAT (0 = hex, 1 = binary, 2 = Base64;
+    // add 0x10 to binary/Base64 for the warm-once mode, which decryption detects by itself)
+    // Returns a newly allocated buffer holding *out_len bytes plus a trailing NUL, or nullptr on failure
+    char* encrypt_string_format(char* key, char* input, int format, uint64_t* out_len) {
+        if (key == nullptr || input == nullptr || out_len == nullptr) return nullptr;
+        CHAOS_OPERATION_RESULT result = encryptStrWithKey(std::string_view(key), std::string_view(input), format);
+        return str_result_to_buffer(result, out_len, "Encrypt");
+    }
+
+    // Decrypt input_len bytes produced by encrypt_string_format with the same format
+    // The plaintext is returned NUL-terminated; use decrypt_string_format_bytes if it may contain NULs
+    char* decrypt_string_format(char* key, char* input, uint64_t input_len, int format) {
+        if (key == nullptr || input == nullptr) return nullptr;
+        CHAOS_OPERATION_RESULT result = decryptStrWithKey(std::string_view(key), std::string_view(input, input_len), format);
+        if (!result.success) {
             LOGE("Decrypt string failed: %s", result.errorMsg.c_str());
             return nullptr;
         }
+        return string_to_char(result.result);
+    }
+
+    // Binary-safe encrypt_string_format: encrypts input_len bytes of input
+    char* encrypt_string_format_bytes(char* key, char* input, uint64_t input_len, int format, uint64_t* out_len) {
+        if (key == nullptr || input == nullptr || out_len == nullptr) return nullptr;
+        CHAOS_OPERATION_RESULT result = encryptStrWithKey(std::string_view(key), std::string_view(input, input_len), format);
+        return str_result_to_buffer(result, out_len, "Encrypt");
+    }
+
+    // Binary-safe decrypt_string_format
+    // Returns a newly allocated buffer holding *out_len plaintext bytes plus a trailing NUL, or nullptr on failure
+    char* decrypt_string_format_bytes(char* key, char* input, uint64_t input_len, int format, uint64_t* out_len) {
+        if (key == nullptr || input == nullptr || out_len == nullptr) return nullptr;
+        CHAOS_OPERATION_RESULT result = decryptStrWithKey(std::string_view(key), std::string_view(input, input_len), format);
+        return str_result_to_buffer(result, out_len, "Decrypt");
     }
 
     // Encrypt file with key
@@ -270,7 +408,7 @@ extern "C" {
         }
     }
 
-    // Multi-threaded File Encryption (Android Only - OpenMP)
+    // Multi-threaded File Encryption (shared worker pool, all platforms)
     // Returns formatted string: "SUCCESS|time_ms|speed_mbps" or "ERROR|msg"
     char* encrypt_file_mt(int threads, char* key, char* inputPath, char* outputPath) {
         if (key == nullptr || inputPath == nullptr || outputPath == nullptr) return string_to_char("ERROR|Invalid arguments");
@@ -281,14 +419,8 @@ extern "C" {
 
         CHAOS_OPERATION_RESULT result;
 
-        #ifdef _OPENMP
-        // If threads is 1, we can still use OMP or fallback. OMP with 1 thread is fine.
+        // Runs on the library's shared worker pool on every platform
         result = encryptFileWithKey_OMP(threads, keyStr, input, output);
-        #else
-        // Fallback for non-OMP platforms
-        LOGI("OpenMP not supported, falling back to single thread");
-        result = encryptFileWithKey(keyStr, input, output);
-        #endif
 
         if (result.success) {
             std::string res = "SUCCESS|" + std::to_string(result.mill) + "|" + std::to_string(result.speed);
@@ -298,7 +430,7 @@ extern "C" {
         }
     }
 
-    // Multi-threaded File Decryption (Android Only - OpenMP)
+    // Multi-threaded File Decryption (shared worker pool, all platforms)
     // Returns formatted string: "SUCCESS|time_ms|speed_mbps" or "ERROR|msg"
     char* decrypt_file_mt(int threads, char* key, char* inputPath, char* outputPath) {
         if (key == nullptr || inputPath == nullptr || outputPath == nullptr) return string_to_char("ERROR|Invalid arguments");
@@ -309,16 +441,10 @@ extern "C" {
 
         CHAOS_OPERATION_RESULT result;
 
-        #ifdef _OPENMP
         result = decryptFileWithKey_OMP(threads, keyStr, input, output);
-        #else
-        // Fallback for non-OMP platforms
-        LOGI("OpenMP not supported, falling back to single thread");
-        result = decryptFileWithKey(keyStr, input, output);
-        #endif
 
         if (result.success) {
-             // Calculate speed for decryption if not set (it might be set by OMP but verify)
+             // Calculate speed for decryption if not set (it might be set by the MT path but verify)
             if (result.speed == 0 && result.mill > 0) {
                  result.speed = static_cast<float>(result.size) * 8 / 1024 / 1024 / 1024 / static_cast<float>(result.mill) * 1000;
             }
@@ -328,4 +454,320 @@ extern "C" {
             return string_to_char("ERROR|" + result.errorMsg);
         }
     }
+
+    // Check an encrypted file against its per-block checksum table without decrypting it (no key needed)
+    // Returns "SUCCESS|time_ms|speed_gbps" or "ERROR|msg"
+    char* verify_file(int threads, char* path) {
+        if (path == nullptr) return string_to_char("ERROR|Invalid arguments");
+        CHAOS_OPERATION_RESULT result = verifyFile_OMP(threads, std::string(path));
+        if (result.success) {
+            return string_to_char("SUCCESS|" + std::to_string(result.mill) + "|" + std::to_string(result.speed));
+        }
+        return string_to_char("ERROR|" + result.errorMsg);
+    }
+
+    // SHA-256 fingerprint of a whole file
+    // Returns "SUCCESS|hex_digest|time_ms|speed" or "ERROR|msg"
+    char* file_fingerprint(char* path) {
+        if (path == nullptr) return string_to_char("ERROR|Invalid arguments");
+        CHAOS_OPERATION_RESULT result = fingerprintFile(std::string(path));
+        if (result.success) {
+            return string_to_char("SUCCESS|" + result.result + "|" + std::to_string(result.mill) + "|" +
+                                  std::to_string(result.speed));
+        }
+        return string_to_char("ERROR|" + result.errorMsg);
+    }
+
+    // Encrypt the same file with 1, 2, 4 ... max_threads threads to measure MT scaling
+    // Returns "SUCCESS|threads:gbps|threads:gbps|..." or "ERROR|msg"
+    char* benchmark_file_scaling(int maxThreads, char* key, char* inputPath, char* outputPath) {
+        if (key == nullptr || inputPath == nullptr || outputPath == nullptr) return string_to_char("ERROR|Invalid arguments");
+        CHAOS_OPERATION_RESULT result = benchmarkFileScaling_OMP(maxThreads, std::string(key), std::string(inputPath),
+                                                                 std::string(outputPath));
+        if (result.success) {
+            return string_to_char("SUCCESS|" + result.result);
+        }
+        return string_to_char("ERROR|" + result.errorMsg);
+    }
+
+    // Measure single- vs multi-threaded in-memory encryption from 256 KiB up to max_size bytes
+    // Returns "SUCCESS|crossover|size:st_gbps:mt_gbps|..." (crossover 0 = MT never won) or "ERROR|msg"
+    char* benchmark_parallel_crossover(int threads, uint64_t maxSize) {
+        CHAOS_OPERATION_RESULT result = benchmarkParallelCrossover(threads, maxSize);
+        if (result.success) {
+            return string_to_char("SUCCESS|" + std::to_string(result.size) + "|" + result.result);
+        }
+        return string_to_char("ERROR|" + result.errorMsg);
+    }
+
+    // Size from which in-memory string/buffer operations switch to the multi-threaded block engine
+    // Values below MIN_PARALLEL_SIZE are raised to it; UINT64_MAX disables the switch
+    void set_parallel_threshold(uint64_t size) {
+        setParallelThreshold(size);
+    }
+
+    uint64_t get_parallel_threshold() {
+        return getParallelThreshold();
+    }
+
+    // Select the I/O backend of the multi-threaded file paths (CHAOS_IO_BACKEND: 0 = pread, 1 = io_uring, 2 = direct I/O)
+    // Returns "SUCCESS|backend" with the backend now in use, or "ERROR|msg" if it is unavailable
+    char* set_io_backend(int backend) {
+        if (!setFileIoBackend(backend)) {
+            return string_to_char("ERROR|Unsupported I/O backend");
+        }
+        return string_to_char("SUCCESS|" + std::to_string(getFileIoBackend()));
+    }
+
+    // Encrypt short strings and a 1 MiB + 100 byte input with and without warm-once
+    // Returns "SUCCESS|size:legacy_us:warm_once_us|..." or "ERROR|msg"
+    char* benchmark_warmup(int rounds) {
+        CHAOS_OPERATION_RESULT result = benchmarkWarmup(rounds);
+        if (result.success) {
+            return string_to_char("SUCCESS|" + result.result);
+        }
+        return string_to_char("ERROR|" + result.errorMsg);
+    }
+
+    // Warm the chaos state up once per file instead of once per block for newly encrypted files
+    // (chained mode only); older builds cannot decrypt such files
+    void set_file_warm_once(int enable) {
+        setFileWarmOnce(enable != 0);
+    }
+
+    // Select the chaos map of newly encrypted files (CHAOS_MAP_ID: 2 = 3D double map, 3 = fixed-point map)
+    // Decryption always follows the map recorded in the file header
+    // Returns "SUCCESS|map_id" or "ERROR|msg" if the map is not supported for files
+    char* set_file_map(int mapId) {
+        if (!setFileMapId(mapId)) {
+            return string_to_char("ERROR|Unsupported chaos map");
+        }
+        return string_to_char("SUCCESS|" + std::to_string(getFileMapId()));
+    }
+
+    // Split newly encrypted files into full 1024x1024 blocks plus a single rectangular tail block
+    // instead of a cascade of shrinking squares; older builds cannot decrypt such files
+    void set_file_rect_blocks(int enable) {
+        setFileRectBlocks(enable != 0);
+    }
+
+    // Give every block of newly encrypted files its own seed (key + block index) instead of chaining
+    // the chaos state, so keystreams can be generated on all cores; older builds cannot decrypt such files
+    void set_file_block_seed(int enable) {
+        setFileBlockSeed(enable != 0);
+    }
+
+    // Formats a buffer operation result as "SUCCESS|time_ms|speed" or "ERROR|msg"
+    static char* buffer_result_to_char(const CHAOS_OPERATION_RESULT& result) {
+        if (result.success) {
+            std::string res = "SUCCESS|" + std::to_string(result.mill) + "|" + std::to_string(result.speed);
+            return string_to_char(res);
+        }
+        return string_to_char("ERROR|" + result.errorMsg);
+    }
+
+    // Encrypt caller-owned memory with key (no header, ciphertext has the same length as input)
+    // input and output must both hold len bytes; pass the same pointer to encrypt in place
+    // Returns "SUCCESS|time_ms|speed" or "ERROR|msg"
+    char* encrypt_buffer(char* key, uint8_t* input, uint8_t* output, uint64_t len) {
+        if (key == nullptr || input == nullptr || output == nullptr) return string_to_char("ERROR|Invalid arguments");
+        return buffer_result_to_char(encryptBufferWithKey(std::string(key), input, output, len));
+    }
+
+    // Decrypt caller-owned memory with key, input and output may be the same pointer
+    char* decrypt_buffer(char* key, uint8_t* input, uint8_t* output, uint64_t len) {
+        if (key == nullptr || input == nullptr || output == nullptr) return string_to_char("ERROR|Invalid arguments");
+        return buffer_result_to_char(decryptBufferWithKey(std::string(key), input, output, len));
+    }
+
+    // Multi-threaded buffer encryption, output is identical to encrypt_buffer for any thread count
+    char* encrypt_buffer_mt(int threads, char* key, uint8_t* input, uint8_t* output, uint64_t len) {
+        if (key == nullptr || input == nullptr || output == nullptr) return string_to_char("ERROR|Invalid arguments");
+        return buffer_result_to_char(encryptBufferWithKey_OMP(threads, std::string(key), input, output, len));
+    }
+
+    // Multi-threaded buffer decryption
+    char* decrypt_buffer_mt(int threads, char* key, uint8_t* input, uint8_t* output, uint64_t len) {
+        if (key == nullptr || input == nullptr || output == nullptr) return string_to_char("ERROR|Invalid arguments");
+        return buffer_result_to_char(decryptBufferWithKey_OMP(threads, std::string(key), input, output, len));
+    }
+
+    // Derive the parameters of key once and keep them under a handle, so repeated small messages skip key setup
+    // Returns "SUCCESS|handle" or "ERROR|msg"; release with close_key_handle
+    char* open_key_handle(char* key) {
+        if (key == nullptr) return string_to_char("ERROR|Invalid arguments");
+        int handle = openKeyHandle(std::string_view(key));
+        if (handle < 0) {
+            return string_to_char("ERROR|Key must be between 8 and 256 characters.");
+        }
+        return string_to_char("SUCCESS|" + std::to_string(handle));
+    }
+
+    // Returns 1 if the handle was open, 0 otherwise
+    int close_key_handle(int handle) {
+        return closeKeyHandle(handle) ? 1 : 0;
+    }
+
+    // Drop every cached key schedule (keys in the cache are wiped)
+    void clear_key_cache() {
+        clearKeyScheduleCache();
+    }
+
+    // Same as encrypt_string, using a handle from open_key_handle
+    char* encrypt_string_with_handle(int handle, char* input) {
+        CHAOS_KEY_SCHEDULE schedule;
+        if (input == nullptr || !getKeyHandle(handle, schedule)) return nullptr;
+        CHAOS_OPERATION_RESULT result = encryptStrWithSchedule(schedule, std::string_view(input));
+        if (result.success) {
+            return string_to_char(result.result);
+        }
+        LOGE("Encrypt string failed: %s", result.errorMsg.c_str());
+        return nullptr;
+    }
+
+    // Same as decrypt_string, using a handle from open_key_handle
+    char* decrypt_string_with_handle(int handle, char* input) {
+        CHAOS_KEY_SCHEDULE schedule;
+        if (input == nullptr || !getKeyHandle(handle, schedule)) return nullptr;
+        CHAOS_OPERATION_RESULT result = decryptStrWithSchedule(schedule, std::string_view(input));
+        if (result.success) {
+            return string_to_char(result.result);
+        }
+        LOGE("Decrypt string failed: %s", result.errorMsg.c_str());
+        return nullptr;
+    }
+
+    // Same as encrypt_string_bytes, using a handle from open_key_handle
+    char* encrypt_string_with_handle_bytes(int handle, char* input, uint64_t input_len) {
+        CHAOS_KEY_SCHEDULE schedule;
+        if (input == nullptr || !getKeyHandle(handle, schedule)) return nullptr;
+        CHAOS_OPERATION_RESULT result = encryptStrWithSchedule(schedule, std::string_view(input, input_len));
+        if (result.success) {
+            return string_to_char(result.result);
+        }
+        LOGE("Encrypt string failed: %s", result.errorMsg.c_str());
+        return nullptr;
+    }
+
+    // Same as decrypt_string_bytes, using a handle from open_key_handle
+    char* decrypt_string_with_handle_bytes(int handle, char* input, uint64_t* out_len) {
+        CHAOS_KEY_SCHEDULE schedule;
+        if (input == nullptr || out_len == nullptr || !getKeyHandle(handle, schedule)) return nullptr;
+        CHAOS_OPERATION_RESULT result = decryptStrWithSchedule(schedule, std::string_view(input));
+        return str_result_to_buffer(result, out_len, "Decrypt");
+    }
+
+    // Copies a batch arena out for Dart; offsets receives count + 1 entries, status (optional) count entries
+    static char* batch_to_buffer(const CHAOS_STR_BATCH& batch, int count, uint64_t* offsets, uint8_t* status) {
+        memcpy(offsets, batch.offsets.data(), ((size_t) count + 1) * sizeof(uint64_t));
+        if (status != nullptr && count > 0) {
+            memcpy(status, batch.status.data(), (size_t) count);
+        }
+        return string_to_buffer(batch.arena);
+    }
+
+    // Runs a batch over count (pointer, length) inputs
+    static char* string_batch(int threads, const CHAOS_KEY_SCHEDULE* schedule, char* key, const char** inputs,
+                              const uint64_t* lengths, int count, int format, uint64_t* offsets, uint8_t* status,
+                              bool decrypt) {
+        if (offsets == nullptr || count < 0 || (count > 0 && (inputs == nullptr || lengths == nullptr))) return nullptr;
+        std::vector<std::string_view> views((size_t) count);
+        for (int i = 0; i < count; i++) {
+            if (inputs[i] == nullptr && lengths[i] != 0) return nullptr;
+            views[i] = std::string_view(inputs[i], lengths[i]);
+        }
+        CHAOS_STR_BATCH batch;
+        CHAOS_OPERATION_RESULT result;
+        if (schedule != nullptr) {
+            result = decrypt ? decryptStrBatchWithSchedule_OMP(threads, *schedule, views.data(), count, format, batch)
+                             : encryptStrBatchWithSchedule_OMP(threads, *schedule, views.data(), count, format, batch);
+        } else {
+            result = decrypt ? decryptStrBatch_OMP(threads, std::string_view(key), views.data(), count, format, batch)
+                             : encryptStrBatch_OMP(threads, std::string_view(key), views.data(), count, format, batch);
+        }
+        if (!result.success) {
+            LOGE("String batch failed: %s", result.errorMsg.c_str());
+            return nullptr;
+        }
+        return batch_to_buffer(batch, count, offsets, status);
+    }
+
+    // Encrypt count messages with one key in a single call; inputs[i] holds lengths[i] bytes
+    // All ciphertexts are packed into one returned buffer (free with free_memory): message i occupies
+    // [offsets[i], offsets[i + 1]), so offsets needs room for count + 1 entries.
+    // status[i] (may be nullptr) is 1 on success, 0 on failure with an empty output. Returns nullptr on bad arguments.
+    char* encrypt_string_batch(int threads, char* key, const char** inputs, const uint64_t* lengths, int count,
+                               int format, uint64_t* offsets, uint8_t* status) {
+        if (key == nullptr) return nullptr;
+        return string_batch(threads, nullptr, key, inputs, lengths, count, format, offsets, status, false);
+    }
+
+    // Decrypt count messages produced with the same key and format; layout as encrypt_string_batch
+    char* decrypt_string_batch(int threads, char* key, const char** inputs, const uint64_t* lengths, int count,
+                               int format, uint64_t* offsets, uint8_t* status) {
+        if (key == nullptr) return nullptr;
+        return string_batch(threads, nullptr, key, inputs, lengths, count, format, offsets, status, true);
+    }
+
+    // Same as encrypt_string_batch / decrypt_string_batch, using a handle from open_key_handle
+    char* encrypt_string_batch_with_handle(int threads, int handle, const char** inputs, const uint64_t* lengths,
+                                           int count, int format, uint64_t* offsets, uint8_t* status) {
+        CHAOS_KEY_SCHEDULE schedule;
+        if (!getKeyHandle(handle, schedule)) return nullptr;
+        return string_batch(threads, &schedule, nullptr, inputs, lengths, count, format, offsets, status, false);
+    }
+
+    char* decrypt_string_batch_with_handle(int threads, int handle, const char** inputs, const uint64_t* lengths,
+                                           int count, int format, uint64_t* offsets, uint8_t* status) {
+        CHAOS_KEY_SCHEDULE schedule;
+        if (!getKeyHandle(handle, schedule)) return nullptr;
+        return string_batch(threads, &schedule, nullptr, inputs, lengths, count, format, offsets, status, true);
+    }
+
+    // Same as encrypt_buffer, using a handle from open_key_handle
+    char* encrypt_buffer_with_handle(int handle, uint8_t* input, uint8_t* output, uint64_t len) {
+        CHAOS_KEY_SCHEDULE schedule;
+        if (input == nullptr || output == nullptr) return string_to_char("ERROR|Invalid arguments");
+        if (!getKeyHandle(handle, schedule)) return string_to_char("ERROR|Invalid key handle");
+        return buffer_result_to_char(encryptBufferWithSchedule(schedule, input, output, len));
+    }
+
+    // Same as decrypt_buffer, using a handle from open_key_handle
+    char* decrypt_buffer_with_handle(int handle, uint8_t* input, uint8_t* output, uint64_t len) {
+        CHAOS_KEY_SCHEDULE schedule;
+        if (input == nullptr || output == nullptr) return string_to_char("ERROR|Invalid arguments");
+        if (!getKeyHandle(handle, schedule)) return string_to_char("ERROR|Invalid key handle");
+        return buffer_result_to_char(decryptBufferWithSchedule(schedule, input, output, len));
+    }
+
+    // Encrypt a file in place through a shared memory mapping (no second copy on disk)
+    // The ciphertext keeps the original length and gets a 16-byte trailer; see chaos.h for crash safety
+    // Returns "SUCCESS|time_ms|speed" or "ERROR|msg"
+    char* encrypt_file_inplace(int threads, char* key, char* path) {
+        if (key == nullptr || path == nullptr) return string_to_char("ERROR|Invalid arguments");
+        return buffer_result_to_char(encryptFileInPlace_OMP(threads, std::string(key), std::string(path)));
+    }
+
+    // Decrypt a file produced by encrypt_file_inplace and strip its trailer; a wrong key is rejected
+    // before the file is touched, and a run interrupted before it changed the data is resumed
+    char* decrypt_file_inplace(int threads, char* key, char* path) {
+        if (key == nullptr || path == nullptr) return string_to_char("ERROR|Invalid arguments");
+        return buffer_result_to_char(decryptFileInPlace_OMP(threads, std::string(key), std::string(path)));
+    }
+
+    // Benchmark the row and column diffusion passes on one side x side block
+    // level selects the kernel set (CHAOS_SIMD_LEVEL), -1 keeps the auto-detected one
+    // Returns "SUCCESS|level|row_gbps|column_gbps" or "ERROR|msg"
+    // The level only applies to this benchmark; concurrent encrypt/decrypt calls keep their kernels
+    char* benchmark_diffuse(int side, int rounds, int level) {
+        int used = level >= 0 ? level : getSimdLevel();
+        if (!isSimdLevelSupported(used)) {
+            return string_to_char("ERROR|Unsupported SIMD level");
+        }
+        CHAOS_OPERATION_RESULT result = benchmarkDiffusePasses(side, rounds, used);
+        if (result.success) {
+            return string_to_char("SUCCESS|" + std::to_string(used) + "|" + result.result);
+        }
+        return string_to_char("ERROR|" + result.errorMsg);
+    }
 }
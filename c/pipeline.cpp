@@ -0,0 +1,120 @@
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "pipeline.h"
+#include "block_pool.h"
+
+namespace {
+    // 块缓冲所处的阶段
+    enum SLOT_STAGE {
+        SLOT_FREE = 0,
+        SLOT_READ = 1,
+        SLOT_COMPUTED = 2,
+    };
+
+    struct PipelineState {
+        std::mutex mutex;
+        std::condition_variable cond;
+        int stage[CHAOS_PIPELINE_DEPTH] = {SLOT_FREE};
+        bool failed = false;
+
+        // 等待块 i 的缓冲进入 from 阶段，失败时返回 false
+        bool wait(int i, int from) {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [&] { return failed || stage[i % CHAOS_PIPELINE_DEPTH] == from; });
+            return !failed;
+        }
+
+        void advance(int i, int to) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stage[i % CHAOS_PIPELINE_DEPTH] = to;
+            }
+            cond.notify_all();
+        }
+
+        void fail() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                failed = true;
+            }
+            cond.notify_all();
+        }
+    };
+}
+
+bool runBlockPipeline(int blockNum, uint8_t *const *slots,
+                      const std::function<bool(int i, uint8_t *buffer)> &read,
+                      const std::function<void(int i, uint8_t *buffer)> &compute,
+                      const std::function<bool(int i, const uint8_t *buffer)> &write) {
+    if (blockNum <= 0) {
+        return true;
+    }
+    bool ok = true;
+    if (blockNum == 1) {
+        // 只有一块时没有可重叠的部分
+        ok = read(0, slots[0]);
+        if (ok) {
+            compute(0, slots[0]);
+            ok = write(0, slots[0]);
+        }
+    } else {
+        PipelineState state;
+        std::thread reader([&] {
+            for (int i = 0; i < blockNum; i++) {
+                if (!state.wait(i, SLOT_FREE)) {
+                    return;
+                }
+                if (!read(i, slots[i % CHAOS_PIPELINE_DEPTH])) {
+                    state.fail();
+                    return;
+                }
+                state.advance(i, SLOT_READ);
+            }
+        });
+        std::thread writer([&] {
+            for (int i = 0; i < blockNum; i++) {
+                if (!state.wait(i, SLOT_COMPUTED)) {
+                    return;
+                }
+                if (!write(i, slots[i % CHAOS_PIPELINE_DEPTH])) {
+                    state.fail();
+                    return;
+                }
+                state.advance(i, SLOT_FREE);
+            }
+        });
+        for (int i = 0; i < blockNum; i++) {
+            if (!state.wait(i, SLOT_READ)) {
+                break;
+            }
+            compute(i, slots[i % CHAOS_PIPELINE_DEPTH]);
+            state.advance(i, SLOT_COMPUTED);
+        }
+        reader.join();
+        writer.join();
+        ok = !state.failed;
+    }
+    return ok;
+}
+
+bool runBlockPipeline(int blockNum,
+                      const std::function<bool(int i, uint8_t *buffer)> &read,
+                      const std::function<void(int i, uint8_t *buffer)> &compute,
+                      const std::function<bool(int i, const uint8_t *buffer)> &write) {
+    if (blockNum <= 0) {
+        return true;
+    }
+    BlockPool &pool = BlockPool::local();
+    uint8_t *slots[CHAOS_PIPELINE_DEPTH];
+    bool allocated = true;
+    for (int s = 0; s < CHAOS_PIPELINE_DEPTH; s++) {
+        slots[s] = pool.acquire();
+        allocated = allocated && slots[s] != nullptr;
+    }
+    bool ok = allocated && runBlockPipeline(blockNum, slots, read, compute, write);
+    for (int s = 0; s < CHAOS_PIPELINE_DEPTH; s++) {
+        pool.release(slots[s]);
+    }
+    return ok;
+}
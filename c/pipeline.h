@@ -0,0 +1,33 @@
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include <cstdint>
+#include <functional>
+
+// 流水线中循环使用的块缓冲数量：读、算、写三段各占一个
+#define CHAOS_PIPELINE_DEPTH 3
+
+/**
+ * 三段块流水线：读线程 → 计算（调用线程） → 写线程
+ * 三段都严格按块序号 0 ~ blockNum-1 的顺序处理，混沌状态可以在计算段中按顺序传递；
+ * 各段之间通过 CHAOS_PIPELINE_DEPTH 个块缓冲循环传递，总耗时趋近 max(I/O, 计算) 而不是两者之和
+ * @param blockNum 块数量
+ * @param read 读取第 i 块到 buffer，返回 false 表示失败
+ * @param compute 处理第 i 块
+ * @param write 写出第 i 块，返回 false 表示失败
+ * @return 任一段失败时其余段尽快停止并返回 false；从当前线程的 BlockPool 取缓冲失败时不调用任何回调，直接返回 false
+ */
+bool runBlockPipeline(int blockNum,
+                      const std::function<bool(int i, uint8_t *buffer)> &read,
+                      const std::function<void(int i, uint8_t *buffer)> &compute,
+                      const std::function<bool(int i, const uint8_t *buffer)> &write);
+
+/**
+ * 同上，使用调用方提供的 CHAOS_PIPELINE_DEPTH 个缓冲，用于缓冲大小不是一个块的场景
+ */
+bool runBlockPipeline(int blockNum, uint8_t *const *buffers,
+                      const std::function<bool(int i, uint8_t *buffer)> &read,
+                      const std::function<void(int i, uint8_t *buffer)> &compute,
+                      const std::function<bool(int i, const uint8_t *buffer)> &write);
+
+#endif
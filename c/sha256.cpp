@@ -17,6 +17,7 @@
 #include <memory.h>
 #include "sha256.h"
 
+#include <atomic>
 #include <cstdint>
 #include <iomanip>
 #include <sstream>
@@ -46,7 +47,7 @@ static const SHA_WORD k[64] = {
 };
 
 /*********************** FUNCTION DEFINITIONS ***********************/
-void sha256_transform(SHA256_CTX *ctx, const BYTE data[])
+static void sha256_block_generic(SHA_WORD state[8], const BYTE data[])
 {
 	SHA_WORD a, b, c, d, e, f, g, h, i, j, t1, t2, m[64];
 
@@ -55,14 +56,14 @@ void sha256_transform(SHA256_CTX *ctx, const BYTE data[])
 	for ( ; i < 64; ++i)
 		m[i] = SIG1(m[i - 2]) + m[i - 7] + SIG0(m[i - 15]) + m[i - 16];
 
-	a = ctx->state[0];
-	b = ctx->state[1];
-	c = ctx->state[2];
-	d = ctx->state[3];
-	e = ctx->state[4];
-	f = ctx->state[5];
-	g = ctx->state[6];
-	h = ctx->state[7];
+	a = state[0];
+	b = state[1];
+	c = state[2];
+	d = state[3];
+	e = state[4];
+	f = state[5];
+	g = state[6];
+	h = state[7];
 
 	for (i = 0; i < 64; ++i) {
 		t1 = h + EP1(e) + CH(e,f,g) + k[i] + m[i];
@@ -77,14 +78,181 @@ void sha256_transform(SHA256_CTX *ctx, const BYTE data[])
 		a = t1 + t2;
 	}
 
-	ctx->state[0] += a;
-	ctx->state[1] += b;
-	ctx->state[2] += c;
-	ctx->state[3] += d;
-	ctx->state[4] += e;
-	ctx->state[5] += f;
-	ctx->state[6] += g;
-	ctx->state[7] += h;
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+	state[5] += f;
+	state[6] += g;
+	state[7] += h;
+}
+
+// 便携实现：逐块处理 blocks 个 64 字节块
+static void sha256_blocks_generic(SHA_WORD state[8], const BYTE data[], size_t blocks)
+{
+	for (; blocks > 0; --blocks, data += 64)
+		sha256_block_generic(state, data);
+}
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(CHAOS_NO_SIMD)
+#define SHA256_X86 1
+#include <immintrin.h>
+
+// SHA-NI：每条 sha256rnds2 完成两轮，消息扩展由 sha256msg1 / sha256msg2 完成
+__attribute__((target("sha,ssse3,sse4.1")))
+static void sha256_blocks_hw(SHA_WORD state[8], const BYTE data[], size_t blocks)
+{
+	const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	__m128i STATE0, STATE1, MSG, TMP, ABEF_SAVE, CDGH_SAVE, M[4];
+	int i;
+
+	// state 为 ABCD EFGH，指令要求 ABEF CDGH
+	TMP = _mm_loadu_si128((const __m128i *) &state[0]);
+	STATE1 = _mm_loadu_si128((const __m128i *) &state[4]);
+	TMP = _mm_shuffle_epi32(TMP, 0xB1);
+	STATE1 = _mm_shuffle_epi32(STATE1, 0x1B);
+	STATE0 = _mm_alignr_epi8(TMP, STATE1, 8);
+	STATE1 = _mm_blend_epi16(STATE1, TMP, 0xF0);
+
+	for (; blocks > 0; --blocks, data += 64) {
+		ABEF_SAVE = STATE0;
+		CDGH_SAVE = STATE1;
+		for (i = 0; i < 4; ++i)
+			M[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 16 * i)), MASK);
+		// 每组 4 轮，M 循环保存最近 16 个消息字
+		for (i = 0; i < 16; ++i) {
+			MSG = _mm_add_epi32(M[i & 3], _mm_loadu_si128((const __m128i *) &k[4 * i]));
+			STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);
+			if (i >= 3 && i <= 14) {
+				TMP = _mm_alignr_epi8(M[i & 3], M[(i - 1) & 3], 4);
+				M[(i + 1) & 3] = _mm_add_epi32(M[(i + 1) & 3], TMP);
+				M[(i + 1) & 3] = _mm_sha256msg2_epu32(M[(i + 1) & 3], M[i & 3]);
+			}
+			MSG = _mm_shuffle_epi32(MSG, 0x0E);
+			STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, MSG);
+			if (i >= 1 && i <= 12)
+				M[(i - 1) & 3] = _mm_sha256msg1_epu32(M[(i - 1) & 3], M[i & 3]);
+		}
+		STATE0 = _mm_add_epi32(STATE0, ABEF_SAVE);
+		STATE1 = _mm_add_epi32(STATE1, CDGH_SAVE);
+	}
+
+	TMP = _mm_shuffle_epi32(STATE0, 0x1B);
+	STATE1 = _mm_shuffle_epi32(STATE1, 0xB1);
+	STATE0 = _mm_blend_epi16(TMP, STATE1, 0xF0);
+	STATE1 = _mm_alignr_epi8(STATE1, TMP, 8);
+	_mm_storeu_si128((__m128i *) &state[0], STATE0);
+	_mm_storeu_si128((__m128i *) &state[4], STATE1);
+}
+
+static bool sha256_hw_supported()
+{
+	__builtin_cpu_init();
+	// GCC 的 __builtin_cpu_supports 不识别 "sha"，直接查询 CPUID.(EAX=7,ECX=0):EBX[29]
+	unsigned int eax, ebx, ecx, edx;
+	__asm__ volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0), "c"(0));
+	if (eax < 7)
+		return false;
+	__asm__ volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(7), "c"(0));
+	return (ebx & (1u << 29)) != 0 && __builtin_cpu_supports("ssse3") && __builtin_cpu_supports("sse4.1");
+}
+
+#elif defined(__aarch64__) && !defined(CHAOS_NO_SIMD)
+#define SHA256_ARM 1
+#include <arm_neon.h>
+#if defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+// SHA256 指令属于可选的加密扩展，只对该函数开启
+#if defined(__clang__)
+#define SHA256_ARM_TARGET __attribute__((target("sha2")))
+#else
+#define SHA256_ARM_TARGET __attribute__((target("+crypto")))
+#endif
+
+// ARMv8 加密扩展：sha256h / sha256h2 每条完成四轮，消息扩展由 sha256su0 / sha256su1 完成
+SHA256_ARM_TARGET
+static void sha256_blocks_hw(SHA_WORD state[8], const BYTE data[], size_t blocks)
+{
+	uint32x4_t STATE0 = vld1q_u32(&state[0]);
+	uint32x4_t STATE1 = vld1q_u32(&state[4]);
+	uint32x4_t ABEF_SAVE, CDGH_SAVE, TMP0, TMP2, M[4];
+	int i;
+
+	for (; blocks > 0; --blocks, data += 64) {
+		ABEF_SAVE = STATE0;
+		CDGH_SAVE = STATE1;
+		for (i = 0; i < 4; ++i)
+			M[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16 * i)));
+		for (i = 0; i < 16; ++i) {
+			TMP0 = vaddq_u32(M[i & 3], vld1q_u32(&k[4 * i]));
+			if (i < 12)
+				M[i & 3] = vsha256su0q_u32(M[i & 3], M[(i + 1) & 3]);
+			TMP2 = STATE0;
+			STATE0 = vsha256hq_u32(STATE0, STATE1, TMP0);
+			STATE1 = vsha256h2q_u32(STATE1, TMP2, TMP0);
+			if (i < 12)
+				M[i & 3] = vsha256su1q_u32(M[i & 3], M[(i + 2) & 3], M[(i + 3) & 3]);
+		}
+		STATE0 = vaddq_u32(STATE0, ABEF_SAVE);
+		STATE1 = vaddq_u32(STATE1, CDGH_SAVE);
+	}
+
+	vst1q_u32(&state[0], STATE0);
+	vst1q_u32(&state[4], STATE1);
+}
+
+static bool sha256_hw_supported()
+{
+#if defined(__APPLE__)
+	return true;
+#elif defined(__linux__) && defined(HWCAP_SHA2)
+	return (getauxval(AT_HWCAP) & HWCAP_SHA2) != 0;
+#else
+	return false;
+#endif
+}
+
+#endif
+
+typedef void (*SHA256_BLOCKS_FN)(SHA_WORD state[8], const BYTE data[], size_t blocks);
+
+// 是否允许使用硬件指令，见 sha256_set_hw_enabled
+static std::atomic<bool> sha256_hw_enabled(true);
+
+// CPU 能力只检测一次
+static bool sha256_hw_available()
+{
+#if defined(SHA256_X86) || defined(SHA256_ARM)
+	static const bool available = sha256_hw_supported();
+	return available;
+#else
+	return false;
+#endif
+}
+
+// 按 CPU 能力选择：x86 SHA-NI、ARMv8 SHA256 指令，否则使用便携实现
+static SHA256_BLOCKS_FN sha256_blocks_impl()
+{
+#if defined(SHA256_X86) || defined(SHA256_ARM)
+	if (sha256_hw_enabled.load(std::memory_order_relaxed) && sha256_hw_available())
+		return sha256_blocks_hw;
+#endif
+	return sha256_blocks_generic;
+}
+
+bool sha256_set_hw_enabled(bool enable)
+{
+	sha256_hw_enabled = enable;
+	return enable && sha256_hw_available();
+}
+
+void sha256_transform(SHA256_CTX *ctx, const BYTE data[])
+{
+	sha256_blocks_impl()(ctx->state, data, 1);
 }
 
 void sha256_init(SHA256_CTX *ctx)
@@ -103,17 +271,33 @@ void sha256_init(SHA256_CTX *ctx)
 
 void sha256_update(SHA256_CTX *ctx, const BYTE data[], size_t len)
 {
-	SHA_WORD i;
+	size_t n, blocks;
 
-	for (i = 0; i < len; ++i) {
-		ctx->data[ctx->datalen] = data[i];
-		ctx->datalen++;
-		if (ctx->datalen == 64) {
-			sha256_transform(ctx, ctx->data);
-			ctx->bitlen += 512;
-			ctx->datalen = 0;
-		}
+	// 先补满上次剩下的不完整块
+	if (ctx->datalen > 0) {
+		n = 64 - ctx->datalen < len ? 64 - ctx->datalen : len;
+		memcpy(ctx->data + ctx->datalen, data, n);
+		ctx->datalen += (SHA_WORD) n;
+		data += n;
+		len -= n;
+		if (ctx->datalen < 64)
+			return;
+		sha256_transform(ctx, ctx->data);
+		ctx->bitlen += 512;
+		ctx->datalen = 0;
 	}
+
+	// 完整的块直接从输入处理，不再逐字节复制到 ctx->data
+	blocks = len / 64;
+	if (blocks > 0) {
+		sha256_blocks_impl()(ctx->state, data, blocks);
+		ctx->bitlen += 512ULL * blocks;
+		data += 64 * blocks;
+		len -= 64 * blocks;
+	}
+
+	memcpy(ctx->data, data, len);
+	ctx->datalen = (SHA_WORD) len;
 }
 
 void sha256_final(SHA256_CTX *ctx, BYTE hash[])
@@ -162,18 +346,26 @@ void sha256_final(SHA256_CTX *ctx, BYTE hash[])
 	}
 }
 
-std::string sha256_hash(const std::string& input) {
-    uint8_t hash[32];
+void sha256_digest(const void *data, size_t len, BYTE hash[SHA256_BLOCK_SIZE]) {
     SHA256_CTX ctx;
 
     sha256_init(&ctx);
-    sha256_update(&ctx, reinterpret_cast<const uint8_t*>(input.c_str()), input.size());
+    sha256_update(&ctx, static_cast<const BYTE *>(data), len);
     sha256_final(&ctx, hash);
+}
 
-    // 转换为十六进制字符串
-    std::ostringstream oss;
-    for (int i = 0; i < 32; ++i)
-        oss << std::hex << std::setw(2) << std::setfill('0') << (int)hash[i];
+std::string sha256_to_hex(const BYTE hash[SHA256_BLOCK_SIZE]) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex(2 * SHA256_BLOCK_SIZE, '0');
+    for (int i = 0; i < SHA256_BLOCK_SIZE; ++i) {
+        hex[2 * i] = digits[hash[i] >> 4];
+        hex[2 * i + 1] = digits[hash[i] & 15];
+    }
+    return hex;
+}
 
-    return oss.str();
+std::string sha256_hash(const std::string& input) {
+    BYTE hash[SHA256_BLOCK_SIZE];
+    sha256_digest(input.data(), input.size(), hash);
+    return sha256_to_hex(hash);
 }
@@ -35,7 +35,16 @@ void sha256_init(SHA256_CTX *ctx);
 void sha256_update(SHA256_CTX *ctx, const BYTE data[], size_t len);
 void sha256_final(SHA256_CTX *ctx, BYTE hash[]);
 
-// 获取字符串的 SHA-256值
+// 计算 data 的 SHA-256 摘要（二进制，SHA256_BLOCK_SIZE 字节）
+void sha256_digest(const void *data, size_t len, BYTE hash[SHA256_BLOCK_SIZE]);
+
+// 摘要转小写十六进制字符串
+std::string sha256_to_hex(const BYTE hash[SHA256_BLOCK_SIZE]);
+
+// 获取字符串的 SHA-256值（十六进制）
 std::string sha256_hash(const std::string& input);
 
+// 允许（默认）或禁止使用 SHA-NI / ARMv8 SHA256 指令，禁止时使用便携实现；返回之后是否使用硬件指令
+bool sha256_set_hw_enabled(bool enable);
+
 #endif   // SHA256_H
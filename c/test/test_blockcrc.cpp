@@ -0,0 +1,100 @@
+// 块校验表：表的内容与位置、verifyFile_OMP，以及单线程、多线程解密对截断与损坏的密文的处理
+#include <cstring>
+#include "chaos.h"
+#include "test_util.h"
+
+static const std::string KEY = "block-crc-test-key";
+
+// 单线程与多线程解密都必须失败，且不留下部分解密的内容
+static void checkRejected(const std::string &cipher, const std::string &what) {
+    writeFile("blockcrc_bad.lzu", cipher);
+    writeFile("blockcrc_out.bin", "stale");
+    CHECK_MSG(decryptFileWithKey(KEY, "blockcrc_bad.lzu", "blockcrc_out.bin").success == 0, what + " st");
+    for (int threads: {1, 4}) {
+        std::string msg = what + " threads " + std::to_string(threads);
+        CHECK_MSG(decryptFileWithKey_OMP(threads, KEY, "blockcrc_bad.lzu", "blockcrc_out.bin").success == 0, msg);
+        CHECK_MSG(readFile("blockcrc_out.bin").empty(), msg + " left output behind");
+    }
+    CHECK_MSG(verifyFile_OMP(4, "blockcrc_bad.lzu").success == 0, what + " verify");
+}
+
+// 表中每一项是对应块密文有效部分（尾块不含填充）的 CRC32，4 字节小端，紧跟在密文数据之后
+static void checkTable(const std::string &cipher, uint64_t plainLength) {
+    CHAOS_FILE_HEADER header;
+    CHECK(parseFileHeader((const uint8_t *) cipher.data(), cipher.size(), header));
+    CHECK(header.flags & CHAOS_FILE_FLAG_BLOCK_CRC);
+    std::vector<int> blocks = splitFileBlocks(plainLength, header.flags);
+    int blockNum = (int) blocks.size() / 2;
+    CHECK(blockCrcTableSize(plainLength, header.flags) == 4 * (uint64_t) blockNum);
+    CHECK(cipher.size() == header.crcTableOffset + 4 * (uint64_t) blockNum);
+    const uint8_t *data = (const uint8_t *) cipher.data() + header.dataOffset;
+    const uint8_t *table = (const uint8_t *) cipher.data() + header.crcTableOffset;
+    std::vector<uint32_t> crcs(blockNum);
+    decodeBlockCrcTable(table, crcs);
+    uint64_t offset = 0;
+    for (int i = 0; i < blockNum; i++) {
+        uint64_t realSize = std::min((uint64_t) blocks[2 * i], plainLength - offset);
+        uint32_t crc = blockCrc32(data + offset, realSize);
+        CHECK_MSG(crcs[i] == crc, "block " + std::to_string(i));
+        uint32_t stored = table[4 * i] | (table[4 * i + 1] << 8) | (table[4 * i + 2] << 16) |
+                          ((uint32_t) table[4 * i + 3] << 24);
+        CHECK_MSG(stored == crc, "little-endian block " + std::to_string(i));
+        offset += realSize;
+    }
+    CHECK(offset == plainLength);
+    // 编码与解码互逆
+    std::vector<uint8_t> encoded(4 * crcs.size());
+    encodeBlockCrcTable(crcs, encoded.data());
+    CHECK(memcmp(encoded.data(), table, encoded.size()) == 0);
+}
+
+int main() {
+    // 至少 4 个整块加一个不满的尾块
+    uint64_t plainLength = 4 * 1024 * 1024 + 54321;
+    std::vector<uint8_t> plain = testBytes(plainLength, 11);
+    writeFile("blockcrc_plain.bin", plain.data(), plain.size());
+    CHECK(encryptFileWithKey_OMP(4, KEY, "blockcrc_plain.bin", "blockcrc.lzu").success == 1);
+    std::string cipher = readFile("blockcrc.lzu");
+    checkTable(cipher, plainLength);
+    CHECK(verifyFile_OMP(4, "blockcrc.lzu").success == 1);
+    CHECK(verifyFile_OMP(1, "blockcrc.lzu").success == 1);
+
+    CHAOS_FILE_HEADER header;
+    parseFileHeader((const uint8_t *) cipher.data(), cipher.size(), header);
+    std::vector<int> blocks = splitFileBlocks(plainLength, header.flags);
+    // 损坏第 2 块：verifyFile_OMP 报告块序号
+    std::string corrupted = cipher;
+    uint64_t block2 = header.dataOffset + (uint64_t) blocks[0] + blocks[2] + 100;
+    corrupted[block2] ^= 0x40;
+    writeFile("blockcrc_bad.lzu", corrupted);
+    CHAOS_OPERATION_RESULT verify = verifyFile_OMP(4, "blockcrc_bad.lzu");
+    CHECK(verify.success == 0 && verify.result == "2");
+    checkRejected(corrupted, "corrupted block 2");
+    // 损坏尾块的最后一个有效字节
+    corrupted = cipher;
+    corrupted[header.crcTableOffset - 1] ^= 1;
+    checkRejected(corrupted, "corrupted last byte");
+    // 损坏校验表本身
+    corrupted = cipher;
+    corrupted[cipher.size() - 1] ^= 1;
+    checkRejected(corrupted, "corrupted table");
+
+    // 在校验表中、密文数据中、文件头中截断
+    const uint64_t cuts[] = {cipher.size() - 1, header.crcTableOffset, header.crcTableOffset - 1000,
+                             header.dataOffset + 10, 40};
+    for (uint64_t cut: cuts) {
+        checkRejected(cipher.substr(0, cut), "truncated at " + std::to_string(cut));
+    }
+
+    // 空文件没有块，也没有校验表
+    writeFile("blockcrc_plain.bin", "");
+    CHECK(encryptFileWithKey_OMP(4, KEY, "blockcrc_plain.bin", "blockcrc.lzu").success == 1);
+    CHECK(readFile("blockcrc.lzu").size() == CHAOS_FILE_HEADER_SIZE);
+    CHECK(verifyFile_OMP(4, "blockcrc.lzu").success == 1);
+    CHECK(decryptFileWithKey_OMP(4, KEY, "blockcrc.lzu", "blockcrc_out.bin").success == 1);
+    CHECK(readFile("blockcrc_out.bin").empty());
+
+    // v1 密文没有校验表，无法校验
+    CHECK(verifyFile_OMP(4, std::string(CHAOS_TEST_DATA_DIR) + "/v1_70000.lzu").success == 0);
+    return testResult("blockcrc");
+}
@@ -0,0 +1,254 @@
+// native_lib 的字符串导出函数：*_bytes 版本在明文含 NUL 字节时按长度传入、按 out_len 取回，不被截断；
+// 原有的以 NUL 结尾的版本保持原来的签名，与 *_bytes 版本的结果相同；批量接口的 arena 布局与逐条结果
+#include <cstdlib>
+#include <cstring>
+#include "chaos.h"
+#include "test_util.h"
+
+extern "C" {
+char *encrypt_string(char *key, char *input);
+char *decrypt_string(char *key, char *input);
+char *encrypt_string_format(char *key, char *input, int format, uint64_t *out_len);
+char *decrypt_string_format(char *key, char *input, uint64_t input_len, int format);
+char *encrypt_string_bytes(char *key, char *input, uint64_t input_len);
+char *decrypt_string_bytes(char *key, char *input, uint64_t *out_len);
+char *encrypt_string_format_bytes(char *key, char *input, uint64_t input_len, int format, uint64_t *out_len);
+char *decrypt_string_format_bytes(char *key, char *input, uint64_t input_len, int format, uint64_t *out_len);
+char *open_key_handle(char *key);
+int close_key_handle(int handle);
+char *encrypt_string_with_handle(int handle, char *input);
+char *decrypt_string_with_handle(int handle, char *input);
+char *encrypt_string_with_handle_bytes(int handle, char *input, uint64_t input_len);
+char *decrypt_string_with_handle_bytes(int handle, char *input, uint64_t *out_len);
+char *encrypt_string_batch(int threads, char *key, const char **inputs, const uint64_t *lengths, int count,
+                           int format, uint64_t *offsets, uint8_t *status);
+char *decrypt_string_batch(int threads, char *key, const char **inputs, const uint64_t *lengths, int count,
+                           int format, uint64_t *offsets, uint8_t *status);
+char *encrypt_string_batch_with_handle(int threads, int handle, const char **inputs, const uint64_t *lengths,
+                                       int count, int format, uint64_t *offsets, uint8_t *status);
+char *decrypt_string_batch_with_handle(int threads, int handle, const char **inputs, const uint64_t *lengths,
+                                       int count, int format, uint64_t *offsets, uint8_t *status);
+void free_memory(void *ptr);
+}
+
+static char KEY[] = "ffi-test-key-123";
+
+// 取回导出函数返回的缓冲并释放；len 在函数返回之后才被写入，因此按指针读取
+static std::string take(char *buffer, const uint64_t *len) {
+    if (buffer == nullptr) {
+        return "<null>";
+    }
+    std::string value(buffer, *len);
+    free_memory(buffer);
+    return value;
+}
+
+static void checkMessage(const std::string &plain) {
+    std::string what = "length " + std::to_string(plain.size());
+    std::string input = plain;
+    uint64_t len = 0;
+    char *hex = encrypt_string_bytes(KEY, &input[0], input.size());
+    CHECK_MSG(hex != nullptr, what);
+    if (hex != nullptr) {
+        CHECK_MSG(take(decrypt_string_bytes(KEY, hex, &len), &len) == plain, what + " hex");
+        free_memory(hex);
+    }
+    const int formats[] = {CHAOS_STR_HEX, CHAOS_STR_BINARY, CHAOS_STR_BASE64, CHAOS_STR_BINARY | CHAOS_STR_WARM_ONCE};
+    for (int format: formats) {
+        uint64_t cipherLen = 0;
+        std::string cipher = take(encrypt_string_format_bytes(KEY, &input[0], input.size(), format, &cipherLen),
+                                  &cipherLen);
+        CHECK_MSG(cipher != "<null>", what + " format " + std::to_string(format));
+        CHECK_MSG(take(decrypt_string_format_bytes(KEY, &cipher[0], cipher.size(), format, &len), &len) == plain,
+                  what + " format " + std::to_string(format));
+    }
+    char *opened = open_key_handle(KEY);
+    int handle = atoi(opened + strlen("SUCCESS|"));
+    free_memory(opened);
+    hex = encrypt_string_with_handle_bytes(handle, &input[0], input.size());
+    CHECK_MSG(hex != nullptr, what + " handle");
+    if (hex != nullptr) {
+        CHECK_MSG(take(decrypt_string_with_handle_bytes(handle, hex, &len), &len) == plain, what + " handle");
+        free_memory(hex);
+    }
+    close_key_handle(handle);
+}
+
+// 原有的 NUL 结尾接口：签名不变，对不含 NUL 的文本与 *_bytes 版本结果相同
+static void checkTextMessage(const std::string &plain) {
+    std::string input = plain;
+    uint64_t len = 0;
+    char *hex = encrypt_string(KEY, &input[0]);
+    char *hexBytes = encrypt_string_bytes(KEY, &input[0], input.size());
+    CHECK(hex != nullptr && hexBytes != nullptr && strcmp(hex, hexBytes) == 0);
+    free_memory(hexBytes);
+    if (hex != nullptr) {
+        char *decrypted = decrypt_string(KEY, hex);
+        CHECK(decrypted != nullptr && plain == decrypted);
+        free_memory(decrypted);
+        free_memory(hex);
+    }
+    for (int format: {CHAOS_STR_BINARY, CHAOS_STR_BASE64}) {
+        uint64_t cipherLen = 0;
+        std::string cipher = take(encrypt_string_format(KEY, &input[0], format, &cipherLen), &cipherLen);
+        CHECK(cipher == take(encrypt_string_format_bytes(KEY, &input[0], input.size(), format, &len), &len));
+        char *decrypted = decrypt_string_format(KEY, &cipher[0], cipher.size(), format);
+        CHECK_MSG(decrypted != nullptr && plain == decrypted, "format " + std::to_string(format));
+        free_memory(decrypted);
+    }
+    char *opened = open_key_handle(KEY);
+    int handle = atoi(opened + strlen("SUCCESS|"));
+    free_memory(opened);
+    hex = encrypt_string_with_handle(handle, &input[0]);
+    CHECK(hex != nullptr);
+    if (hex != nullptr) {
+        char *decrypted = decrypt_string_with_handle(handle, hex);
+        CHECK(decrypted != nullptr && plain == decrypted);
+        free_memory(decrypted);
+        free_memory(hex);
+    }
+    close_key_handle(handle);
+}
+
+// 一次批量调用的结果：arena 按 offsets 拆回各条
+struct BATCH_OUTPUT {
+    std::vector<std::string> messages;
+    std::vector<uint8_t> status;
+};
+
+// handle 为负时用密钥版本
+static bool runBatch(int threads, int handle, const std::vector<std::string> &inputs, int format, bool decrypt,
+                     BATCH_OUTPUT &out) {
+    int count = (int) inputs.size();
+    std::vector<const char *> pointers(count);
+    std::vector<uint64_t> lengths(count);
+    for (int i = 0; i < count; i++) {
+        pointers[i] = inputs[i].data();
+        lengths[i] = inputs[i].size();
+    }
+    std::vector<uint64_t> offsets(count + 1, ~0ull);
+    out.status.assign(count, 2);
+    char *arena;
+    if (handle >= 0) {
+        arena = decrypt ? decrypt_string_batch_with_handle(threads, handle, pointers.data(), lengths.data(), count,
+                                                           format, offsets.data(), out.status.data())
+                        : encrypt_string_batch_with_handle(threads, handle, pointers.data(), lengths.data(), count,
+                                                           format, offsets.data(), out.status.data());
+    } else {
+        arena = decrypt ? decrypt_string_batch(threads, KEY, pointers.data(), lengths.data(), count, format,
+                                               offsets.data(), out.status.data())
+                        : encrypt_string_batch(threads, KEY, pointers.data(), lengths.data(), count, format,
+                                               offsets.data(), out.status.data());
+    }
+    if (arena == nullptr) {
+        return false;
+    }
+    // offsets 从 0 开始单调不减，未失败的条目紧密相接
+    bool ok = offsets[0] == 0;
+    out.messages.assign(count, "");
+    for (int i = 0; i < count && ok; i++) {
+        ok = offsets[i] <= offsets[i + 1];
+        if (ok) {
+            out.messages[i].assign(arena + offsets[i], offsets[i + 1] - offsets[i]);
+        }
+    }
+    // 与 string_to_buffer 一致，arena 末尾有 NUL
+    ok = ok && arena[offsets[count]] == '\0';
+    free_memory(arena);
+    return ok;
+}
+
+// 把密文改掉一个字符，仍在该格式的字符集内，使校验失败
+static std::string corrupt(const std::string &cipher, int format) {
+    std::string bad = cipher;
+    char &c = bad[bad.size() / 2];
+    if ((format & ~CHAOS_STR_WARM_ONCE) == CHAOS_STR_BINARY) {
+        c ^= 0x01;
+    } else {
+        c = c == 'A' ? 'B' : 'A';
+    }
+    return bad;
+}
+
+// 批量接口：几千条长度不一（含空消息与含 NUL 的消息）的明文，每种格式、多种线程数，
+// 每条结果与 encrypt_string_format_bytes 单独加密相同，并能经 decrypt_string_batch 还原
+static void checkBatch() {
+    const int count = 3000;
+    std::vector<std::string> plains(count);
+    for (int i = 0; i < count; i++) {
+        // 大多是短消息，间或有空消息与跨多个块的长消息
+        size_t len = i % 97 == 0 ? 0 : i % 211 == 0 ? 5000 + i : (size_t) (i * 7919) % 300 + 1;
+        std::vector<uint8_t> bytes = testBytes(len, 1000 + i);
+        plains[i].assign(bytes.begin(), bytes.end());
+    }
+    plains[1] = std::string("\0\0a\0", 4);
+
+    char *opened = open_key_handle(KEY);
+    int handle = atoi(opened + strlen("SUCCESS|"));
+    free_memory(opened);
+    const int formats[] = {CHAOS_STR_HEX, CHAOS_STR_BINARY, CHAOS_STR_BASE64, CHAOS_STR_BINARY | CHAOS_STR_WARM_ONCE,
+                           CHAOS_STR_BASE64 | CHAOS_STR_WARM_ONCE};
+    for (int format: formats) {
+        // 单条加密的结果，空消息加密失败
+        std::vector<std::string> expect(count);
+        for (int i = 0; i < count; i++) {
+            uint64_t len = 0;
+            char *one = encrypt_string_format_bytes(KEY, &plains[i][0], plains[i].size(), format, &len);
+            CHECK_MSG((one == nullptr) == plains[i].empty(), "single message " + std::to_string(i));
+            if (one != nullptr) {
+                expect[i].assign(one, len);
+                free_memory(one);
+            }
+        }
+        for (int threads: {1, 3, 8}) {
+            for (int useHandle = 0; useHandle < 2; useHandle++) {
+                std::string what = "format " + std::to_string(format) + " threads " + std::to_string(threads) +
+                                   (useHandle ? " handle" : " key");
+                int h = useHandle ? handle : -1;
+                BATCH_OUTPUT encrypted;
+                CHECK_MSG(runBatch(threads, h, plains, format, false, encrypted), what + " encrypt");
+                if (encrypted.messages.size() != (size_t) count) {
+                    continue;
+                }
+                for (int i = 0; i < count; i++) {
+                    CHECK_MSG(encrypted.status[i] == (plains[i].empty() ? 0 : 1), what + " status " + std::to_string(i));
+                    CHECK_MSG(encrypted.messages[i] == expect[i], what + " message " + std::to_string(i));
+                }
+
+                // 解密：原样的密文、空密文与被改动的密文
+                std::vector<std::string> ciphers = encrypted.messages;
+                for (int i = 5; i < count; i += 101) {
+                    ciphers[i] = corrupt(ciphers[i], format);
+                }
+                BATCH_OUTPUT decrypted;
+                CHECK_MSG(runBatch(threads, h, ciphers, format, true, decrypted), what + " decrypt");
+                if (decrypted.messages.size() != (size_t) count) {
+                    continue;
+                }
+                for (int i = 0; i < count; i++) {
+                    bool bad = plains[i].empty() || (i >= 5 && (i - 5) % 101 == 0);
+                    std::string msg = what + " decrypt " + std::to_string(i);
+                    CHECK_MSG(decrypted.status[i] == (bad ? 0 : 1), msg + " status");
+                    CHECK_MSG(decrypted.messages[i] == (bad ? "" : plains[i]), msg);
+                }
+            }
+        }
+    }
+    close_key_handle(handle);
+
+    // 空批次：只有 offsets[0]
+    uint64_t offset = ~0ull;
+    char *empty = encrypt_string_batch(2, KEY, nullptr, nullptr, 0, CHAOS_STR_HEX, &offset, nullptr);
+    CHECK(empty != nullptr && offset == 0);
+    free_memory(empty);
+}
+
+int main() {
+    checkTextMessage("hello, chaos");
+    checkMessage(std::string(1, '\0'));
+    checkMessage(std::string("ab\0cd\0", 6));
+    std::vector<uint8_t> binary = testBytes(5000, 21);
+    checkMessage(std::string(binary.begin(), binary.end()));
+    checkBatch();
+    return testResult("ffi");
+}
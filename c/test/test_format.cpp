@@ -0,0 +1,134 @@
+// 文件格式：v2 文件头的字段布局与校验、v1 长度前缀的解析，以及解密旧版本生成的 v1 密文
+#include <cstring>
+#include "chaos.h"
+#include "test_util.h"
+
+// data/v1_<长度>.lzu 由 v2 之前的版本（单线程 encryptFileWithKey）生成，明文为 testBytes(长度, V1_SEED)。
+// 旧版多线程输出随线程数变化，不是稳定的格式，因此只保留单线程的输出
+static const std::string V1_KEY = "fixture-key-v1";
+static const uint64_t V1_SEED = 2024;
+
+static uint64_t little(const uint8_t *data, int bytes) {
+    uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+static void checkHeaderLayout() {
+    uint8_t out[CHAOS_FILE_HEADER_SIZE];
+    uint64_t plainLength = 0x123456789Aull;
+    int flags = CHAOS_FILE_FLAG_BLOCK_CRC | CHAOS_FILE_FLAG_RECT_BLOCKS;
+    writeFileHeader(plainLength, flags, CHAOS_MAP_FIXED, out);
+    CHECK(memcmp(out, CHAOS_FILE_MAGIC, 8) == 0);
+    CHECK(little(out + 8, 2) == CHAOS_FILE_VERSION);
+    CHECK(little(out + 10, 2) == CHAOS_FILE_HEADER_SIZE);
+    CHECK(little(out + 12, 2) == CHAOS_MAP_FIXED);
+    CHECK(little(out + 14, 2) == (uint64_t) flags);
+    CHECK(little(out + 16, 2) == MAX_BLOCKROW);
+    CHECK(little(out + 18, 2) == MAX_BLOCKCOL);
+    CHECK(little(out + 20, 4) == 0);
+    CHECK(little(out + 24, 8) == plainLength);
+    for (int i = 32; i < CHAOS_FILE_HEADER_SIZE; i++) {
+        CHECK(out[i] == 0);
+    }
+
+    CHAOS_FILE_HEADER header;
+    CHECK(parseFileHeader(out, sizeof(out), header));
+    CHECK(header.version == CHAOS_FILE_VERSION);
+    CHECK(header.dataOffset == CHAOS_FILE_HEADER_SIZE);
+    CHECK(header.mapId == CHAOS_MAP_FIXED);
+    CHECK(header.flags == flags);
+    CHECK(header.plainLength == plainLength);
+    CHECK(header.crcTableOffset == CHAOS_FILE_HEADER_SIZE + plainLength);
+    // 没有块校验表
+    writeFileHeader(10, 0, CHAOS_MAP_3D, out);
+    CHECK(parseFileHeader(out, sizeof(out), header) && header.crcTableOffset == 0);
+}
+
+// 版本、映射、标志、分块或长度不被支持的文件头一律拒绝
+static void checkHeaderRejects() {
+    uint8_t good[CHAOS_FILE_HEADER_SIZE];
+    writeFileHeader(1000, CHAOS_FILE_FLAG_BLOCK_CRC, CHAOS_MAP_3D, good);
+    CHAOS_FILE_HEADER header;
+    CHECK(!parseFileHeader(good, 31, header));
+    const struct {
+        int offset;
+        uint8_t value;
+    } patches[] = {
+            {0, 'X'},           // magic，且不是 v1 的十六进制前缀
+            {8, 3},             // 版本过新
+            {10, 32},           // headerSize 小于 v2
+            {12, 7},            // 未知映射
+            {14, 0x10},         // 未知标志
+            {15, 0x01},         // 未知标志（高字节）
+            {17, 0x02},         // 分块行数不是 MAX_BLOCKROW
+    };
+    for (const auto &patch: patches) {
+        uint8_t bad[CHAOS_FILE_HEADER_SIZE];
+        memcpy(bad, good, sizeof(bad));
+        bad[patch.offset] = patch.value;
+        CHECK_MSG(!parseFileHeader(bad, sizeof(bad), header), "offset " + std::to_string(patch.offset));
+    }
+}
+
+// v1：2 位十六进制的位数 + 位数 / 4 位十六进制的明文长度
+static void checkV1Prefix() {
+    CHAOS_FILE_HEADER header;
+    const char *small = "0805";
+    CHECK(parseFileHeader((const uint8_t *) small, 4, header));
+    CHECK(header.version == 1 && header.dataOffset == 4 && header.plainLength == 5 && header.crcTableOffset == 0);
+    // 超过 2GB 的长度逐位解析，不会溢出
+    const char *large = "40000000123456789a";
+    CHECK(parseFileHeader((const uint8_t *) large, 18, header));
+    CHECK(header.dataOffset == 18 && header.plainLength == 0x123456789Aull);
+    // 位数不是 8 的倍数、非十六进制数字、前缀被截断
+    CHECK(!parseFileHeader((const uint8_t *) "0705", 4, header));
+    CHECK(!parseFileHeader((const uint8_t *) "08g5", 4, header));
+    CHECK(!parseFileHeader((const uint8_t *) "1001", 4, header));
+}
+
+// 新加密的文件带 v2 文件头，单线程与多线程输出相同
+static void checkNewFile() {
+    std::vector<uint8_t> plain = testBytes(1234567, 5);
+    std::string plainStr(plain.begin(), plain.end());
+    writeFile("format_plain.bin", plainStr);
+    CHECK(encryptFileWithKey("format-test-key", "format_plain.bin", "format_st.lzu").success == 1);
+    CHECK(encryptFileWithKey_OMP(3, "format-test-key", "format_plain.bin", "format_mt.lzu").success == 1);
+    std::string st = readFile("format_st.lzu");
+    CHECK(st == readFile("format_mt.lzu"));
+    CHAOS_FILE_HEADER header;
+    CHECK(parseFileHeader((const uint8_t *) st.data(), st.size(), header));
+    CHECK(header.version == CHAOS_FILE_VERSION && header.plainLength == plain.size());
+    CHECK(header.flags == newFileFlags() && header.mapId == getFileMapId());
+    CHECK(st.size() == CHAOS_FILE_HEADER_SIZE + plain.size() + blockCrcTableSize(plain.size(), header.flags));
+    CHECK(decryptFileWithKey("format-test-key", "format_st.lzu", "format_dec.bin").success == 1);
+    CHECK(readFile("format_dec.bin") == plainStr);
+}
+
+// 旧版本生成的 v1 密文：单线程与多线程（任意线程数）都能解密
+static void checkV1Fixtures() {
+    for (size_t len: {(size_t) 70000, (size_t) 5}) {
+        std::string path = std::string(CHAOS_TEST_DATA_DIR) + "/v1_" + std::to_string(len) + ".lzu";
+        std::vector<uint8_t> expect = testBytes(len, V1_SEED);
+        std::string expectStr(expect.begin(), expect.end());
+        std::string what = "v1 fixture " + std::to_string(len);
+        CHECK_MSG(!readFile(path).empty(), what + " missing");
+        CHECK_MSG(decryptFileWithKey(V1_KEY, path, "format_v1.bin").success == 1, what);
+        CHECK_MSG(readFile("format_v1.bin") == expectStr, what);
+        for (int threads: {1, 4}) {
+            CHECK_MSG(decryptFileWithKey_OMP(threads, V1_KEY, path, "format_v1.bin").success == 1, what);
+            CHECK_MSG(readFile("format_v1.bin") == expectStr, what + " threads " + std::to_string(threads));
+        }
+    }
+}
+
+int main() {
+    checkHeaderLayout();
+    checkHeaderRejects();
+    checkV1Prefix();
+    checkNewFile();
+    checkV1Fixtures();
+    return testResult("format");
+}
@@ -0,0 +1,95 @@
+// CRC32 与 SHA-256 的已知答案测试，硬件路径（CPU 支持时）与便携路径各跑一遍
+#include <cstring>
+#include "chaos.h"
+#include "crc32.h"
+#include "sha256.h"
+#include "test_util.h"
+
+static uint32_t crcOf(const void *data, size_t len) {
+    return blockCrc32((const uint8_t *) data, len);
+}
+
+static std::string sha256Hex(const void *data, size_t len) {
+    BYTE digest[SHA256_BLOCK_SIZE];
+    sha256_digest(data, len, digest);
+    return sha256_to_hex(digest);
+}
+
+// path 为 "hardware" 或 "portable"；reference 为便携路径的结果，用于比较两条路径
+static void checkCrc32(const std::string &path, std::vector<uint32_t> &reference) {
+    CHECK_MSG(crcOf("123456789", 9) == 0xCBF43926u, path);
+    CHECK_MSG(crcOf("", 0) == 0, path);
+    CRC32 crc32;
+    CHECK_MSG(crc32("123456789", 9) == "cbf43926", path);
+    CHECK_MSG(calculateCRC32("123456789") == "cbf43926", path);
+    // 超过并行阈值的输入分段计算后合并
+    std::vector<uint8_t> big = testBytes(40 * 1024 * 1024 + 3, 7);
+    CHECK_MSG(bufferCrc32(big.data(), big.size()) == crcOf(big.data(), big.size()), path + " parallel");
+
+    // 各种长度与起始偏移，覆盖折叠主循环与尾部
+    std::vector<uint8_t> data = testBytes(4096 + 16, 8);
+    std::vector<uint32_t> results;
+    for (size_t len = 0; len <= 1100; len += (len < 300 ? 1 : 37)) {
+        for (int offset = 0; offset < 4; offset++) {
+            results.push_back(crcOf(data.data() + offset, len));
+        }
+    }
+    results.push_back(crcOf(data.data(), data.size()));
+    if (reference.empty()) {
+        reference = results;
+    } else {
+        CHECK_MSG(results == reference, path + " differs from portable");
+    }
+
+    // combine(crc(A), crc(B), |B|) == crc(A + B)，包括空的 A、B
+    const size_t splits[] = {0, 1, 15, 16, 63, 64, 1000, 4095, data.size()};
+    uint32_t whole = crcOf(data.data(), data.size());
+    for (size_t split: splits) {
+        uint32_t a = crcOf(data.data(), split);
+        uint32_t b = crcOf(data.data() + split, data.size() - split);
+        CHECK_MSG(CRC32::combine(a, b, data.size() - split) == whole, path + " combine at " + std::to_string(split));
+        CRC32 head, tail;
+        head.add(data.data(), split);
+        tail.add(data.data() + split, data.size() - split);
+        head.addHash(tail, data.size() - split);
+        CHECK_MSG(head.getHash() == crc32(data.data(), data.size()), path + " addHash at " + std::to_string(split));
+    }
+}
+
+static void checkSha256(const std::string &path) {
+    CHECK_MSG(sha256Hex("", 0) == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855", path);
+    CHECK_MSG(sha256Hex("abc", 3) == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", path);
+    const char *twoBlocks = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    CHECK_MSG(sha256Hex(twoBlocks, strlen(twoBlocks)) ==
+              "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1", path);
+    CHECK_MSG(sha256_hash("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", path);
+    // 一百万个 'a'，分别一次性与按不规则的片段更新
+    std::string million(1000000, 'a');
+    const std::string expect = "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0";
+    CHECK_MSG(sha256Hex(million.data(), million.size()) == expect, path);
+    SHA256_CTX ctx;
+    sha256_init(&ctx);
+    size_t done = 0;
+    for (size_t step = 1; done < million.size(); step = step * 3 % 257 + 1) {
+        size_t n = std::min(step, million.size() - done);
+        sha256_update(&ctx, (const BYTE *) million.data() + done, n);
+        done += n;
+    }
+    BYTE digest[SHA256_BLOCK_SIZE];
+    sha256_final(&ctx, digest);
+    CHECK_MSG(sha256_to_hex(digest) == expect, path + " incremental");
+}
+
+int main() {
+    std::vector<uint32_t> reference;
+    CHECK(!CRC32::setHardwareEnabled(false));
+    CHECK(!sha256_set_hw_enabled(false));
+    checkCrc32("portable", reference);
+    checkSha256("portable");
+    bool crcHardware = CRC32::setHardwareEnabled(true);
+    bool shaHardware = sha256_set_hw_enabled(true);
+    checkCrc32(crcHardware ? "hardware" : "default", reference);
+    checkSha256(shaHardware ? "hardware" : "default");
+    printf("crc32 hardware: %s, sha256 hardware: %s\n", crcHardware ? "yes" : "no", shaHardware ? "yes" : "no");
+    return testResult("hash");
+}
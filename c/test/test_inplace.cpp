@@ -0,0 +1,135 @@
+// 原地文件加解密：与复制模式的密文一致、拒绝错误密钥与损坏的密文、加解密中断后的恢复
+#include <cstring>
+#include "chaos.h"
+#include "test_util.h"
+
+static const std::string KEY = "inplace-test-key";
+static const std::string PATH = "inplace.bin";
+
+// 把文件尾的 state 字节改为 state，模拟在对应阶段中断
+static void setTrailerState(const std::string &path, int state) {
+    std::string data = readFile(path);
+    data[data.size() - CHAOS_INPLACE_TRAILER_SIZE + 4] = (char) state;
+    writeFile(path, data);
+}
+
+// 原地密文去掉文件尾后，与相同设置下复制模式输出的密文数据相同
+static void checkMatchesCopyMode(const std::vector<uint8_t> &plain, const std::string &what) {
+    writeFile(PATH, plain.data(), plain.size());
+    writeFile("inplace_copy.bin", plain.data(), plain.size());
+    CHECK_MSG(encryptFileInPlace_OMP(4, KEY, PATH).success == 1, what);
+    CHECK_MSG(encryptFileWithKey_OMP(4, KEY, "inplace_copy.bin", "inplace_copy.enc").success == 1, what);
+    std::string inPlace = readFile(PATH);
+    std::string copy = readFile("inplace_copy.enc");
+    CHECK_MSG(inPlace.size() == plain.size() + CHAOS_INPLACE_TRAILER_SIZE, what);
+    CHECK_MSG(copy.compare(CHAOS_FILE_HEADER_SIZE, plain.size(), inPlace, 0, plain.size()) == 0, what);
+    CHECK_MSG(decryptFileInPlace_OMP(4, KEY, PATH).success == 1, what);
+    CHECK_MSG(readFile(PATH) == std::string(plain.begin(), plain.end()), what);
+}
+
+static void checkSettings() {
+    std::vector<uint8_t> plain = testBytes(3 * 1024 * 1024 + 12345, 1);
+    checkMatchesCopyMode(plain, "default");
+    setFileBlockSeed(true);
+    checkMatchesCopyMode(plain, "block seed");
+    setFileBlockSeed(false);
+    setFileWarmOnce(true);
+    setFileRectBlocks(true);
+    checkMatchesCopyMode(plain, "warm once + rect blocks");
+    setFileWarmOnce(false);
+    setFileRectBlocks(false);
+    CHECK(setFileMapId(CHAOS_MAP_FIXED));
+    checkMatchesCopyMode(plain, "fixed map");
+    // 解密使用文件尾中记录的映射，与当前设置无关
+    writeFile(PATH, plain.data(), plain.size());
+    CHECK(encryptFileInPlace_OMP(4, KEY, PATH).success == 1);
+    CHECK(setFileMapId(CHAOS_MAP_3D));
+    CHECK(decryptFileInPlace_OMP(4, KEY, PATH).success == 1);
+    CHECK(readFile(PATH) == std::string(plain.begin(), plain.end()));
+}
+
+static void checkRefusals() {
+    std::vector<uint8_t> plain = testBytes(100000, 2);
+    writeFile(PATH, plain.data(), plain.size());
+    CHECK(encryptFileInPlace_OMP(4, KEY, PATH).success == 1);
+    std::string encrypted = readFile(PATH);
+    // 错误的密钥与重复加密都不改动文件
+    CHECK(decryptFileInPlace_OMP(4, "wrong-key-123", PATH).success == 0);
+    CHECK(encryptFileInPlace_OMP(4, KEY, PATH).success == 0);
+    CHECK(readFile(PATH) == encrypted);
+    // 损坏的密文在解密之前被发现
+    std::string corrupted = encrypted;
+    corrupted[5000] ^= 1;
+    writeFile(PATH, corrupted);
+    CHECK(decryptFileInPlace_OMP(4, KEY, PATH).success == 0);
+    CHECK(readFile(PATH) == corrupted);
+    // 没有文件尾的文件不能解密
+    writeFile(PATH, plain.data(), plain.size());
+    CHECK(decryptFileInPlace_OMP(4, KEY, PATH).success == 0);
+}
+
+static void checkRecovery() {
+    std::vector<uint8_t> plain = testBytes(200000, 3);
+    std::string plainStr(plain.begin(), plain.end());
+    writeFile(PATH, plain.data(), plain.size());
+    CHECK(encryptFileInPlace_OMP(4, KEY, PATH).success == 1);
+    std::string encrypted = readFile(PATH);
+
+    // 解密在改动数据之前中断：重新解密
+    setTrailerState(PATH, CHAOS_INPLACE_DECRYPTING);
+    CHECK(decryptFileInPlace_OMP(4, KEY, PATH).success == 1);
+    CHECK(readFile(PATH) == plainStr);
+
+    // 明文已落盘、文件尾尚未截掉：只去掉文件尾，不再解密一次
+    writeFile(PATH, encrypted);
+    std::string decryptedWithTrailer;
+    {
+        std::string trailer = encrypted.substr(plain.size());
+        uint32_t crc = bufferCrc32(plain.data(), plain.size());
+        trailer[4] = (char) CHAOS_INPLACE_DECRYPTED;
+        for (int i = 0; i < 4; i++) {
+            trailer[12 + i] = (char) (crc >> (8 * i));
+        }
+        decryptedWithTrailer = plainStr + trailer;
+    }
+    writeFile(PATH, decryptedWithTrailer);
+    CHECK(decryptFileInPlace_OMP(4, "wrong-key-123", PATH).success == 0);
+    CHECK(decryptFileInPlace_OMP(4, KEY, PATH).success == 1);
+    CHECK(readFile(PATH) == plainStr);
+
+    // 数据已被部分解密：拒绝，文件不变
+    std::string partial = encrypted;
+    memcpy(&partial[0], plain.data(), 1000);
+    writeFile(PATH, partial);
+    setTrailerState(PATH, CHAOS_INPLACE_DECRYPTING);
+    std::string before = readFile(PATH);
+    CHECK(decryptFileInPlace_OMP(4, KEY, PATH).success == 0);
+    CHECK(readFile(PATH) == before);
+
+    // 加密在改动数据之前中断：继续加密得到同样的密文，或者解密撤销加密
+    std::string encryptingTrailer = encrypted.substr(plain.size());
+    uint32_t plainCrc = bufferCrc32(plain.data(), plain.size());
+    encryptingTrailer[4] = (char) CHAOS_INPLACE_ENCRYPTING;
+    for (int i = 0; i < 4; i++) {
+        encryptingTrailer[12 + i] = (char) (plainCrc >> (8 * i));
+    }
+    writeFile(PATH, plainStr + encryptingTrailer);
+    CHECK(encryptFileInPlace_OMP(4, KEY, PATH).success == 1);
+    CHECK(readFile(PATH) == encrypted);
+    writeFile(PATH, plainStr + encryptingTrailer);
+    CHECK(decryptFileInPlace_OMP(4, KEY, PATH).success == 1);
+    CHECK(readFile(PATH) == plainStr);
+}
+
+int main() {
+    checkSettings();
+    checkRefusals();
+    checkRecovery();
+    // 空文件
+    writeFile(PATH, "");
+    CHECK(encryptFileInPlace_OMP(2, KEY, PATH).success == 1);
+    CHECK(readFile(PATH).size() == CHAOS_INPLACE_TRAILER_SIZE);
+    CHECK(decryptFileInPlace_OMP(2, KEY, PATH).success == 1);
+    CHECK(readFile(PATH).empty());
+    return testResult("inplace");
+}
@@ -0,0 +1,125 @@
+// 文件密钥流模式矩阵：映射（三维 / 定点）× 标志（独立块初值、一次预热、矩形分块）× 长度。
+// 每种组合在每个可用的读写后端上检查单线程与多线程（不同线程数）的密文逐字节相同、都能解密，并用已知答案固定密文
+#include "chaos.h"
+#include "file_io.h"
+#include "sha256.h"
+#include "test_util.h"
+
+static const std::string KEY = "mode-matrix-key";
+
+struct MODE {
+    const char *name;
+    int mapId;
+    bool blockSeed;
+    bool warmOnce;
+    bool rectBlocks;
+    // KNOWN_LENGTH 字节明文 testBytes(KNOWN_LENGTH, KNOWN_SEED) 的密文文件（含文件头与校验表）的 SHA-256。
+    // 三维映射是双精度运算，答案依赖 CMakeLists.txt 中与 Android 构建相同的优化选项；定点映射与编译选项无关
+    const char *knownAnswer;
+};
+
+static const uint64_t KNOWN_LENGTH = 2 * 1024 * 1024 + 4321;
+static const uint64_t KNOWN_SEED = 99;
+
+static const MODE modes[] = {
+        {"3d", CHAOS_MAP_3D, false, false, false,
+                "f17f7e85b7e1fb3b3e8887cff1108b8be467a01a10a20803a33ce7d2413f7a01"},
+        {"fixed", CHAOS_MAP_FIXED, false, false, false,
+                "31bd2eef772103bdcc820643e0a1011888dacf14ee34aa2151b553a82f35ef9b"},
+        {"3d+seed", CHAOS_MAP_3D, true, false, false,
+                "4adf77eb8400da2ca447d61b71d1b56fe1d70cff6d22a59c430db055fbb9fb3c"},
+        {"fixed+seed", CHAOS_MAP_FIXED, true, false, false,
+                "91964140211c634b914a24e11d284561884a50e898f97ca06fcc1541523c8e50"},
+        {"3d+warm", CHAOS_MAP_3D, false, true, false,
+                "67a1a92927438416374582422ce9342937a4a3e0673d497aefeb45847a676fdd"},
+        {"fixed+warm", CHAOS_MAP_FIXED, false, true, false,
+                "00af0d3a7a21c8950d4d6c7b58b980576e64f085f0d32bb3a60e563d24747b90"},
+        {"3d+rect", CHAOS_MAP_3D, false, false, true,
+                "53949976f7d6e613346a9630ed0c7d94e8ae287f886a7712da41dfb39b6f3d06"},
+        {"fixed+rect", CHAOS_MAP_FIXED, false, false, true,
+                "fdfc59057a8680e740acd2f71e1d20b207bc5cb8b05b70ae9c9050e56db332a0"},
+        {"3d+seed+rect", CHAOS_MAP_3D, true, false, true,
+                "289f9b5cc29c661603b8686eef86bc03ed6ab77783f7618112fd1c7c9c49826e"},
+        {"fixed+warm+rect", CHAOS_MAP_FIXED, false, true, true,
+                "76223d32e240d652303200f13483d883fe5be55e4c82a14f2d0b94dc20099210"},
+};
+
+// 1 字节、最小块上下、不是块大小整数倍、最大块上下以及多块的长度；
+// 文件头之后数据末尾落在对齐单元边界上下（CHAOS_BUFFER_ALIGN - 文件头），直接 I/O 窗口（4 MiB）上下以及跨多个窗口的长度
+static const uint64_t lengths[] = {1, 2, 15, 16, 17, 255, 4031, 4032, 4033, 4095, 4096, 4097, 8128, 1048575, 1048576,
+                                   1048577, 3 * 1048576 + 77777, 4194303, 4194304, 4194305, 9 * 1048576 + 12345};
+
+// 可用的读写后端；直接 I/O 在文件系统不支持时由库自动改用 pread/pwrite
+static std::vector<int> backends;
+
+static void applyMode(const MODE &mode) {
+    CHECK(setFileMapId(mode.mapId));
+    setFileBlockSeed(mode.blockSeed);
+    setFileWarmOnce(mode.warmOnce);
+    setFileRectBlocks(mode.rectBlocks);
+}
+
+static int expectedFlags(const MODE &mode) {
+    return CHAOS_FILE_FLAG_BLOCK_CRC | (mode.blockSeed ? CHAOS_FILE_FLAG_BLOCK_SEED : 0) |
+           (mode.warmOnce ? CHAOS_FILE_FLAG_WARM_ONCE : 0) | (mode.rectBlocks ? CHAOS_FILE_FLAG_RECT_BLOCKS : 0);
+}
+
+// 返回密文
+static std::string checkLength(const MODE &mode, uint64_t length, uint64_t seed) {
+    std::string what = std::string(mode.name) + " length " + std::to_string(length);
+    std::vector<uint8_t> plain = testBytes(length, seed);
+    std::string plainStr(plain.begin(), plain.end());
+    writeFile("modes_plain.bin", plainStr);
+    CHECK_MSG(encryptFileWithKey(KEY, "modes_plain.bin", "modes_st.lzu").success == 1, what);
+    std::string cipher = readFile("modes_st.lzu");
+    CHAOS_FILE_HEADER header;
+    CHECK_MSG(parseFileHeader((const uint8_t *) cipher.data(), cipher.size(), header), what);
+    CHECK_MSG(header.mapId == mode.mapId && header.flags == expectedFlags(mode), what + " header");
+    for (int backend: backends) {
+        setFileIoBackend(backend);
+        for (int threads: {1, 3, 8}) {
+            std::string msg = what + " backend " + std::to_string(backend) + " threads " + std::to_string(threads);
+            CHECK_MSG(encryptFileWithKey_OMP(threads, KEY, "modes_plain.bin", "modes_mt.lzu").success == 1, msg);
+            CHECK_MSG(readFile("modes_mt.lzu") == cipher, msg + " differs from single-threaded");
+            CHECK_MSG(decryptFileWithKey_OMP(threads, KEY, "modes_st.lzu", "modes_dec.bin").success == 1, msg);
+            CHECK_MSG(readFile("modes_dec.bin") == plainStr, msg + " decrypt");
+        }
+    }
+    CHECK_MSG(decryptFileWithKey(KEY, "modes_mt.lzu", "modes_dec.bin").success == 1, what);
+    CHECK_MSG(readFile("modes_dec.bin") == plainStr, what + " single-threaded decrypt");
+    return cipher;
+}
+
+int main() {
+    int defaultBackend = getFileIoBackend();
+    for (int backend: {CHAOS_IO_PREAD, CHAOS_IO_URING, CHAOS_IO_DIRECT}) {
+        if (setFileIoBackend(backend)) {
+            backends.push_back(backend);
+        }
+    }
+    printf("io backends:");
+    for (int backend: backends) {
+        printf(" %d", backend);
+    }
+    printf("\n");
+    std::vector<std::string> answers;
+    for (const MODE &mode: modes) {
+        applyMode(mode);
+        for (uint64_t length: lengths) {
+            checkLength(mode, length, length);
+        }
+        std::string cipher = checkLength(mode, KNOWN_LENGTH, KNOWN_SEED);
+        std::string answer = sha256_hash(cipher);
+        CHECK_MSG(answer == mode.knownAnswer, std::string(mode.name) + " known answer " + answer);
+        answers.push_back(answer);
+    }
+    // 各模式的密文互不相同
+    for (size_t i = 0; i < answers.size(); i++) {
+        for (size_t j = i + 1; j < answers.size(); j++) {
+            CHECK_MSG(answers[i] != answers[j], std::string(modes[i].name) + " == " + modes[j].name);
+        }
+    }
+    applyMode(modes[0]);
+    setFileIoBackend(defaultBackend);
+    return testResult("modes");
+}
@@ -0,0 +1,87 @@
+// 各级扩散核（SSE2 / AVX2 / AVX-512 / NEON）与标量实现逐字节对比，CPU 不支持的级别跳过
+#include <cstring>
+#include "chaos.h"
+#include "chaos_simd.h"
+#include "test_util.h"
+
+static const char *levelName(int level) {
+    static const char *names[] = {"scalar", "sse2", "avx2", "avx512", "neon"};
+    return names[level];
+}
+
+// 单个核函数：宽度 1..399，起始地址分别偏移 0..3 字节，覆盖向量主循环与尾部的所有组合
+static void checkKernels(int level, const CHAOS_DIFFUSE_KERNELS &scalar, const CHAOS_DIFFUSE_KERNELS &simd) {
+    std::vector<uint8_t> a = testBytes(512, 1), k = testBytes(512, 2), c = testBytes(512, 3);
+    for (int n = 1; n < 400; n++) {
+        for (int offset = 0; offset < 4; offset++) {
+            std::string what = std::string(levelName(level)) + " n=" + std::to_string(n) + " offset=" +
+                               std::to_string(offset);
+            std::vector<uint8_t> expect = a, actual = a;
+            const uint8_t *kk = k.data() + offset, *cc = c.data() + offset;
+            scalar.xorRow3(expect.data() + offset, kk, cc, n);
+            simd.xorRow3(actual.data() + offset, kk, cc, n);
+            CHECK_MSG(expect == actual, "xorRow3 " + what);
+            scalar.xorRow2(expect.data() + offset, kk, n);
+            simd.xorRow2(actual.data() + offset, kk, n);
+            CHECK_MSG(expect == actual, "xorRow2 " + what);
+            scalar.scanRow(expect.data() + offset, kk, n);
+            simd.scanRow(actual.data() + offset, kk, n);
+            CHECK_MSG(expect == actual, "scanRow " + what);
+            scalar.diffRow(expect.data() + offset, kk, n);
+            simd.diffRow(actual.data() + offset, kk, n);
+            CHECK_MSG(expect == actual, "diffRow " + what);
+        }
+    }
+}
+
+// 整块扩散：与标量级别的密文一致，且能解密回明文
+static void checkBlocks(int level) {
+    const int shapes[][2] = {{4, 4}, {17, 17}, {64, 64}, {100, 37}, {37, 100}, {255, 256}, {1024, 1024}};
+    std::vector<uint8_t> keys = testBytes(2 * MAX_BLOCKROW, 4);
+    for (const auto &shape: shapes) {
+        int m = shape[0], n = shape[1];
+        int k = blockKeyLength(m, n);
+        std::string what = std::string(levelName(level)) + " " + std::to_string(m) + "x" + std::to_string(n);
+        std::vector<uint8_t> plain = testBytes((size_t) m * n, 5 + m);
+        std::vector<uint8_t> expect = plain, actual = plain;
+        setSimdLevel(CHAOS_SIMD_SCALAR);
+        encode_Diffuse(expect.data(), m, n, keys.data(), keys.data() + k);
+        setSimdLevel(level);
+        encode_Diffuse(actual.data(), m, n, keys.data(), keys.data() + k);
+        CHECK_MSG(expect == actual, "encode_Diffuse " + what);
+        decode_Diffuse(actual.data(), m, n, keys.data(), keys.data() + k);
+        CHECK_MSG(plain == actual, "decode_Diffuse " + what);
+    }
+}
+
+int main() {
+    int detected = getSimdLevel();
+    setSimdLevel(CHAOS_SIMD_SCALAR);
+    const CHAOS_DIFFUSE_KERNELS scalar = getDiffuseKernels();
+    int tested = 0;
+    for (int level = CHAOS_SIMD_SSE2; level <= CHAOS_SIMD_NEON; level++) {
+        if (!setSimdLevel(level)) {
+            printf("%s: not supported, skipped\n", levelName(level));
+            continue;
+        }
+        checkKernels(level, scalar, getDiffuseKernels());
+        checkBlocks(level);
+        printf("%s: checked\n", levelName(level));
+        tested++;
+    }
+    // 不支持的级别必须被拒绝，当前级别保持不变
+    setSimdLevel(detected);
+    CHECK(!setSimdLevel(-1));
+    CHECK(!setSimdLevel(CHAOS_SIMD_NEON + 1));
+    CHECK(getSimdLevel() == detected);
+    // 基准测试只在本次测量中使用指定级别，不改动全局级别
+    for (int level = CHAOS_SIMD_SCALAR; level <= CHAOS_SIMD_NEON; level++) {
+        CHAOS_OPERATION_RESULT result = benchmarkDiffusePasses(64, 2, level);
+        CHECK(result.success == (isSimdLevelSupported(level) ? 1 : 0));
+        CHECK(getSimdLevel() == detected);
+    }
+    if (tested == 0) {
+        printf("no SIMD level available, only the scalar path was exercised\n");
+    }
+    return testResult("simd");
+}
@@ -0,0 +1,77 @@
+#ifndef __CHAOS_TEST_UTIL_H__
+#define __CHAOS_TEST_UTIL_H__
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// 失败的检查数，main 以 testResult() 结束
+static int testFailures = 0;
+
+#define CHECK(cond)                                                                  \
+    do {                                                                             \
+        if (!(cond)) {                                                               \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            testFailures++;                                                          \
+        }                                                                            \
+    } while (0)
+
+// 带上下文的检查，what 说明失败的用例（级别、长度等）
+#define CHECK_MSG(cond, what)                                                                          \
+    do {                                                                                               \
+        if (!(cond)) {                                                                                 \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed: %s\n", __FILE__, __LINE__, #cond,                \
+                    std::string(what).c_str());                                                        \
+            testFailures++;                                                                            \
+        }                                                                                              \
+    } while (0)
+
+static inline int testResult(const char *name) {
+    if (testFailures > 0) {
+        fprintf(stderr, "%s: %d check(s) failed\n", name, testFailures);
+        return 1;
+    }
+    printf("%s: OK\n", name);
+    return 0;
+}
+
+// 可复现的测试数据（splitmix64）
+static inline std::vector<uint8_t> testBytes(size_t len, uint64_t seed) {
+    std::vector<uint8_t> bytes(len);
+    for (size_t i = 0; i < len; i++) {
+        uint64_t z = (seed += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        bytes[i] = (uint8_t) (z ^ (z >> 31));
+    }
+    return bytes;
+}
+
+static inline std::string readFile(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+static inline void writeFile(const std::string &path, const void *data, size_t len) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write((const char *) data, (std::streamsize) len);
+}
+
+static inline void writeFile(const std::string &path, const std::string &data) {
+    writeFile(path, data.data(), data.size());
+}
+
+static inline std::string toHex(const uint8_t *data, size_t len) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex(2 * len, '0');
+    for (size_t i = 0; i < len; i++) {
+        hex[2 * i] = digits[data[i] >> 4];
+        hex[2 * i + 1] = digits[data[i] & 15];
+    }
+    return hex;
+}
+
+#endif
@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(int workerCount) : m_stop(false) {
+    workerCount = std::max(workerCount, 1);
+    m_workers.reserve(workerCount);
+    for (int i = 0; i < workerCount; i++) {
+        m_workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    for (std::thread &worker: m_workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+    }
+    m_cond.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+            if (m_jobs.empty()) {
+                return;
+            }
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+        job();
+    }
+}
+
+namespace {
+    // 一次 parallelFor 的共享状态，工作线程可能在调用返回后才取到辅助任务，因此由 shared_ptr 持有
+    struct ParallelState {
+        std::atomic<int> next{0};
+        int count = 0;
+        int done = 0;
+        const std::function<void(int)> *task = nullptr;
+        std::mutex mutex;
+        std::condition_variable cond;
+
+        // 领取并执行任务，直到没有剩余任务
+        void run() {
+            int finished = 0;
+            for (int i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+                (*task)(i);
+                finished++;
+            }
+            if (finished > 0) {
+                std::lock_guard<std::mutex> lock(mutex);
+                done += finished;
+                if (done == count) {
+                    cond.notify_all();
+                }
+            }
+        }
+    };
+}
+
+void ThreadPool::parallelFor(int count, int maxThreads, const std::function<void(int)> &task) {
+    if (count <= 0) {
+        return;
+    }
+    int helpers = std::min(count, size() + 1) - 1;
+    if (maxThreads > 0) {
+        helpers = std::min(helpers, maxThreads - 1);
+    }
+    if (helpers <= 0) {
+        for (int i = 0; i < count; i++) {
+            task(i);
+        }
+        return;
+    }
+    auto state = std::make_shared<ParallelState>();
+    state->count = count;
+    state->task = &task;
+    for (int i = 0; i < helpers; i++) {
+        submit([state] { state->run(); });
+    }
+    state->run();
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cond.wait(lock, [&state] { return state->done == state->count; });
+}
+
+ThreadPool &ThreadPool::shared() {
+    static ThreadPool pool(static_cast<int>(std::thread::hardware_concurrency()));
+    return pool;
+}
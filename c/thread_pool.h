@@ -0,0 +1,56 @@
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * 常驻线程池
+ * 工作线程在库内只创建一次，空闲时阻塞在任务队列上，
+ * 多线程加解密在所有平台上都通过它并行，不再依赖 OpenMP
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(int workerCount);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // 工作线程数量
+    int size() const {
+        return static_cast<int>(m_workers.size());
+    }
+
+    // 提交一个任务，由空闲的工作线程执行
+    void submit(std::function<void()> job);
+
+    /**
+     * 并行执行 task(0) ~ task(count - 1)，返回时全部任务已完成
+     * 调用线程同样参与执行，因此在工作线程内嵌套调用也不会死锁
+     * @param count 任务数量
+     * @param maxThreads 最多同时执行的线程数（含调用线程），<= 0 表示不限制
+     * @param task 任务，参数为任务序号
+     */
+    void parallelFor(int count, int maxThreads, const std::function<void(int)> &task);
+
+    // 库共享的线程池，工作线程数为 CPU 核心数
+    static ThreadPool &shared();
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    bool m_stop;
+};
+
+#endif
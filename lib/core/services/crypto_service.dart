@@ -44,6 +44,21 @@ typedef EncryptFileMTDart =
       Pointer<Utf8> outputPath,
     );
 
+typedef CryptBufferC =
+    Pointer<Utf8> Function(
+      Pointer<Utf8> key,
+      Pointer<Uint8> input,
+      Pointer<Uint8> output,
+      Uint64 len,
+    );
+typedef CryptBufferDart =
+    Pointer<Utf8> Function(
+      Pointer<Utf8> key,
+      Pointer<Uint8> input,
+      Pointer<Uint8> output,
+      int len,
+    );
+
 typedef FreeMemoryC = Void Function(Pointer<Void> ptr);
 typedef FreeMemoryDart = void Function(Pointer<Void> ptr);
 
@@ -69,6 +84,10 @@ final EncryptFileMTDart _decryptFileMT = _nativeLib
     .lookup<NativeFunction<EncryptFileMTC>>('decrypt_file_mt')
     .asFunction();
 
+final CryptBufferDart _encryptBuffer = _nativeLib
+    .lookup<NativeFunction<CryptBufferC>>('encrypt_buffer')
+    .asFunction();
+
 // ... (in class CryptoService)
 
 final FreeMemoryDart _freeMemory = _nativeLib
@@ -176,107 +195,66 @@ class CryptoService {
   }
 
   // --- Image Encryption (Visual) ---
-  // Since C++ operates on strings/files, we need to adapt.
-  // Visual encrypt: Convert pixels to bytes -> Base64 string -> Encrypt -> Base64 String -> Bytes -> Bitmap?
-  // Problem: The C++ string encryption adds headers/CRC. It returns "len + ciphertext + crc".
-  // This might not be valid image data if we just write it back.
-  // AND the visual encryption needs to show "snow".
-  // The C++ logic: `encode_Block` shuffles and diffuses.
-  // If we encrypt the raw bytes of the image (RGB), the result will be high entropy bytes.
-  // If we try to display these bytes as an image, it depends on headers.
-  //
-  // APPROACH:
-  // 1. Get raw RGBA bytes.
-  // 2. Encrypt them using C++ `encrypt_string` (treating bytes as char string? careful with nulls).
-  //    Wait, `encryptStrWithKey` takes `std::string`. `std::string` can handle nulls if constructed with length, but `inputStr.c_str()` usage in C++ might stop at null.
-  //    CHECK C++: `strcpy(reinterpret_cast<char *>(dstStr), inputStr.c_str());` -> KABOOM on binary data with nulls.
-  //
-  //    CRITICAL FINDING: C++ `encryptStrWithKey` uses `strcpy` and string functions dependent on null termination.
-  //    IT IS NOT SAFE FOR BINARY DATA.
-  //
-  //    However, `encryptFileWithKey` handles binary files correctly using streams.
-  //
-  //    Workaround for Image Visual:
-  //    Save image to temp file -> Encrypt File -> Read encrypted file -> Show as Image?
-  //    But encrypted file has header/CRC. It's not a valid PNG/JPG.
-  //    To display "snow", we want raw pixel values that are randomized.
-  //
-  //    If I want to visualize the *result*, I should probably just take the encrypted bytes and force-interpret them as RGB.
-  //    But the `encryptFile` adds a header. I can skip the header in Dart.
-  //
-  //    Let's implement `encryptImageBytes` via temp file for robustness.
-
+  // The RGB pixels are written straight into native memory and encrypted in
+  // place with `encrypt_buffer` (no header, same length), so the ciphertext can
+  // be shown as a noise image of the same size without any temp files.
   static Future<Uint8List> encryptImageBytes(Uint8List imageBytes) async {
-    // 1. Write temp file
-    final tempDir = Directory.systemTemp;
-    final inFile = File('${tempDir.path}/temp_img.dat');
-    await inFile.writeAsBytes(imageBytes);
-    final outFile = File('${tempDir.path}/temp_img.enc');
-
     final key = await _getStoredKey();
+    return compute(_encryptImageIsolate, {
+      'key': key,
+      'bytes': imageBytes,
+    }).timeout(
+      const Duration(seconds: 30),
+      onTimeout: () {
+        throw Exception('Encryption timed out');
+      },
+    );
+  }
 
-    // 2. Encrypt file
-    final result =
-        await compute(_encryptFileIsolate, {
-          'key': key,
-          'input': inFile.path,
-          'output': outFile.path,
-        }).timeout(
-          const Duration(seconds: 30),
-          onTimeout: () {
-            throw Exception('Encryption timed out');
-          },
-        );
-    // Add timeout/error check?
-    // compute might throw if isolate fails.
-    print('[CryptoService] Image Encryption Result: $result');
-
-    // 3. Read result
-    if (await outFile.exists()) {
-      final encBytes = await outFile.readAsBytes();
-
-      // 4. Transform to displayable "noise" image
-      // The Encrypted file is: [Len Header][Ciphertext][CRC]
-      // We want to extract [Ciphertext] and display it.
-      // But [Ciphertext] is just randomized bytes.
-      // To show it as an image, we can just take the raw bytes and wrap a BMP/PNG header or just fill a matrix.
-      //
-      // Simpler approach for "Visual Encryption" demo:
-      // The goal is to show it looks like noise.
-      // Just re-encoding the raw encrypted bytes as a PNG usually fails because it's random data.
-      // We need to create a *valid* image where pixel data comes from the encrypted bytes.
-
-      img.Image? original = img.decodeImage(imageBytes);
-      if (original == null) return Uint8List(0);
-
-      // Create new noise image of same size
-      img.Image noiseImg = img.Image(
+  static Uint8List _encryptImageIsolate(Map<String, dynamic> args) {
+    final img.Image? original = img.decodeImage(args['bytes'] as Uint8List);
+    if (original == null) return Uint8List(0);
+
+    final len = original.width * original.height * 3;
+    final buffer = malloc<Uint8>(len);
+    final keyPtr = (args['key'] as String).toNativeUtf8();
+    try {
+      final pixels = buffer.asTypedList(len);
+      int idx = 0;
+      for (final pixel in original) {
+        pixels[idx++] = pixel.r.toInt();
+        pixels[idx++] = pixel.g.toInt();
+        pixels[idx++] = pixel.b.toInt();
+      }
+
+      final resultPtr = _encryptBuffer(keyPtr, buffer, buffer, len);
+      final result = resultPtr.toDartString();
+      _freeMemory(resultPtr.cast());
+      print('[CryptoService] Image Encryption Result: $result');
+      if (!result.startsWith("SUCCESS")) return Uint8List(0);
+
+      final noiseImg = img.Image(
         width: original.width,
         height: original.height,
       );
-
-      // Fill noise image with bytes from encBytes
-      // We cycle through encBytes to fill pixels
-      int byteIdx = 0;
-      // Skip header?
-      // C++ format: 2 chars (length of length), then length hex, then data...
-      // It's complicated to parse without C++ logic.
-      // Let's just blindly use bytes from the middle.
-
+      idx = 0;
       for (int y = 0; y < noiseImg.height; y++) {
         for (int x = 0; x < noiseImg.width; x++) {
-          if (byteIdx >= encBytes.length) byteIdx = 0;
-          int r = encBytes[byteIdx];
-          int g = (byteIdx + 1 < encBytes.length) ? encBytes[byteIdx + 1] : 0;
-          int b = (byteIdx + 2 < encBytes.length) ? encBytes[byteIdx + 2] : 0;
-          noiseImg.setPixelRgb(x, y, r, g, b);
-          byteIdx += 3;
+          noiseImg.setPixelRgb(
+            x,
+            y,
+            pixels[idx],
+            pixels[idx + 1],
+            pixels[idx + 2],
+          );
+          idx += 3;
         }
       }
-
       return Uint8List.fromList(img.encodePng(noiseImg));
+    } finally {
+      malloc.free(buffer);
+      calloc.free(keyPtr);
     }
-    return Uint8List(0);
   }
 
   // Isolated entry point for file encryption